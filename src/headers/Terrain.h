@@ -1,7 +1,7 @@
 class Terrain{
 
     GLuint programID;
-    GLuint mvpMatrixID;
+    GLintptr objectOffset = 0;
 
 
     public:
@@ -13,22 +13,24 @@ class Terrain{
                 std::cout << "Error loading shaders" << std::endl;
                 exit(1);
             }
-
-            mvpMatrixID = glGetUniformLocation(programID, "MVP");
         }
 
-        void render(glm::mat4 cameraMatrix){
-            glUseProgram(programID);
-
-
+        // Stages the Object block, before the frame's uniform upload
+        void stage(){
             glm::mat4 modelMatrix = glm::mat4(1.0f);
 
             // Perform any transformations if required
 
-            glm::mat4 mvp = cameraMatrix * modelMatrix;
+            ObjectUniforms object;
+            object.model = modelMatrix;
+            objectOffset = stageObjectUniforms(object);
+        }
 
-            glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+        // View and projection come from the Frame block bound for the frame
+        void render(){
+            glUseProgram(programID);
 
+            bindObjectUniforms(objectOffset);
 
             glUseProgram(0);
         }
@@ -0,0 +1,176 @@
+// Instanced robots animated from baked joint textures: every clip is sampled
+// once at load into an RGBA32F texture and robot_instanced.vert looks up each
+// instance's frame, so the whole crowd costs one draw per model primitive and
+// no per-robot CPU animation at all.
+class RobotCrowd {
+	GLuint programID;
+
+	std::shared_ptr<GltfModel> modelAsset;
+	std::shared_ptr<ProgramAsset> program;
+
+	// Baked clips; the texels are dropped once they are in the texture
+	BakedAnimation bakedAnimation;
+	GLuint jointTexture = 0;
+
+	// Per instance data, matching locations 6 to 10 of robot_instanced.vert
+	struct Instance {
+		glm::mat4 modelMatrix;
+		glm::vec4 animation;		// first row, frame count, frame rate, time offset
+	};
+	std::vector<Instance> instances;
+	SceneIndex index;		// bounds of the instances, userData indexing instances
+	std::vector<uint32_t> visibleIndices;
+	std::vector<Instance> visibleInstances;		// this frame's, uploaded to the instance buffer
+
+	GLuint instanceBufferID = 0;
+	std::vector<GLuint> vertexArrayIDs;	// one per model primitive, with the instance attributes added
+
+    private:
+        // Frames per second the clips are baked at
+        static constexpr float kBakeRate = 30.0f;
+
+        void bake(const GltfModel &model) {
+            bakedAnimation = bakeAnimations(model, 0, kBakeRate);
+            if (bakedAnimation.clips.empty() || bakedAnimation.texels.empty()) {
+                return;
+            }
+
+            glGenTextures(1, &jointTexture);
+            glBindTexture(GL_TEXTURE_2D, jointTexture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, bakedAnimation.width(), bakedAnimation.height(), 0,
+                         GL_RGBA, GL_FLOAT, bakedAnimation.texels.data());
+
+            std::cout << "Baked " << bakedAnimation.clips.size() << " clip(s) into a " << bakedAnimation.width() << "x"
+                      << bakedAnimation.height() << " joint texture" << std::endl;
+            std::vector<glm::vec4>().swap(bakedAnimation.texels);
+
+            // The model's buffers with the instance stream added, in VAOs of our own
+            glGenBuffers(1, &instanceBufferID);
+            for (const GltfPrimitive &primitive : model.primitives) {
+                GLuint vertexArrayID = createGltfVertexArray(model, primitive);
+                glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+                for (int column = 0; column < 4; column++) {
+                    glEnableVertexAttribArray(6 + column);
+                    glVertexAttribPointer(6 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                                          (void *)(offsetof(Instance, modelMatrix) + column * sizeof(glm::vec4)));
+                    glVertexAttribDivisor(6 + column, 1);
+                }
+                glEnableVertexAttribArray(10);
+                glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)offsetof(Instance, animation));
+                glVertexAttribDivisor(10, 1);
+                vertexArrayIDs.push_back(vertexArrayID);
+            }
+            glBindVertexArray(0);
+
+            // Instances added before the model arrived only now know their clip
+            const BakedClip &clip = bakedAnimation.clips[0];
+            for (Instance &instance : instances) {
+                instance.animation = glm::vec4(clip.firstRow, clip.frameCount, clip.frameRate, instance.animation.w);
+            }
+        }
+
+        void initialize() {
+            program = AssetCache::instance().program("../src/shaders/robot_instanced.vert", "../src/shaders/robot.frag");
+            if (!program)
+            {
+                std::cerr << "Failed to load shaders." << std::endl;
+                return;
+            }
+            programID = program->programID;
+
+            // The render queue binds the joint texture to unit 0
+            glUseProgram(programID);
+            glUniform1i(glGetUniformLocation(programID, "jointTexture"), 0);
+
+            CheckOpenGLErrors("Getting shader variables");
+
+            // Same cache key as Robot, so the model is shared with any per-robot instances
+            std::string modelPath = "../src/assets/models/bot/waving.gltf";
+            AssetCache::instance().acquireAsync<GltfModel>("gltf", modelPath, [modelPath]() -> AssetCache::Upload<GltfModel> {
+                size_t size = 0;
+                const unsigned char *blob = AssetPack::instance().find(assetKey(modelPath), AssetType::Gltf, modelPath, size);
+                return prepareGltfModel(modelPath, blob, size);
+            }, [this](std::shared_ptr<GltfModel> loaded){
+                if(!loaded || loaded->skins.empty() || loaded->animations.empty()){
+                    return;
+                }
+                bake(*loaded);
+                modelAsset = loaded;
+            });
+        }
+
+    public:
+        RobotCrowd() {
+            initialize();
+        }
+
+        // timeOffset shifts this robot's playback so the crowd does not move in lockstep
+        void add(glm::vec3 position, GLfloat angle, float timeOffset) {
+            Instance instance;
+            instance.modelMatrix = Robot::modelMatrixAt(position, angle);
+            instance.animation = glm::vec4(0.0f, 0.0f, 0.0f, timeOffset);
+            if (!bakedAnimation.clips.empty()) {
+                const BakedClip &clip = bakedAnimation.clips[0];
+                instance.animation = glm::vec4(clip.firstRow, clip.frameCount, clip.frameRate, timeOffset);
+            }
+            instances.push_back(instance);
+
+            glm::vec3 center;
+            float radius;
+            Robot::worldBounds(instance.modelMatrix, center, radius);
+            index.insert(center, radius, (uint32_t)(instances.size() - 1));
+        }
+
+        size_t size() const { return instances.size(); }
+
+        // One instanced packet per model draw covers every visible robot; the
+        // view and the clip time come from the Frame block, so there is nothing
+        // to set up
+        void submit(RenderQueue &queue, FrustumCuller &culler) {
+            if(!modelAsset || !program || jointTexture == 0 || instances.empty()){
+                return;
+            }
+
+            // Robots in view are packed together and replace last frame's stream
+            culler.cull(index, visibleIndices);
+            visibleInstances.clear();
+            for (uint32_t i : visibleIndices) {
+                visibleInstances.push_back(instances[i]);
+            }
+            if (visibleInstances.empty()) {
+                return;
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+            glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, visibleInstances.size() * sizeof(Instance), visibleInstances.data());
+
+            for (const GltfDraw &draw : modelAsset->draws) {
+                DrawPacket packet;
+                packet.programID = programID;
+                packet.textureID = jointTexture;
+                packet.vertexArrayID = vertexArrayIDs[draw.primitive];
+                packet.mode = draw.mode;
+                packet.indexCount = draw.indexCount;
+                packet.indexType = draw.indexType;
+                packet.indexOffset = draw.indexOffset;
+                packet.instanceCount = (GLsizei)visibleInstances.size();
+                queue.submit(packet, RenderPass::Opaque, 0.0f);
+            }
+        }
+
+        void cleanup() {
+            if (!vertexArrayIDs.empty()) {
+                glDeleteVertexArrays((GLsizei)vertexArrayIDs.size(), vertexArrayIDs.data());
+                vertexArrayIDs.clear();
+            }
+            glDeleteBuffers(1, &instanceBufferID);
+            glDeleteTextures(1, &jointTexture);
+            instanceBufferID = 0;
+            jointTexture = 0;
+            program.reset();
+            modelAsset.reset();
+        }
+};
@@ -1,172 +1,64 @@
+// Every house in the scene: one mesh placed many times, drawn with an instanced
+// draw per level of detail however many houses there are
 class House{
-    std::vector<float> vertices;
-    std::vector<int> indices;
-    std::vector<float> normals;
-    std::vector<float> uvs;
-
-    GLuint vertexArrayID;
-    GLuint vertexBufferID;
-    GLuint indexBufferID;
-    GLuint normalBufferID;
-    GLuint uvBufferID;
+    // Shared through the AssetCache
+    std::shared_ptr<MeshAsset> mesh;
+    std::shared_ptr<TextureAsset> diffuseTexture;
+    std::shared_ptr<ProgramAsset> program;
 
     GLuint programID;
-    GLuint mvpMatrixID;
-    GLuint diffuseTextureObject = 0;
     GLuint diffuseTextureID;
 
-    GLuint lightPositionID;
-    GLuint lightIntensityID;
-
-    glm::vec3 position;
-    glm::vec3 lightPosition;
-    glm::vec3 lightIntensity;
-    GLfloat angle;
-
-    private:
-        GLuint LoadTextureTileBox(const char *texture_path){
-            int width, height, channels;
-            unsigned char *image = stbi_load(texture_path, &width, &height, &channels, 0);
-
-            GLuint textureID;
-            glGenTextures(1, &textureID);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-
-            if(image){
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // World transform of each house
+    std::vector<glm::mat4> placements;
+    SceneIndex index;                   // world bounds, userData indexing placements
+    std::vector<uint32_t> visibleIndices;
+    StaticMeshBatch batch;
 
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            } else{
-                std::cerr << "Error loading texture: " << texture_path << std::endl;
-                return 0;
-            }
-            stbi_image_free(image);
-            return textureID;
-        }
+    // Where submit staged this frame's Object block, which holds the dequantisation
+    GLintptr objectOffset = 0;
 
     public:
-        // House(glm::vec3 position=glm::vec3(0.0f), GLfloat angle=0.0f): position(position), angle(angle){
-        House(glm::vec3 position=glm::vec3(0.0f), GLfloat angle=0.0f, glm::vec3 lightPosition=glm::vec3(10.0f,100.0f, 100.0f), glm::vec3 lightIntensity=glm::vec3(1e7)){
-            this->position = position;
-            this->angle = angle;
-            this->lightPosition = lightPosition;
-            this->lightIntensity = lightIntensity;
-
-            tinyobj::attrib_t attrib;
-            std::vector<tinyobj::shape_t> shapes;
-            std::vector<tinyobj::material_t> materials;
-            std::string warn, err;
-
-            // Load OBJ file
-            if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, "../src/assets/models/house/model.obj")) {
-                std::cerr << "Error loading OBJ file: " << warn << err << std::endl;
-                return;
-            }
-
-            for (const auto &shape : shapes) {
-                for (const auto &index : shape.mesh.indices) {
-                    vertices.push_back(attrib.vertices[3 * index.vertex_index + 0]);
-                    vertices.push_back(attrib.vertices[3 * index.vertex_index + 1]);
-                    vertices.push_back(attrib.vertices[3 * index.vertex_index + 2]);
-
-                    if(index.texcoord_index >= 0){
-                        uvs.push_back(attrib.texcoords[2 * index.texcoord_index + 0]);
-                        uvs.push_back(attrib.texcoords[2 * index.texcoord_index + 1]);
-                    } else{
-                        uvs.push_back(0.0f);
-                        uvs.push_back(0.0f);
-                    }
-
-                    if(index.normal_index >= 0){
-                        normals.push_back(attrib.normals[3 * index.normal_index + 0]);
-                        normals.push_back(attrib.normals[3 * index.normal_index + 1]);
-                        normals.push_back(attrib.normals[3 * index.normal_index + 2]);
-                    } else{
-                        normals.push_back(0.0f);
-                        normals.push_back(0.0f);
-                        normals.push_back(0.0f);
-                    }
-
-                    indices.push_back(indices.size());
-
-                }
-            }
-
-            glGenVertexArrays(1, &vertexArrayID);
-            glBindVertexArray(vertexArrayID);
-
-            // Vertex buffer
-            glGenBuffers(1, &vertexBufferID);
-            glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-            // UV buffer data
-            glGenBuffers(1, &uvBufferID);
-            glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-            glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(float), uvs.data(), GL_STATIC_DRAW);
-
-            // Normal buffer data
-            glGenBuffers(1, &normalBufferID);
-            glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-            glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
-
-            // Index buffer
-            glGenBuffers(1, &indexBufferID);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(float), indices.data(), GL_STATIC_DRAW);
-
-            programID = LoadShadersFromFile("../src/shaders/house.vert", "../src/shaders/house.frag");
-            if (programID == 0) {
+        House(){
+            program = AssetCache::instance().program("../src/shaders/house.vert", "../src/shaders/house.frag");
+            if (!program) {
                 std::cerr << "Error loading shaders." << std::endl;
                 return;
             }
+            programID = program->programID;
 
-            mvpMatrixID = glGetUniformLocation(programID, "MVP");
-
-            // Load texture
-            diffuseTextureID = glGetUniformLocation(programID, "diffuseTexture");
+            // The render queue binds the diffuse map to unit 0
+            diffuseTextureID = glGetUniformLocation(programID, "textureSampler");
+            glUseProgram(programID);
+            glUniform1i(diffuseTextureID, 0);
 
-            lightPositionID = glGetUniformLocation(programID, "lightPosition");
-            lightIntensityID = glGetUniformLocation(programID, "lightIntensity");
+            // Loaded in the background, the texture named by the material follows the mesh
+            AssetCache::instance().meshAsync("../src/assets/models/house/model.obj", [this](std::shared_ptr<MeshAsset> loaded){
+                mesh = loaded;
+                if (!mesh) {
+                    return;
+                }
 
-            if(!materials.empty()){
-                std::string diffuseTexPath = materials[0].diffuse_texname;
-                if(!diffuseTexPath.empty()){
-                    diffuseTextureID = LoadTextureTileBox(diffuseTexPath.c_str());
+                TextureOptions textureOptions;
+                textureOptions.wrap = GL_REPEAT;
+                std::string diffuseTexturePath = mesh->diffuseTexturePath;
+                if(diffuseTexturePath.empty()){
+                    diffuseTexturePath = "../src/assets/models/house/Sci-Fi_Building_01_baseColor.png";
                 }
-            } else{
-                diffuseTextureObject = LoadTextureTileBox("../src/assets/models/house/Sci-Fi_Building_01_baseColor.png");
-            }
+                AssetCache::instance().textureAsync(diffuseTexturePath, textureOptions, [this](std::shared_ptr<TextureAsset> loaded){
+                    diffuseTexture = loaded;
+                });
+            });
 
-            glBindVertexArray(0);
-            CheckOpenGLErrors("House::House - loading obj");
+            CheckOpenGLErrors("House::House");
         }
 
-        void render(glm::mat4 cameraMatrix){
-            glUseProgram(programID);
-
-            glBindVertexArray(vertexArrayID);
-
-            glEnableVertexAttribArray(0);
-            glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
-
-            glEnableVertexAttribArray(1);
-            glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void *) 0);
-
-            glEnableVertexAttribArray(2);
-            glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
-
-            // Bind index buffer
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+        static void setupDraw(const void *object) {
+            const House &house = *static_cast<const House *>(object);
+            bindObjectUniforms(house.objectOffset);
+        }
 
+        void add(glm::vec3 position, GLfloat angle=0.0f){
             glm::mat4 modelMatrix = glm::mat4(1.0f);
 
             // Translate the matrix
@@ -178,35 +70,57 @@ class House{
             // Rotate the matrix
             modelMatrix = glm::rotate(modelMatrix, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
 
-            glm::mat4 mvp = cameraMatrix * modelMatrix;
+            placements.push_back(modelMatrix);
+        }
 
-            glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+        size_t size() const { return placements.size(); }
 
-            // Bind texture
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, diffuseTextureObject);
-            glUniform1i(diffuseTextureID, 0);
+        // A box inside every house, to hide whatever stands behind it
+        void addOccluders(OcclusionCuller &occlusion){
+            if (!mesh) {
+                return;
+            }
+            for (const glm::mat4 &placement : placements) {
+                occlusion.addOccluder(mesh->occluder, placement);
+            }
+        }
 
-            glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-            glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
+        void submit(RenderQueue &queue, glm::mat4 cameraMatrix, LodSelector &lodSelector, FrustumCuller &culler){
+            if (!mesh || placements.empty()) {
+                return;
+            }
 
-            // Draw the object
-            glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, (void *) 0);
+            ObjectUniforms object;
+            object.model = mesh->dequantize;
+            object.params.x = mesh->octahedralNormals ? 1.0f : 0.0f;
+            objectOffset = stageObjectUniforms(object);
+
+            // World bounds of every house, once the mesh says how big it is
+            if (index.size() != placements.size()) {
+                index.clear();
+                for (size_t i = 0; i < placements.size(); i++) {
+                    glm::vec3 center = glm::vec3(placements[i] * glm::vec4(mesh->boundsCenter, 1.0f));
+                    index.insert(center, mesh->boundsRadius * 0.01f, (uint32_t)i);
+                }
+            }
+            culler.cull(index, visibleIndices);
+            const SphereSoA &bounds = culler.visibleBounds();
 
-            CheckOpenGLErrors("House::render - before uniform");
+            // Each visible house at the detail its distance allows; the batch sorts them into levels
+            batch.beginFrame(mesh);
+            float nearest = std::numeric_limits<float>::max();
+            for (size_t k = 0; k < visibleIndices.size(); k++) {
+                glm::vec3 center(bounds.x[k], bounds.y[k], bounds.z[k]);
+                batch.add(placements[visibleIndices[k]], lodSelector.select(mesh->lods, center, bounds.radius[k], 0.01f));
 
-            glBindVertexArray(0);
-            glDisableVertexAttribArray(0);
-            glDisableVertexAttribArray(1);
-            glDisableVertexAttribArray(2);
-        }
+                nearest = std::min(nearest, (cameraMatrix * glm::vec4(center, 1.0f)).w);
+            }
 
-        ~House(){
-            glDeleteBuffers(1, &vertexBufferID);
-            glDeleteBuffers(1, &uvBufferID);
-            glDeleteBuffers(1, &indexBufferID);
-            glDeleteBuffers(1, &normalBufferID);
-            glDeleteVertexArrays(1, &vertexArrayID);
-            glDeleteProgram(programID);
+            DrawPacket packet;
+            packet.programID = programID;
+            packet.textureID = diffuseTexture ? diffuseTexture->textureID : 0;
+            packet.setup = &House::setupDraw;
+            packet.object = this;
+            batch.submit(queue, packet, RenderPass::Opaque, nearest);
         }
-};
\ No newline at end of file
+};
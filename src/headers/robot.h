@@ -3,634 +3,434 @@
 
 class Robot {
 	// Shader variable IDs
-	GLuint mvpMatrixID;
 	GLuint jointMatricesID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
 	GLuint programID;
 
-    glm::vec3 position;
-    GLfloat angle;
+	// Palette layout the current program was compiled for, and the size of its
+	// JointPalette block
+	SkinningMode programMode = SkinningMode::Matrix4x4;
+	GLint jointPaletteSize = 0;
 
-    glm::vec3 lightPosition;
-    glm::vec3 lightIntensity;
+	// What submit left for setupDraw: where the Object block was staged, and
+	// either the joint matrices for the 4x4 path or where the packed palette was
+	const std::vector<glm::mat4> *frameJoints = nullptr;
+	GLintptr objectOffset = 0;
+	GLintptr paletteOffset = 0;
+	float paletteScale = 1.0f;
 
-	tinygltf::Model model;
+	// Packing scratch for stageJoints, kept for its capacity
+	std::vector<glm::vec4> palette;
 
-	// Each VAO corresponds to each mesh primitive in the GLTF model
-	struct PrimitiveObject {
-		GLuint vertexArrayObject;
-		std::map<int, GLuint> vertexBufferObjects;
-	};
-	std::vector<PrimitiveObject> primitiveObjects;
+    glm::vec3 position;
+    GLfloat angle;
 
-    struct MeshData{
-        std::vector<int> primitiveIndices;
-    };
-    std::vector<MeshData> allMeshData;
+	// Shared by every robot through the AssetCache: mesh, skeletons and clips
+	// in the model, which is never written after upload
+	std::shared_ptr<GltfModel> modelAsset;
+	std::shared_ptr<ProgramAsset> program;
 
-	// Skinning
+	// Per-instance state: where each track's keyframe search left off, and the
+	// joint matrices the last update produced for each skin. The reduced tier
+	// also keeps its last two samples to blend between.
+	std::vector<uint32_t> keyframeCursors;
 	struct SkinObject {
-		std::vector<glm::mat4> inverseBindMatrices;
-		std::vector<glm::mat4> globalJointTransforms;
 		std::vector<glm::mat4> jointMatrices;
+		std::vector<glm::mat4> previousSample;
+		std::vector<glm::mat4> latestSample;
 	};
 	std::vector<SkinObject> skinObjects;
 
-	// Animation
-	struct AnimationSamplerObject {
-		std::vector<float> input;
-		std::vector<glm::vec4> output;
-		int interpolation;
-	};
-	struct AnimationChannelObject {
-		int sampler;
-		std::string targetPath;
-		int targetNode;
+	// Animation level of detail, picked each frame by selectAnimationTier
+	AnimationTier tier = AnimationTier::Full;
+	bool reducedSampleDue = true;
+	float previousSampleTime = 0.0f;
+	float latestSampleTime = -1.0f;		// negative until the reduced tier has sampled
+	unsigned phase;
+
+	// The pose every Shared-tier robot draws with, sampled once per frame
+	struct SharedPose {
+		std::weak_ptr<GltfModel> model;
+		std::vector<uint32_t> keyframeCursors;
+		std::vector<SkinObject> skinObjects;
 	};
-	struct AnimationObject {
-		std::vector<AnimationSamplerObject> samplers;	// Animation data
-		std::vector<AnimationChannelObject> channels;	// Animation channels
+	static SharedPose &sharedPose() {
+		static SharedPose pose;
+		return pose;
+	}
+
+	// Skinned bounds in model space: the rig is about 180 units tall along -z
+	// before the model matrix stands it up and scales it down
+	static inline const glm::vec3 boundsCenter = glm::vec3(0.0f, 0.0f, -90.0f);
+	static constexpr float boundsRadius = 100.0f;
+	static constexpr float modelScale = 0.025f;
+
+	// Sampling and propagation scratch, reused by every robot updated on a thread
+	struct AnimationScratch {
+		AnimationPose pose;
+		std::vector<glm::mat4> globalTransforms;
 	};
-	std::vector<AnimationObject> animationObjects;
+	static AnimationScratch &animationScratch() {
+		static thread_local AnimationScratch scratch;
+		return scratch;
+	}
+
+	// Layout every robot packs its joints in, switched at runtime to compare them
+	static SkinningMode &requestedSkinningMode() {
+		static SkinningMode mode = SkinningMode::Affine3x4;
+		return mode;
+	}
+
+	// Models whose poses turned out to need more than dual quaternions hold,
+	// recorded the first time packing one fails
+	static std::vector<std::weak_ptr<GltfModel>> &dualQuaternionUnsupported() {
+		static std::vector<std::weak_ptr<GltfModel>> models;
+		return models;
+	}
+
+	// The requested layout, or 3x4 once this robot's model is known to need it
+	SkinningMode effectiveSkinningMode() const {
+		SkinningMode mode = requestedSkinningMode();
+		if (mode != SkinningMode::DualQuaternion || !modelAsset) {
+			return mode;
+		}
+		for (const std::weak_ptr<GltfModel> &model : dualQuaternionUnsupported()) {
+			if (model.lock() == modelAsset) {
+				return SkinningMode::Affine3x4;
+			}
+		}
+		return mode;
+	}
+
+	// Samples the model's first clip at time into each skin's joint matrices,
+	// or into latestSample when toSamples is set
+	static void sampleSkins(const GltfModel &model, float time, std::vector<uint32_t> &keyframeCursors,
+	                        std::vector<SkinObject> &skinObjects, bool toSamples) {
+		// No allocation here once this thread's scratch has grown to the model
+		AnimationScratch &scratch = animationScratch();
+		scratch.pose.resize(model.nodes.size());
+		sampleAnimationClip(model.animations[0], time, keyframeCursors.data(), scratch.pose);
+
+		// One linear pass per skin over the shared skeleton; globals are scratch
+		std::vector<glm::mat4> &globalTransforms = scratch.globalTransforms;
+		for(size_t i=0; i<skinObjects.size(); i++){
+			const Skeleton &skeleton = model.skins[i];
+			if (globalTransforms.size() < skeleton.nodes.size()) {
+				globalTransforms.resize(skeleton.nodes.size());
+			}
+			std::vector<glm::mat4> &out = toSamples ? skinObjects[i].latestSample : skinObjects[i].jointMatrices;
+			computeJointMatrices(skeleton, scratch.pose.localTransforms.data(), globalTransforms.data(), out.data());
+		}
+	}
 
     private:
-        glm::mat4 getNodeTransform(const tinygltf::Node& node) {
-            glm::mat4 transform(1.0f);
-
-            if (node.matrix.size() == 16) {
-                transform = glm::make_mat4(node.matrix.data());
-            } else {
-                if (node.translation.size() == 3) {
-                    transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
-                }
-                if (node.rotation.size() == 4) {
-                    glm::quat q(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
-                    transform *= glm::mat4_cast(q);
-                }
-                if (node.scale.size() == 3) {
-                    transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
-                }
-            }
-            return transform;
-        }
-
-        void computeLocalNodeTransform(const tinygltf::Model& model,
-            int nodeIndex,
-            std::vector<glm::mat4> &localTransforms){
-            const tinygltf::Node &node = model.nodes[nodeIndex];
-
-            localTransforms[nodeIndex] = getNodeTransform(node);
-
-            if(!node.children.empty()){
-                for(int childNode: node.children){
-                    computeLocalNodeTransform(model, childNode, localTransforms);
-                }
-            }
-        }
-
-        void computeGlobalNodeTransform(const tinygltf::Model& model,
-            const std::vector<glm::mat4> &localTransforms,
-            int nodeIndex, const glm::mat4& parentTransform,
-            std::vector<glm::mat4> &globalTransforms){
-            // Find the global transformations
-            globalTransforms[nodeIndex] = parentTransform * localTransforms[nodeIndex];
-
-            // Now going to the children node
-            const tinygltf::Node &node = model.nodes[nodeIndex];
-            if(!node.children.empty()){
-                for(int childNode: node.children){
-                    computeGlobalNodeTransform(model, localTransforms, childNode, globalTransforms[nodeIndex], globalTransforms);
-                }
-            }
-        }
-
-        std::vector<SkinObject> prepareSkinning(const tinygltf::Model &model) {
+        std::vector<SkinObject> prepareSkinning(const GltfModel &model) {
             std::vector<SkinObject> skinObjects;
 
+            // Rest pose, indexed by node
+            std::vector<glm::mat4> localTransforms(model.nodes.size());
+            for (size_t i = 0; i < model.nodes.size(); i++) {
+                localTransforms[i] = model.nodes[i].localTransform;
+            }
 
-            for (size_t i = 0; i < model.skins.size(); i++) {
+            for (const Skeleton &skeleton : model.skins) {
                 SkinObject skinObject;
+                skinObject.jointMatrices.resize(skeleton.jointCount());
 
-                const tinygltf::Skin &skin = model.skins[i];
-
-                // Read inverseBindMatrices
-                const tinygltf::Accessor &accessor = model.accessors[skin.inverseBindMatrices];
-                assert(accessor.type == TINYGLTF_TYPE_MAT4);
-                const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-                const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-                const float *ptr = reinterpret_cast<const float *>(
-                    buffer.data.data() + accessor.byteOffset + bufferView.byteOffset);
-
-                skinObject.inverseBindMatrices.resize(accessor.count);
-                for (size_t j = 0; j < accessor.count; j++) {
-                    float m[16];
-                    memcpy(m, ptr + j * 16, 16 * sizeof(float));
-                    skinObject.inverseBindMatrices[j] = glm::make_mat4(m);
-                }
-
-                assert(skin.joints.size() == accessor.count);
-
-                skinObject.globalJointTransforms.resize(model.nodes.size());
-                skinObject.jointMatrices.resize(model.nodes.size());
-
-                std::vector<glm::mat4> localTransforms(model.nodes.size());
-                std::vector<glm::mat4> globalTransforms(model.nodes.size());
-
-                int rootNodeIndex = skin.joints[0];
-
-                // Compute local transforms at each node
-                computeLocalNodeTransform(model, rootNodeIndex, localTransforms);
-
-                // Compute global transforms at each node
-                computeGlobalNodeTransform(model, localTransforms, rootNodeIndex, glm::mat4(1.0f), globalTransforms);
-                skinObject.globalJointTransforms = globalTransforms;
-
-                for(size_t j=0; j<skin.joints.size(); j++){
-                    int jointNodeIndex = skin.joints[j];
-                    skinObject.jointMatrices[j] = skinObject.globalJointTransforms[jointNodeIndex] * skinObject.inverseBindMatrices[j];
-                }
+                std::vector<glm::mat4> globalTransforms(skeleton.nodes.size());
+                computeJointMatrices(skeleton, localTransforms.data(), globalTransforms.data(), skinObject.jointMatrices.data());
 
                 skinObjects.push_back(skinObject);
             }
             return skinObjects;
         }
 
-        // Called once after model is loaded
-        void bindModel(tinygltf::Model &model){
-            allMeshData.resize(model.meshes.size());
+        // Packs the joints into this program's palette layout and stages them for
+        // the frame's palette upload; the 4x4 path sets them as uniforms at draw time
+        void stageJoints(const std::vector<glm::mat4> &jointMatrices) {
+            if (programMode == SkinningMode::Matrix4x4) {
+                UniformStream::instance().countUniformUpload(jointMatrices.size() * sizeof(glm::mat4));
+                return;
+            }
 
-            const tinygltf::Scene &scene = model.scenes[model.defaultScene];
-            for (int rootNodeIndex : scene.nodes) {
-                bindModelNodes(model, rootNodeIndex);
+            if (!packJointPalette(programMode, jointMatrices.data(), jointMatrices.size(), palette, paletteScale)) {
+                // Sheared or unevenly scaled joints have no dual quaternion form;
+                // every robot of this model uses 3x4 from now on
+                std::vector<std::weak_ptr<GltfModel>> &unsupported = dualQuaternionUnsupported();
+                unsupported.erase(std::remove_if(unsupported.begin(), unsupported.end(),
+                                                 [](const std::weak_ptr<GltfModel> &model) { return model.expired(); }),
+                                  unsupported.end());
+                unsupported.push_back(modelAsset);
+                loadProgram(SkinningMode::Affine3x4);
+                packJointPalette(programMode, jointMatrices.data(), jointMatrices.size(), palette, paletteScale);
             }
+            paletteOffset = UniformStream::instance().stage(palette.data(), palette.size() * sizeof(glm::vec4), jointPaletteSize);
         }
-        // Recursively process a node and its children
-        void bindModelNodes(tinygltf::Model &model, int nodeIndex){
-            const tinygltf::Node &node = model.nodes[nodeIndex];
 
-            // If this node references a mesh, bind it
-            if (node.mesh >= 0 && node.mesh < (int)model.meshes.size()) {
-                bindMesh(model, node.mesh);
-            }
+        // Per-robot uniforms, called by the render queue before this robot's draws
+        static void setupDraw(const void *object) {
+            const Robot &robot = *static_cast<const Robot *>(object);
+            bindObjectUniforms(robot.objectOffset);
 
-            // Then recurse for children
-            for (int childIndex : node.children) {
-                bindModelNodes(model, childIndex);
+            if (robot.programMode == SkinningMode::Matrix4x4) {
+                const std::vector<glm::mat4> &joints = *robot.frameJoints;
+                glUniformMatrix4fv(robot.jointMatricesID, joints.size(), GL_FALSE, glm::value_ptr(joints[0]));
+            } else {
+                UniformStream::instance().bindRange(kJointPaletteBinding, robot.paletteOffset, robot.jointPaletteSize);
             }
         }
 
-        void bindMesh(tinygltf::Model &model, int meshIndex){
-            // Retrieve the glTF mesh
-            tinygltf::Mesh &mesh = model.meshes[meshIndex];
-            // Reference to the MeshData entry for this mesh
-            MeshData &meshData = allMeshData[meshIndex];
-
-            size_t startIndex = primitiveObjects.size();
-
-            for (size_t p = 0; p < mesh.primitives.size(); p++) {
-                const tinygltf::Primitive &primitive = mesh.primitives[p];
-
-                GLuint vao;
-                glGenVertexArrays(1, &vao);
-                glBindVertexArray(vao);
-
-                std::map<int, GLuint> vbos;
-
-                for (auto &attrib : primitive.attributes) {
-                    int accessorIndex = attrib.second;
-                    const tinygltf::Accessor &accessor = model.accessors[accessorIndex];
-                    const tinygltf::BufferView &bv = model.bufferViews[accessor.bufferView];
-                    const tinygltf::Buffer &buf = model.buffers[bv.buffer];
-
-                    if (vbos.find(accessor.bufferView) == vbos.end()) {
-                        GLuint vbo;
-                        glGenBuffers(1, &vbo);
-                        glBindBuffer(bv.target, vbo);
-                        glBufferData(bv.target, bv.byteLength,
-                                    &buf.data[bv.byteOffset], GL_STATIC_DRAW);
-                        vbos[accessor.bufferView] = vbo;
-                    } else {
-                        glBindBuffer(bv.target, vbos[accessor.bufferView]);
-                    }
+        glm::mat4 getModelMatrix() const {
+            return modelMatrixAt(position, angle);
+        }
 
-                    // Now set up glVertexAttribPointer
-                    int byteStride = accessor.ByteStride(bv);
-                    int size = 1;
-                    if (accessor.type != TINYGLTF_TYPE_SCALAR) {
-                        size = accessor.type;
-                    }
-                    int location = -1;
-                    if (attrib.first == "POSITION")  location = 0;
-                    if (attrib.first == "NORMAL")    location = 1;
-                    if (attrib.first == "TEXCOORD_0")location = 2;
-                    if (attrib.first == "JOINTS_0")  location = 3;
-                    if (attrib.first == "WEIGHTS_0") location = 4;
-                    if (attrib.first == "COLOR_0")   location = 5;
-
-                    if (location >= 0) {
-                        glEnableVertexAttribArray(location);
-                        glVertexAttribPointer(location,
-                                            size,
-                                            accessor.componentType,
-                                            accessor.normalized ? GL_TRUE : GL_FALSE,
-                                            byteStride,
-                                            (void*)(uintptr_t)accessor.byteOffset);
-                    }
+        // Reduced tier: samples every few frames and blends the last two samples,
+        // so the pose trails real time by one interval but moves every frame
+        void updateReduced(float time) {
+            if (latestSampleTime < 0.0f || reducedSampleDue) {
+                bool entering = latestSampleTime < 0.0f;
+                for (SkinObject &skinObject : skinObjects) {
+                    skinObject.previousSample.swap(skinObject.latestSample);
+                    skinObject.latestSample.resize(skinObject.jointMatrices.size());
                 }
+                sampleSkins(*modelAsset, time, keyframeCursors, skinObjects, true);
 
-                {
-                    const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
-                    const tinygltf::BufferView &ibv = model.bufferViews[indexAccessor.bufferView];
-                    const tinygltf::Buffer &ibuf = model.buffers[ibv.buffer];
-
-                    if (vbos.find(indexAccessor.bufferView) == vbos.end()) {
-                        GLuint ibo;
-                        glGenBuffers(1, &ibo);
-                        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-                        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                                    ibv.byteLength,
-                                    &ibuf.data[ibv.byteOffset],
-                                    GL_STATIC_DRAW);
-                        vbos[indexAccessor.bufferView] = ibo;
-                    } else {
-                        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbos[indexAccessor.bufferView]);
+                // Nothing older to blend from right after entering the tier
+                if (entering) {
+                    for (SkinObject &skinObject : skinObjects) {
+                        skinObject.previousSample = skinObject.latestSample;
                     }
+                    previousSampleTime = time;
+                } else {
+                    previousSampleTime = latestSampleTime;
                 }
-
-                glBindVertexArray(0);
-
-                PrimitiveObject primObj;
-                primObj.vertexArrayObject = vao;
-                primObj.vertexBufferObjects = vbos;
-
-                primitiveObjects.push_back(primObj);
+                latestSampleTime = time;
             }
 
-            // Now record which globalPrimitives indices belong to this mesh:
-            for (size_t p = 0; p < mesh.primitives.size(); p++) {
-                // The newly pushed-back primitives start at startIndex
-                meshData.primitiveIndices.push_back((int)(startIndex + p));
+            float span = latestSampleTime - previousSampleTime;
+            float blend = span > 0.0f ? glm::clamp((time - latestSampleTime) / span, 0.0f, 1.0f) : 1.0f;
+            for (SkinObject &skinObject : skinObjects) {
+                for (size_t j = 0; j < skinObject.jointMatrices.size(); j++) {
+                    const glm::mat4 &from = skinObject.previousSample[j];
+                    const glm::mat4 &to = skinObject.latestSample[j];
+                    for (int c = 0; c < 4; c++) {
+                        skinObject.jointMatrices[j][c] = glm::mix(from[c], to[c], blend);
+                    }
+                }
             }
         }
 
-        std::vector<AnimationObject> prepareAnimation(const tinygltf::Model &model){
-            std::vector<AnimationObject> animationObjects;
-            for (const auto &anim : model.animations) {
-                AnimationObject animationObject;
-
-                for (const auto &sampler : anim.samplers) {
-                    AnimationSamplerObject samplerObject;
-
-                    const tinygltf::Accessor &inputAccessor = model.accessors[sampler.input];
-                    const tinygltf::BufferView &inputBufferView = model.bufferViews[inputAccessor.bufferView];
-                    const tinygltf::Buffer &inputBuffer = model.buffers[inputBufferView.buffer];
-
-                    assert(inputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-                    assert(inputAccessor.type == TINYGLTF_TYPE_SCALAR);
-
-                    // Input (time) values
-                    samplerObject.input.resize(inputAccessor.count);
-
-                    const unsigned char *inputPtr = &inputBuffer.data[inputBufferView.byteOffset + inputAccessor.byteOffset];
-                    const float *inputBuf = reinterpret_cast<const float*>(inputPtr);
-
-                    // Read input (time) values
-                    int stride = inputAccessor.ByteStride(inputBufferView);
-                    for (size_t i = 0; i < inputAccessor.count; ++i) {
-                        samplerObject.input[i] = *reinterpret_cast<const float*>(inputPtr + i * stride);
-                    }
-
-                    const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-                    const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-                    const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
+        // Compiles robot.vert for mode; every robot using the same mode shares the program
+        void loadProgram(SkinningMode mode) {
+            // Create and compile our GLSL program from the shaders
+            program = AssetCache::instance().program("../src/shaders/robot.vert", "../src/shaders/robot.frag",
+                                                     skinningModeDefine(mode));
+            programMode = mode;
+            if (!program)
+            {
+                std::cerr << "Failed to load shaders." << std::endl;
+                return;
+            }
+            programID = program->programID;
 
-                    assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+            CheckOpenGLErrors("Loading shaders");
 
-                    const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
-                    const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
+            // Frame and Object are bound by the loader; only the palette is left
+            jointMatricesID = glGetUniformLocation(programID, "u_jointMatrix");
 
-                    int outputStride = outputAccessor.ByteStride(outputBufferView);
+            jointPaletteSize = 0;
+            GLuint paletteBlock = glGetUniformBlockIndex(programID, "JointPalette");
+            if (paletteBlock != GL_INVALID_INDEX) {
+                glUniformBlockBinding(programID, paletteBlock, kJointPaletteBinding);
+                glGetActiveUniformBlockiv(programID, paletteBlock, GL_UNIFORM_BLOCK_DATA_SIZE, &jointPaletteSize);
+            }
 
-                    // Output values
-                    samplerObject.output.resize(outputAccessor.count);
+            CheckOpenGLErrors("Getting shader variables");
+        }
 
-                    for (size_t i = 0; i < outputAccessor.count; ++i) {
+        void initialize() {
+            loadProgram(requestedSkinningMode());
+
+            // Parsing runs on a loader thread, straight from the mapped file; only
+            // the buffer upload happens on this one. The cooked .glb is preferred.
+            std::string modelPath = "../src/assets/models/bot/waving.gltf";
+            AssetCache::instance().acquireAsync<GltfModel>("gltf", modelPath, [modelPath]() -> AssetCache::Upload<GltfModel> {
+                size_t size = 0;
+                const unsigned char *blob = AssetPack::instance().find(assetKey(modelPath), AssetType::Gltf, modelPath, size);
+                return prepareGltfModel(modelPath, blob, size);
+            }, [this](std::shared_ptr<GltfModel> loaded){
+                if(!loaded || loaded->skins.empty()){
+                    return;
+                }
+                CheckOpenGLErrors("Loading model buffers");
 
-                        if (outputAccessor.type == TINYGLTF_TYPE_VEC3) {
-                            memcpy(&samplerObject.output[i], outputPtr + i * 3 * sizeof(float), 3 * sizeof(float));
-                        } else if (outputAccessor.type == TINYGLTF_TYPE_VEC4) {
-                            memcpy(&samplerObject.output[i], outputPtr + i * 4 * sizeof(float), 4 * sizeof(float));
-                        } else {
-                            std::cout << "Unsupport accessor type ..." << std::endl;
-                        }
+                // Prepare joint matrices
+                skinObjects = prepareSkinning(*loaded);
+                keyframeCursors.assign(loaded->animations.empty() ? 0 : loaded->animations[0].tracks.size(), 0);
 
-                    }
+                modelAsset = loaded;
 
-                    animationObject.samplers.push_back(samplerObject);
+                SharedPose &shared = sharedPose();
+                if (shared.model.expired()) {
+                    shared.model = loaded;
+                    shared.keyframeCursors = keyframeCursors;
+                    shared.skinObjects = skinObjects;
                 }
-
-                animationObjects.push_back(animationObject);
-            }
-            return animationObjects;
+            });
         }
 
-        void drawMesh(const tinygltf::Model &model, int meshIndex){
-            const tinygltf::Mesh &mesh = model.meshes[meshIndex];
+        static unsigned nextPhase() {
+            static unsigned robots = 0;
+            return robots++;
+        }
 
-            const std::vector<int> &primIndices = allMeshData[meshIndex].primitiveIndices;
+    public:
+        // Places the rig: it is authored lying along -z, about 180 units tall
+        static glm::mat4 modelMatrixAt(glm::vec3 position, GLfloat angle) {
+            glm::mat4 modelMatrix = glm::mat4(1.0f);
 
-            for (size_t p = 0; p < mesh.primitives.size(); p++) {
-                int primID = primIndices[p]; // index into globalPrimitives
-                const PrimitiveObject &primObj = primitiveObjects[primID];
+            // Translate the model
+            modelMatrix = glm::translate(modelMatrix, position);
 
-                glBindVertexArray(primObj.vertexArrayObject);
+            // Scale the model
+            modelMatrix = glm::scale(modelMatrix, glm::vec3(modelScale));
 
-                const tinygltf::Primitive &primitive = mesh.primitives[p];
-                const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
+            // Translate by Y axis
+            modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 10.0f, 0.0f));
 
-                GLuint ibo = primObj.vertexBufferObjects.at(indexAccessor.bufferView);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+            // Rotate by X axis
+            modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
-                // Draw
-                glDrawElements(primitive.mode,
-                            indexAccessor.count,
-                            indexAccessor.componentType,
-                            (void*)(uintptr_t)indexAccessor.byteOffset);
+            // Rotation by Y axis
+            modelMatrix = glm::rotate(modelMatrix, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
 
-                glBindVertexArray(0);
-             }
+            return modelMatrix;
         }
 
-        void drawModelNodes(const tinygltf::Model &model, int nodeIndex){
-            const tinygltf::Node &node = model.nodes[nodeIndex];
-
-            // If this node references a mesh, draw it
-            if (node.mesh >= 0 && node.mesh < (int)model.meshes.size()) {
-                drawMesh(model, node.mesh);
-            }
+        // Bounding sphere of a robot placed with modelMatrix, whatever its pose
+        static void worldBounds(const glm::mat4 &modelMatrix, glm::vec3 &center, float &radius) {
+            center = glm::vec3(modelMatrix * glm::vec4(boundsCenter, 1.0f));
+            radius = boundsRadius * modelScale;
+        }
 
-            // Recurse on children
-            for (int childIndex : node.children) {
-                drawModelNodes(model, childIndex);
-            }
+        // This robot's bounding sphere where it stands now
+        void bounds(glm::vec3 &center, float &radius) const {
+            worldBounds(getModelMatrix(), center, radius);
         }
 
-        void drawModel(const tinygltf::Model &model){
-            const tinygltf::Scene &scene = model.scenes[model.defaultScene];
+        Robot(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), GLfloat angle = 0.0f) {
+            this->position = position;
+            this->angle = angle;
+            this->phase = nextPhase();
+            initialize();
+        }
 
-            // For each root node in the scene
-            for (int rootNodeIndex : scene.nodes) {
-                drawModelNodes(model, rootNodeIndex);
+        // Picks this frame's tier; called on one thread, before update
+        void selectAnimationTier(AnimationLodSelector &selector) {
+            glm::vec3 center;
+            float radius;
+            worldBounds(getModelMatrix(), center, radius);
+            tier = selector.select(center, radius);
+            reducedSampleDue = selector.reducedSampleDue(phase);
+            if (tier != AnimationTier::Reduced) {
+                latestSampleTime = -1.0f;
             }
         }
 
-        int findKeyframeIndex(const std::vector<float>& times, float animationTime){
-            int left = 0;
-            int right = times.size() - 1;
-
-            while (left <= right) {
-                int mid = (left + right) / 2;
+        static void setSkinningMode(SkinningMode mode) { requestedSkinningMode() = mode; }
+        static SkinningMode skinningMode() { return requestedSkinningMode(); }
 
-                if (mid + 1 < times.size() && times[mid] <= animationTime && animationTime < times[mid + 1]) {
-                    return mid;
-                }
-                else if (times[mid] > animationTime) {
-                    right = mid - 1;
-                }
-                else { // animationTime >= times[mid + 1]
-                    left = mid + 1;
-                }
+        // Samples the pose used by every Shared-tier robot
+        static void updateSharedPose(float time) {
+            SharedPose &shared = sharedPose();
+            std::shared_ptr<GltfModel> model = shared.model.lock();
+            if (model && !model->animations.empty()) {
+                sampleSkins(*model, time, shared.keyframeCursors, shared.skinObjects, false);
             }
-
-            // Target not found
-            return times.size() - 2;
         }
 
-        void updateAnimation(
-            const tinygltf::Model &model,
-            const tinygltf::Animation &anim,
-            const AnimationObject &animationObject,
-            float time,
-            std::vector<glm::mat4> &nodeTransforms)
-        {
-            for (const auto &channel : anim.channels) {
-
-                int targetNodeIndex = channel.target_node;
-                const auto &sampler = anim.samplers[channel.sampler];
-
-                // Access output (value) data for the channel
-                const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-                const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-                const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
-
-                // Calculate current animation time (wrap if necessary)
-                const std::vector<float> &times = animationObject.samplers[channel.sampler].input;
-                float animationTime = fmod(time, times.back());
-
-                int keyframeIndex = this->findKeyframeIndex(times, animationTime);
-
-                const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
-                const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
-
-
-                float t0 = times[keyframeIndex];
-                float t1 = times[keyframeIndex+1];
-
-                float factor = (animationTime  - t1)/ (t1 - t0);
-
-                if (channel.target_path == "translation") {
-                    glm::vec3 translation0, translation1;
-                    memcpy(&translation0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-                    memcpy(&translation1, outputPtr + (keyframeIndex+1) * 3 * sizeof(float), 3 * sizeof(float));
+        void update(float time) {
+            if(!modelAsset || modelAsset->animations.empty()){
+                return;
+            }
 
-                    glm::vec3 translation;
-                    if(sampler.interpolation=="STEP"){
-                        translation = translation1;
-                    } else if(sampler.interpolation=="LINEAR"){
-                        translation = glm::mix(translation0,translation1,factor);
-                    }
-                    nodeTransforms[targetNodeIndex] = glm::translate(nodeTransforms[targetNodeIndex], translation);
-                } else if (channel.target_path == "rotation") {
-                    glm::quat rotation0, rotation1;
-                    memcpy(&rotation0, outputPtr + keyframeIndex * 4 * sizeof(float), 4 * sizeof(float));
-                    memcpy(&rotation1, outputPtr + (keyframeIndex+1) * 4 * sizeof(float), 4 * sizeof(float));
-
-                    glm::quat rotation;
-                    if(sampler.interpolation=="STEP"){
-                        rotation = rotation1;
-                    } else if(sampler.interpolation=="LINEAR"){
-                        rotation = glm::slerp(rotation0,rotation1,factor);
-                    }
-                    nodeTransforms[targetNodeIndex] *= glm::mat4_cast(rotation);
-                } else if (channel.target_path == "scale") {
-                    glm::vec3 scale0, scale1;
-                    memcpy(&scale0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-                    memcpy(&scale1, outputPtr + (keyframeIndex+1) * 3 * sizeof(float), 3 * sizeof(float));
-
-                    glm::vec3 scale;
-                    if(sampler.interpolation=="STEP"){
-                        scale = scale1;
-                    } else if(sampler.interpolation=="LINEAR"){
-                        scale = glm::mix(scale0,scale1,factor);
-                    }
-                    nodeTransforms[targetNodeIndex] = glm::scale(nodeTransforms[targetNodeIndex], scale);
-                }
+            switch (tier) {
+                case AnimationTier::Full:
+                    sampleSkins(*modelAsset, time, keyframeCursors, skinObjects, false);
+                    break;
+                case AnimationTier::Reduced:
+                    updateReduced(time);
+                    break;
+                case AnimationTier::Shared:
+                case AnimationTier::Culled:
+                    // Sampling is by absolute time, so there is nothing to advance
+                    break;
             }
         }
 
-        void updateSkinning(const std::vector<glm::mat4> &nodeTransforms) {
-            for(size_t i=0; i<skinObjects.size(); i++){
-                const tinygltf::Skin &skin = model.skins[i];
-
-                std::vector<glm::mat4> globalNodeTransforms(model.nodes.size());
-
-                int rootNodeIndex = skin.joints[0];
-
-                computeGlobalNodeTransform(model, nodeTransforms, rootNodeIndex, glm::mat4(1.0f), globalNodeTransforms);
-                skinObjects[i].globalJointTransforms = globalNodeTransforms;
-
-                for(size_t j=0; j<skin.joints.size(); j++){
-                    int jointIndex = skin.joints[j];
-                    skinObjects[i].jointMatrices[j] = skinObjects[i].globalJointTransforms[jointIndex] * skinObjects[i].inverseBindMatrices[j];
-                }
+        // Memory owned by this robot alone, not counting the shared model and program
+        size_t instanceBytes() const {
+            size_t bytes = sizeof(*this) + keyframeCursors.capacity() * sizeof(uint32_t) +
+                           skinObjects.capacity() * sizeof(SkinObject) + palette.capacity() * sizeof(glm::vec4);
+            for (const SkinObject &skinObject : skinObjects) {
+                bytes += (skinObject.jointMatrices.capacity() + skinObject.previousSample.capacity() +
+                          skinObject.latestSample.capacity()) * sizeof(glm::mat4);
             }
-
+            return bytes;
         }
 
-        bool loadModel(tinygltf::Model &model, const char *filename) {
-            tinygltf::TinyGLTF loader;
-            std::string err;
-            std::string warn;
-
-            bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
-
-            if (!warn.empty()) {
-                std::cout << "WARN: " << warn << std::endl;
+        // Queues one packet per model draw; called for the robots the scene index
+        // found in view
+        void submit(RenderQueue &queue, glm::mat4 cameraMatrix) {
+            SkinningMode mode = effectiveSkinningMode();
+            if (programMode != mode) {
+                loadProgram(mode);
             }
-
-            if (!err.empty()) {
-                std::cout << "ERR: " << err << std::endl;
+            if(!modelAsset || !program){
+                return;
             }
-
-            if (!res)
-                std::cout << "Failed to load glTF: " << filename << std::endl;
-            else
-                std::cout << "Loaded glTF: " << filename << std::endl;
-
-
-            return res;
-        }
-
-        void initialize() {
-            if(!loadModel(model, "../src/assets/models/bot/waving.gltf")){
+            if (tier == AnimationTier::Culled) {
                 return;
             }
 
-            // Prepare buffers for rendering
-            bindModel(model);
-
-            // Prepare joint matrices
-            skinObjects = prepareSkinning(model);
-
-            // Prepare animation data
-            animationObjects = prepareAnimation(model);
-
-
-            CheckOpenGLErrors("Loading model buffers");
-
-            // Create and compile our GLSL program from the shaders
-            programID = LoadShadersFromFile("../src/shaders/robot.vert", "../src/shaders/robot.frag");
-            if (programID == 0)
-            {
-                std::cerr << "Failed to load shaders." << std::endl;
+            // The shader takes one palette, so the last skin wins
+            const std::vector<SkinObject> &skins = tier == AnimationTier::Shared ? sharedPose().skinObjects : skinObjects;
+            frameJoints = nullptr;
+            for (const SkinObject &skin : skins) {
+                if (!skin.jointMatrices.empty()) {
+                    frameJoints = &skin.jointMatrices;
+                }
             }
-
-            CheckOpenGLErrors("Loading shaders");
-
-            // Get a handle for GLSL variables
-            mvpMatrixID = glGetUniformLocation(programID, "MVP");
-            lightPositionID = glGetUniformLocation(programID, "lightPosition");
-            lightIntensityID = glGetUniformLocation(programID, "lightIntensity");
-            jointMatricesID = glGetUniformLocation(programID, "u_jointMatrix");
-
-            CheckOpenGLErrors("Getting shader variables");
-        }
-
-    public:
-        Robot(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), GLfloat angle = 0.0f, glm::vec3 lightPosition = glm::vec3(-275.0f, 500.0f, 800.0f), glm::vec3 lightIntensity = glm::vec3(5e6, 5e6, 5e6)) {
-            this->position = position;
-            this->angle = angle;
-            this->lightPosition = lightPosition;
-            this->lightIntensity = lightIntensity;
-            initialize();
-        }
-
-        void update(float time) {
-            if(model.animations.empty()){
+            if (!frameJoints) {
                 return;
             }
-
-            const tinygltf::Animation &anim = model.animations[0];
-            const AnimationObject &animationObject = animationObjects[0];
-
-
-            const tinygltf::Skin &skin = model.skins[0];
-            std::vector<glm::mat4> nodeTransforms(skin.joints.size());
-            for(size_t i=0; i<nodeTransforms.size(); i++){
-                nodeTransforms[i] = glm::mat4(1.0);
+            // May fall back to another program, so this comes before the packets
+            stageJoints(*frameJoints);
+            if (!program) {
+                return;
             }
 
-            updateAnimation(model, anim, animationObject, time, nodeTransforms);
-
-            updateSkinning(nodeTransforms);
-        }
-
-	    void render(glm::mat4 cameraMatrix) {
-            glUseProgram(programID);
-
-            // Set model matrix
-            glm::mat4 modelMatrix = glm::mat4(1.0f);
-
-            // Translate the model
-            modelMatrix = glm::translate(modelMatrix, position);
-
-            // Scale the model
-            modelMatrix = glm::scale(modelMatrix, glm::vec3(0.025f));
-
-            // Translate by Y axis
-            modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 10.0f, 0.0f));
-
-            // Rotate by X axis
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-
-            // Rotation by Y axis
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
-
-            // Set camera
-            glm::mat4 mvp = cameraMatrix * modelMatrix;
-            glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-
-            CheckOpenGLErrors("Setting camera");
-
-            // First we set the joint matrices
-            for(size_t i=0; i<skinObjects.size(); i++){
-                glUniformMatrix4fv(jointMatricesID, skinObjects[i].jointMatrices.size(), GL_FALSE, glm::value_ptr(skinObjects[i].jointMatrices[0]));
+            ObjectUniforms object;
+            object.model = getModelMatrix();
+            object.params.y = paletteScale;
+            objectOffset = stageObjectUniforms(object);
+            float depth = (cameraMatrix * object.model * glm::vec4(boundsCenter, 1.0f)).w;
+
+            for (const GltfDraw &draw : modelAsset->draws) {
+                DrawPacket packet;
+                packet.programID = programID;
+                packet.vertexArrayID = draw.vertexArrayID;
+                packet.setup = &Robot::setupDraw;
+                packet.object = this;
+                packet.mode = draw.mode;
+                packet.indexCount = draw.indexCount;
+                packet.indexType = draw.indexType;
+                packet.indexOffset = draw.indexOffset;
+                queue.submit(packet, RenderPass::Opaque, depth);
             }
-
-            CheckOpenGLErrors("Animation data setup");
-
-            // -----------------------------------------------------------------
-
-            // Set light data
-            glUniform3fv(lightPositionID, 1, glm::value_ptr(lightPosition));
-            glUniform3fv(lightIntensityID, 1, glm::value_ptr(lightIntensity));
-
-            // Draw the GLTF model
-            drawModel(model);
         }
 
         void cleanup() {
-            glDeleteProgram(programID);
+            program.reset();
+            modelAsset.reset();
         }
 };
\ No newline at end of file
@@ -213,39 +213,15 @@ class Skybox{
     GLuint indexBufferID;
     GLuint colorBufferID;
     GLuint uvBufferID;
-    std::vector<GLuint> textureIDs;
+    // One texture per face, filled in as the loader finishes them
+    std::vector<std::shared_ptr<TextureAsset>> textures;
 
     // Shader variable IDs
-    GLuint mvpMatrixID;
     GLuint textureSamplerID;
     GLuint programID;
 
-    private:
-        GLuint LoadTextureTileBox(const char *texture_path) {
-            int w, h, channels;
-            GLuint texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-
-            uint8_t *img = stbi_load(texture_path, &w, &h, &channels, 3);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            // To tile textures on a box, we set wrapping to repeat
-            glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
-
-            if (img) {
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, img);
-                glGenerateMipmap(GL_TEXTURE_2D);
-            } else {
-                std::cout << "Failed to load texture " << texture_path << std::endl;
-            }
-            stbi_image_free(img);
-
-            return texture;
-        }
+    // Where submit staged this frame's Object block
+    GLintptr objectOffset = 0;
 
     public:
         Skybox(){
@@ -275,15 +251,27 @@ class Skybox{
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
             glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_buffer_data), index_buffer_data, GL_STATIC_DRAW);
 
+            // The vertex array records the layout, so drawing only binds it
+            glEnableVertexAttribArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+            glEnableVertexAttribArray(1);
+            glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+            glEnableVertexAttribArray(2);
+            glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+            glBindVertexArray(0);
+
             // Create and compile our GLSL program from the shaders
             programID = LoadShadersFromFile("../src/shaders/skybox.vert", "../src/shaders/skybox.frag");
             if (programID == 0) {
                 std::cerr << "Failed to load shaders." << std::endl;
             }
 
-            // Get a handle for our "MVP" uniform
-            mvpMatrixID = glGetUniformLocation(programID, "MVP");
-
             // Load the texture
             std::vector<std::string> faces = {
                 "../src/assets/skybox/pz.jpg",
@@ -294,32 +282,28 @@ class Skybox{
                 "../src/assets/skybox/ny.jpg",
             };
 
-            // textureID = LoadSkyboxTexture(faces)
-            for(int i=0; i<faces.size(); i++){
-                textureIDs.push_back(LoadTextureTileBox(faces[i].c_str()));
+            // Decoded on the loader threads, faces are drawn untextured until they arrive
+            textures.resize(faces.size());
+            for(size_t i=0; i<faces.size(); i++){
+                AssetCache::instance().textureAsync(faces[i], TextureOptions(), [this, i](std::shared_ptr<TextureAsset> loaded){
+                    textures[i] = loaded;
+                });
             }
 
-            // Get a handle to texture sampler
+            // Get a handle to texture sampler; every face is drawn from unit 0
             textureSamplerID = glGetUniformLocation(programID, "textureSampler");
-        }
-
-        void render(glm::mat4 cameraMatrix) {
-
             glUseProgram(programID);
+            glUniform1i(textureSamplerID, 0);
+        }
 
-            glBindVertexArray(vertexArrayID);
-
-            glEnableVertexAttribArray(0);
-            glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-            glEnableVertexAttribArray(1);
-            glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
+        static void setupDraw(const void *object) {
+            const Skybox &skybox = *static_cast<const Skybox *>(object);
+            bindObjectUniforms(skybox.objectOffset);
+        }
 
+        // One packet per face, each with its own texture, in the background pass.
+        // skybox.vert drops the view's translation, so the sky follows the camera.
+        void submit(RenderQueue &queue) {
             glm::mat4 modelMatrix = glm::mat4(1.0f);
 
             // Scale up the skybox by 100 times
@@ -328,45 +312,22 @@ class Skybox{
             // Rotate the matrix by -45 degrees around the Y axis
             modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(0, 1, 0));
 
-            // Complete the MVP transform
-            glm::mat4 mvp = cameraMatrix * modelMatrix;
-
-            // ------------------------------------
-            glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-
-            // Enable the UV buffer and texture sampler
-            glEnableVertexAttribArray(2);
-            glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-            // Bind the texture
-            for(int i=0; i<textureIDs.size(); i++){
-                glActiveTexture(GL_TEXTURE0 + i);
-                glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
-                glUniform1i(textureSamplerID, i);
-
-                // Draw the box
-                glDrawElementsBaseVertex(
-                    GL_TRIANGLES,
-                    6,
-                    GL_UNSIGNED_INT,
-                    (void *)(i * 6 * sizeof(GLuint)),
-                    0
-                );
-
-                // glDrawElements(
-                //     GL_TRIANGLES,    // mode
-                //     36,              // number of indices
-                //     GL_UNSIGNED_INT, // type
-                //     (void *)0        // element array buffer offset
-                // );
-
+            ObjectUniforms object;
+            object.model = modelMatrix;
+            objectOffset = stageObjectUniforms(object);
+
+            for(size_t i=0; i<textures.size(); i++){
+                DrawPacket packet;
+                packet.programID = programID;
+                packet.textureID = textures[i] ? textures[i]->textureID : 0;
+                packet.vertexArrayID = vertexArrayID;
+                packet.setup = &Skybox::setupDraw;
+                packet.object = this;
+                packet.indexCount = 6;
+                packet.indexType = GL_UNSIGNED_INT;
+                packet.indexOffset = i * 6 * sizeof(GLuint);
+                queue.submit(packet, RenderPass::Background, 0.0f);
             }
-
-            glBindVertexArray(0);
-            glDisableVertexAttribArray(0);
-            glDisableVertexAttribArray(1);
-            glDisableVertexAttribArray(2);
         }
 
         ~Skybox(){
@@ -375,11 +336,6 @@ class Skybox{
             glDeleteBuffers(1, &indexBufferID);
             glDeleteVertexArrays(1, &vertexArrayID);
             glDeleteBuffers(1, &uvBufferID);
-            // glDeleteBuffers(1, &textureID);
-            for(int i=0; i<textureIDs.size(); i++){
-                glDeleteTextures(1, &textureIDs[i]);
-                // glDeleteBuffers(1, &textureIDs[i]);
-            }
             glDeleteProgram(programID);
         }
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <obj/obj_loader.h>
+#undef TINYOBJLOADER_IMPLEMENTATION
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -14,19 +15,41 @@
 #include <tinygltf/tiny_gltf.h>
 
 #include <iostream>
+#include <limits>
 #include <string>
 #include <vector>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 #include "util/CheckError.h"
+#include "util/Frustum.h"
 #include "util/LoadShaders.h"
+#include "util/AssetCache.h"
+#include "util/AssetLoader.h"
+#include "util/AnimationBake.h"
+#include "util/AnimationClip.h"
+#include "util/AnimationLod.h"
+#include "util/AssetPack.h"
+#include "util/GltfModel.h"
+#include "util/JobSystem.h"
+#include "util/JointPalette.h"
+#include "util/MeshBuilder.h"
+#include "util/MeshOptimizer.h"
+#include "util/VertexFormat.h"
+#include "util/MeshSimplifier.h"
+#include "util/OcclusionCuller.h"
+#include "util/RenderQueue.h"
+#include "util/SceneIndex.h"
+#include "util/Skeleton.h"
+#include "util/StaticMeshBatch.h"
+#include "util/UniformBlocks.h"
 
 #include <headers/camera.h>
 #include <headers/house.h>
 #include <headers/landscape.h>
 #include <headers/skybox.h>
 #include <headers/robot.h>
+#include <headers/crowd.h>
 
 static GLFWwindow *window;
 
@@ -36,6 +59,17 @@ Camera *camera;
 glm::vec3 lightPosition = glm::vec3(10.0f,100.0f, 100.0f);
 glm::vec3 lightIntensity = glm::vec3(1e7);
 
+// Robots sampled and skinned per job in the parallel animation pass
+const size_t kRobotsPerJob = 16;
+
+// B swaps the six animated robots for a grid of instanced ones driven by baked joint textures
+static bool showCrowd = false;
+const int kCrowdRows = 45;
+const float kCrowdSpacing = 4.0f;
+
+// O turns the CPU occlusion culling pass off and on
+static bool useOcclusion = true;
+
 static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GL_TRUE);
@@ -68,6 +102,19 @@ static void key_callback(GLFWwindow *window, int key, int scancode, int action,
     if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
         camera->moveRight();
     }
+
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        showCrowd = !showCrowd;
+    }
+
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        useOcclusion = !useOcclusion;
+    }
+
+    // K cycles how the robots' joints reach the shader: 4x4 uniforms, 3x4 or dual quaternion palettes
+    if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+        Robot::setSkinningMode(SkinningMode(((int)Robot::skinningMode() + 1) % kSkinningModeCount));
+    }
 }
 
 int main() {
@@ -106,30 +153,76 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
+    // Cooked assets, written by the cook_assets target. Anything missing from the
+    // pack or older than its source is loaded from the source files instead.
+    AssetPack::instance().open(kAssetPackPath);
+
     // Now we initialize our objects
+    double loadStart = glfwGetTime();
     camera = new Camera();
 
     Skybox sb;
 
-    Robot rb(glm::vec3(0, 0, 0), 0, lightPosition, lightIntensity);
-
-    Robot r1(glm::vec3(100, 0, 100), 20, lightPosition, lightIntensity);
-    Robot r2(glm::vec3(-100, 0, -100), -35, lightPosition, lightIntensity);
-    Robot r3(glm::vec3(100, 0, -100), 44, lightPosition, lightIntensity);
-    Robot r4(glm::vec3(31,0, 89), 93, lightPosition, lightIntensity);
-    Robot r5(glm::vec3(-44, 0, -74), -134, lightPosition, lightIntensity);
+    Robot rb(glm::vec3(0, 0, 0), 0);
+
+    Robot r1(glm::vec3(100, 0, 100), 20);
+    Robot r2(glm::vec3(-100, 0, -100), -35);
+    Robot r3(glm::vec3(100, 0, -100), 44);
+    Robot r4(glm::vec3(31,0, 89), 93);
+    Robot r5(glm::vec3(-44, 0, -74), -134);
+    Robot *robots[] = {&rb, &r1, &r2, &r3, &r4, &r5};
+    const size_t robotCount = sizeof(robots) / sizeof(robots[0]);
+
+    // Robot bounds for culling, userData indexing robots; kept current as they update
+    SceneIndex robotIndex;
+    SceneHandle robotHandles[robotCount];
+    std::vector<uint32_t> visibleRobots;
+    for (size_t i = 0; i < robotCount; i++) {
+        glm::vec3 center;
+        float radius;
+        robots[i]->bounds(center, radius);
+        robotHandles[i] = robotIndex.insert(center, radius, (uint32_t)i);
+    }
 
-    Landscape ls1, ls2(glm::vec3(-100, 0, -100));
-    Landscape ls3(glm::vec3(100, 0, 100));
-    Landscape ls4(glm::vec3(-100, 0, 100));
-    Landscape ls5(glm::vec3(100, 0, -100));
+    RobotCrowd crowd;
+    for (int row = 0; row < kCrowdRows; row++) {
+        for (int column = 0; column < kCrowdRows; column++) {
+            int i = row * kCrowdRows + column;
+            glm::vec3 crowdPosition = kCrowdSpacing * glm::vec3(column - kCrowdRows / 2, 0, row - kCrowdRows / 2);
+            crowd.add(crowdPosition, float(i * 37 % 360), float(i) * 0.618034f);
+        }
+    }
 
-    House h1(glm::vec3(25, 0, 25));
-    House h2(glm::vec3(-55, 0, 15));
-    House h3(glm::vec3(-92, 0, -39));
-    House h4(glm::vec3(-83, 0, 28));
-    House h5(glm::vec3(56, 0, 03));
-    House h6(glm::vec3(12,0, 45));
+    Landscape landscape;
+    landscape.add(glm::vec3(0, 0, 0));
+    landscape.add(glm::vec3(-100, 0, -100));
+    landscape.add(glm::vec3(100, 0, 100));
+    landscape.add(glm::vec3(-100, 0, 100));
+    landscape.add(glm::vec3(100, 0, -100));
+
+    House houses;
+    houses.add(glm::vec3(25, 0, 25));
+    houses.add(glm::vec3(-55, 0, 15));
+    houses.add(glm::vec3(-92, 0, -39));
+    houses.add(glm::vec3(-83, 0, 28));
+    houses.add(glm::vec3(56, 0, 03));
+    houses.add(glm::vec3(12,0, 45));
+
+    // Assets are still loading at this point, the scene fills in over the first frames
+    bool loading = true;
+    std::cout << "Loading " << AssetCache::instance().missCount() << " assets on "
+              << AssetLoader::instance().threadCount() << " threads" << std::endl;
+
+    // Picks mesh detail from projected error, within a per-frame triangle budget
+    LodSelector lodSelector;
+    // Picks how often each robot is animated from its size on screen
+    AnimationLodSelector animationLod;
+    // Everything drawn in the frame, sorted by state before it is submitted
+    RenderQueue renderQueue;
+    // Drops whatever is outside the view before it is queued
+    FrustumCuller culler;
+    // Drops whatever the landscape and houses hide, from a small depth buffer drawn on the CPU
+    OcclusionCuller occlusion;
 
     static double lastTime = glfwGetTime();
     float time = 0.0f;
@@ -139,18 +232,24 @@ int main() {
     do {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        UniformStream::instance().beginFrame();
+
+        // Upload whatever the loader threads finished, without holding up the frame for long
+        AssetLoader::instance().pumpUploads(0.004);
+        if (loading && AssetLoader::instance().pending() == 0) {
+            loading = false;
+            std::cout << "Assets loaded in " << glfwGetTime() - loadStart << " s, asset cache: "
+                      << AssetCache::instance().missCount() << " loaded, "
+                      << AssetCache::instance().hitCount() << " shared" << std::endl;
+            std::cout << "Robot instance state: " << rb.instanceBytes() << " bytes each" << std::endl;
+        }
+
         // Update animation states
         double currentTime = glfwGetTime();
         float deltaTime = float(currentTime - lastTime);
         lastTime = currentTime;
 
         time += deltaTime;
-        rb.update(time);
-        r1.update(time);
-        r2.update(time);
-        r3.update(time);
-        r4.update(time);
-        r5.update(time);
 
         glm::mat4 viewMatrix = camera->getViewMatrix();
         glm::mat4 projectionMatrix = camera->getProjectionMatrix();
@@ -159,30 +258,87 @@ int main() {
 
         glm::vec3 cameraPosition = camera->getCameraPosition();
 
-        glm::mat4 skyBoxVP = projectionMatrix * glm::mat4(glm::mat3(viewMatrix));
 
-        sb.render(skyBoxVP);
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        lodSelector.beginFrame(cameraPosition, projectionMatrix, float(framebufferHeight));
+        culler.beginFrame(vp);
+
+        // Occluders go into the CPU depth buffer before anything is queued, so
+        // every object culled from here on is also tested against it
+        occlusion.beginFrame(vp);
+        if (useOcclusion) {
+            landscape.addOccluders(occlusion);
+            houses.addOccluders(occlusion);
+            occlusion.rasterize();
+        }
+        culler.setOcclusion(useOcclusion ? &occlusion : nullptr);
+
+        // Animation LOD: off-screen robots are skipped, small ones sample less often
+        // or share one pose
+        animationLod.beginFrame(cameraPosition, vp, projectionMatrix, float(framebufferHeight));
+        if (!showCrowd) {
+            for (Robot *robot : robots) {
+                robot->selectAnimationTier(animationLod);
+            }
+        }
+        animationLod.endFrame();
+        if (animationLod.countLastFrame(AnimationTier::Shared) > 0) {
+            Robot::updateSharedPose(time);
+        }
+
+        // Sample and skin every robot across the job threads; the joint matrices
+        // are all written by the time parallelFor returns and rendering reads them
+        if (!showCrowd) {
+            JobSystem::instance().parallelFor(robotCount, kRobotsPerJob, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    robots[i]->update(time);
+                }
+            });
+            for (size_t i = 0; i < robotCount; i++) {
+                glm::vec3 center;
+                float radius;
+                robots[i]->bounds(center, radius);
+                robotIndex.move(robotHandles[i], center, radius);
+            }
+        }
+
+        // Everything the shaders share this frame, staged ahead of the objects' blocks
+        FrameUniforms frameUniforms;
+        frameUniforms.view = viewMatrix;
+        frameUniforms.projection = projectionMatrix;
+        frameUniforms.viewProjection = vp;
+        frameUniforms.cameraPosition = glm::vec4(cameraPosition, time);
+        frameUniforms.lightPosition = glm::vec4(lightPosition, 1.0f);
+        frameUniforms.lightIntensity = glm::vec4(lightIntensity, 0.0f);
+        GLintptr frameOffset = stageFrameUniforms(frameUniforms);
+
+        renderQueue.beginFrame();
+        sb.submit(renderQueue);
+
+        // Rendering the landscape, every tile in one instanced draw per level of detail
+        landscape.submit(renderQueue, vp, lodSelector, culler);
+
+        if (showCrowd) {
+            crowd.submit(renderQueue, culler);
+        } else {
+            culler.cull(robotIndex, visibleRobots);
+            for (uint32_t i : visibleRobots) {
+                robots[i]->submit(renderQueue, vp);
+            }
+        }
 
-        // Rendering the landscape
-        ls1.render(vp);
-        ls2.render(vp);
-        ls3.render(vp);
-        ls4.render(vp);
-        ls5.render(vp);
+        houses.submit(renderQueue, vp, lodSelector, culler);
 
-        rb.render(vp);
-        r1.render(vp);
-        r2.render(vp);
-        r3.render(vp);
-        r4.render(vp);
-        r5.render(vp);
+        // Objects staged their blocks and joint palettes while queueing; one upload
+        // covers them all, and the Frame block stays bound for the whole queue
+        UniformStream::instance().upload();
+        bindFrameUniforms(frameOffset);
+        renderQueue.flush();
+        CheckOpenGLErrors("Drawing render queue");
 
-        h1.render(vp);
-        h2.render(vp);
-        h3.render(vp);
-        h4.render(vp);
-        h5.render(vp);
-        h6.render(vp);
+        lodSelector.endFrame();
+        culler.endFrame();
 
         // Frames tracking
         frames += 1;
@@ -193,7 +349,25 @@ int main() {
             frames = 0;
 
             std::stringstream sstream;
-            sstream << std::fixed << std::setprecision(2) << "Graphics Project: " << fps << " FPS";
+            sstream << std::fixed << std::setprecision(2) << "Graphics Project: " << fps << " FPS, "
+                    << lodSelector.trianglesLastFrame() << " static triangles, robots animated "
+                    << animationLod.countLastFrame(AnimationTier::Full) << " full / "
+                    << animationLod.countLastFrame(AnimationTier::Reduced) << " reduced / "
+                    << animationLod.countLastFrame(AnimationTier::Shared) << " shared / "
+                    << animationLod.countLastFrame(AnimationTier::Culled) << " culled";
+            sstream << ", objects drawn/culled/occluded " << culler.drawnLastFrame() << "/" << culler.culledLastFrame() << "/"
+                    << culler.occludedLastFrame() << " (" << occlusion.trianglesLastFrame() << " occluder triangles)";
+            const RenderStats &sorted = renderQueue.statsLastFrame();
+            const RenderStats &unsorted = renderQueue.unsortedStatsLastFrame();
+            sstream << ", " << sorted.draws << " draws, program/texture/VAO switches " << sorted.programChanges << "/"
+                    << sorted.textureChanges << "/" << sorted.vertexArrayChanges << " (unsorted "
+                    << unsorted.programChanges << "/" << unsorted.textureChanges << "/" << unsorted.vertexArrayChanges << ")";
+            if (showCrowd) {
+                sstream << ", " << crowd.size() << " instanced robots";
+            } else {
+                sstream << ", " << skinningModeName(Robot::skinningMode());
+            }
+            sstream << ", uniforms " << UniformStream::instance().bytesLastFrame() / 1024.0f << " KB";
             glfwSetWindowTitle(window, sstream.str().c_str());
         }
 
@@ -8,9 +8,14 @@ out vec4 FragColor;
 
 uniform sampler2D textureSampler;
 
-// lighting uniforms:
-uniform vec3 lightPosition;
-uniform vec3 lightIntensity;
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
 
 void main() {
     // Basic texture color
@@ -21,9 +26,9 @@ void main() {
 
     // Diffuse
     vec3 N = normalize(fragNormal);
-    vec3 L = normalize(lightPosition - fragPosition);
+    vec3 L = normalize(lightPosition.xyz - fragPosition);
     float diffFactor = max(dot(N, L), 0.0);
-    vec3 diffuse = diffFactor * lightIntensity * baseColor;
+    vec3 diffuse = diffFactor * lightIntensity.rgb * baseColor;
 
     vec3 finalColor = ambient + diffuse;
 
@@ -1,18 +1,46 @@
 #version 330 core
 
+// Positions arrive normalised to the mesh bounds, the Object block's model matrix is the dequantisation
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUV;
-layout(location = 2) in vec3 inNormal;
+layout(location = 2) in vec4 inNormal;
+
+// Per instance: the house's world transform
+layout(location = 3) in mat4 instanceModel;
 
 out vec2 fragUV;
 out vec3 fragNormal;
+out vec3 fragPosition;
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
 
-uniform mat4 MVP;
+// Normals are either xyz (float or 2_10_10_10) or octahedral in xy, as objectParams.x says
+layout(std140) uniform Object {
+    mat4 model;
+    vec4 objectParams;          // x: octahedral normals, y: joint scale
+};
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = MVP * vec4(inPosition, 1.0);
+    vec4 world = instanceModel * model * vec4(inPosition, 1.0);
+    gl_Position = viewProjection * world;
+    fragPosition = world.xyz;
 
     fragUV = inUV;
 
-    fragNormal = inNormal;
+    fragNormal = objectParams.x != 0.0 ? decodeOctahedral(inNormal.xy) : inNormal.xyz;
 }
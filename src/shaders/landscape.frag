@@ -7,7 +7,16 @@ uniform sampler2D textureSampler;
 
 // Lighting parameters
 uniform vec3 lightDirection;
-uniform vec3 lightIntensity;
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
+
 uniform vec3 ambientColor = vec3(0.9);
 
 void main() {
@@ -20,7 +29,7 @@ void main() {
     // Calculate diffuse lighting
     vec3 normal = normalize(vec3(0.0, 0.0, 1.0)); // Use a default normal for now
     float diffuseFactor = max(dot(normal, -lightDirection), 0.0);
-    vec3 diffuse = diffuseFactor * lightIntensity * baseColor;
+    vec3 diffuse = diffuseFactor * lightIntensity.rgb * baseColor;
 
     // Combine lighting components
     vec3 finalColor = ambient + diffuse;
@@ -1,15 +1,31 @@
 #version 330 core
 
+// Positions and uvs are unorm16, the Object block's model matrix is the position dequantisation
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 uv;
 
-uniform mat4 MVP;
+// Per instance: the tile's world transform
+layout(location = 3) in mat4 instanceModel;
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
+
+layout(std140) uniform Object {
+    mat4 model;
+    vec4 objectParams;          // x: octahedral normals, y: joint scale
+};
 
 out vec2 texCoord;
 
 
 void main(){
-    gl_Position = MVP * vec4(position, 1.0);
+    gl_Position = viewProjection * instanceModel * model * vec4(position, 1.0);
 
     texCoord = uv;
 }
\ No newline at end of file
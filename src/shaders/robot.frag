@@ -6,17 +6,23 @@ in vec2 uv;
 
 out vec3 finalColor;
 
-uniform vec3 lightPosition;
-uniform vec3 lightIntensity;
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
 uniform sampler2D textureSampler;
 
 void main()
 {
 	// Lighting
-	vec3 lightDir = lightPosition - worldPosition;
+	vec3 lightDir = lightPosition.xyz - worldPosition;
 	float lightDist = dot(lightDir, lightDir);
 	lightDir = normalize(lightDir);
-	vec3 v = lightIntensity * clamp(dot(lightDir, worldNormal), 0.0, 1.0) / lightDist;
+	vec3 v = lightIntensity.rgb * clamp(dot(lightDir, worldNormal), 0.0, 1.0) / lightDist;
 
 	// Tone mapping
 	v = v / (1.0 + v);
@@ -13,8 +13,33 @@ out vec3 worldNormal;
 out vec2 uv;
 out vec4 color;
 
-uniform mat4 MVP;
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
+
+layout(std140) uniform Object {
+    mat4 model;
+    vec4 objectParams;          // x: octahedral normals, y: joint scale
+};
+
+// The joint palette layout is picked by a define the program is compiled with,
+// see JointPalette.h; all of them hold up to 100 joints
+#if defined(SKINNING_AFFINE_3X4)
+layout(std140) uniform JointPalette {
+    vec4 jointRows[300];        // three rows of each joint's affine matrix
+};
+#elif defined(SKINNING_DUAL_QUATERNION)
+layout(std140) uniform JointPalette {
+    vec4 jointQuaternions[200];     // real then dual part of each joint
+};
+#else
 uniform mat4 u_jointMatrix[100];
+#endif
 
 void main() {
 
@@ -24,12 +49,49 @@ void main() {
     uv = vertexUV;
 
 
+#if defined(SKINNING_AFFINE_3X4)
+    vec4 row0 = vec4(0.0);
+    vec4 row1 = vec4(0.0);
+    vec4 row2 = vec4(0.0);
+    for (int i = 0; i < 4; i++) {
+        int joint = int(a_joint[i]) * 3;
+        row0 += a_weight[i] * jointRows[joint];
+        row1 += a_weight[i] * jointRows[joint + 1];
+        row2 += a_weight[i] * jointRows[joint + 2];
+    }
+    vec4 position = vec4(vertexPosition, 1.0);
+    vec4 skinned = vec4(dot(row0, position), dot(row1, position), dot(row2, position), 1.0);
+
+#elif defined(SKINNING_DUAL_QUATERNION)
+    // Blend in the hemisphere of the first joint so opposite signs do not cancel
+    vec4 firstReal = jointQuaternions[int(a_joint.x) * 2];
+    vec4 real = vec4(0.0);
+    vec4 dual = vec4(0.0);
+    for (int i = 0; i < 4; i++) {
+        int joint = int(a_joint[i]) * 2;
+        vec4 r = jointQuaternions[joint];
+        float w = dot(r, firstReal) < 0.0 ? -a_weight[i] : a_weight[i];
+        real += w * r;
+        dual += w * jointQuaternions[joint + 1];
+    }
+    float norm = length(real);
+    real /= norm;
+    dual /= norm;
+
+    // objectParams.y is the uniform scale shared by every joint, applied first
+    vec3 p = vertexPosition * objectParams.y;
+    vec3 rotated = p + 2.0 * cross(real.xyz, cross(real.xyz, p) + real.w * p);
+    vec4 skinned = vec4(rotated + 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz)), 1.0);
+
+#else
     mat4 skinMatrix =   a_weight.x * u_jointMatrix[int(a_joint.x)] +
                         a_weight.y * u_jointMatrix[int(a_joint.y)] +
                         a_weight.z * u_jointMatrix[int(a_joint.z)] +
                         a_weight.w * u_jointMatrix[int(a_joint.w)] ;
+    vec4 skinned = skinMatrix * vec4(vertexPosition, 1.0);
+#endif
 
     // Transform vertex
-    gl_Position = MVP * skinMatrix * vec4(vertexPosition, 1.0);
+    gl_Position = viewProjection * model * skinned;
 
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#version 330 core
+
+// Input
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexUV;
+layout(location = 3) in vec4 a_joint;
+layout(location = 4) in vec4 a_weight;
+
+// Per instance: model matrix, then first row, frame count, frame rate and time offset of its clip
+layout(location = 6) in mat4 instanceModel;
+layout(location = 10) in vec4 instanceAnimation;
+
+// Output data, to be interpolated for each fragment
+out vec3 worldPosition;
+out vec3 worldNormal;
+out vec2 uv;
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
+
+// Baked joint matrices: a row per frame, three texels (matrix rows) per joint
+uniform sampler2D jointTexture;
+
+mat4 fetchJoint(int joint, int row) {
+    vec4 r0 = texelFetch(jointTexture, ivec2(joint * 3, row), 0);
+    vec4 r1 = texelFetch(jointTexture, ivec2(joint * 3 + 1, row), 0);
+    vec4 r2 = texelFetch(jointTexture, ivec2(joint * 3 + 2, row), 0);
+    return transpose(mat4(r0, r1, r2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main() {
+
+    worldPosition = vertexPosition;
+    worldNormal = vertexNormal;
+
+    uv = vertexUV;
+
+    // Blend the two baked frames around this instance's clip time
+    float frameCount = instanceAnimation.y;
+    float frameRate = instanceAnimation.z;
+    float duration = (frameCount - 1.0) / frameRate;
+    float frame = mod(cameraPosition.w + instanceAnimation.w, duration) * frameRate;
+    int frame0 = min(int(frame), int(frameCount) - 2);
+    float blend = clamp(frame - float(frame0), 0.0, 1.0);
+    int row0 = int(instanceAnimation.x) + frame0;
+
+    mat4 skinMatrix = mat4(0.0);
+    for (int i = 0; i < 4; i++) {
+        int joint = int(a_joint[i]);
+        skinMatrix += a_weight[i] * ((1.0 - blend) * fetchJoint(joint, row0) + blend * fetchJoint(joint, row0 + 1));
+    }
+
+    // Transform vertex
+    gl_Position = viewProjection * instanceModel * skinMatrix * vec4(vertexPosition, 1.0);
+
+}
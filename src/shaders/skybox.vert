@@ -8,10 +8,23 @@ layout(location = 2) in vec2 vertexUV;
 out vec3 color;
 out vec2 uv;
 
-uniform mat4 MVP;
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
+
+layout(std140) uniform Object {
+    mat4 model;
+    vec4 objectParams;          // x: octahedral normals, y: joint scale
+};
 
 void main() {
-    gl_Position = MVP * vec4(vertexPosition, 1);
+    // Rotation only, the sky stays around the camera
+    gl_Position = projection * mat4(mat3(view)) * model * vec4(vertexPosition, 1);
     color = vertexColor;
 
     uv = vertexUV;
@@ -4,11 +4,23 @@
 layout(location = 0) in vec3 vertexPosition; // Vertex position
 
 // Uniforms
-uniform mat4 MVP;    // Model-View-Projection matrix
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;        // w: time in seconds
+    vec4 lightPosition;
+    vec4 lightIntensity;
+};
+
+layout(std140) uniform Object {
+    mat4 model;
+    vec4 objectParams;          // x: octahedral normals, y: joint scale
+};
 
 void main() {
     // Transform the vertex position to clip space
-    gl_Position = MVP * vec4(vertexPosition, 1.0);
+    gl_Position = viewProjection * model * vec4(vertexPosition, 1.0);
 
     // Pass UV coordinates to the fragment shader
     uv = vertexUV;
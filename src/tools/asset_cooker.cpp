@@ -0,0 +1,77 @@
+// Offline asset cooker: walks the assets directory and writes every mesh,
+// texture and glTF model it finds into one pack in their GPU-ready form.
+//
+//   asset_cooker <assets directory> <output pack>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <obj/obj_loader.h>
+#undef TINYOBJLOADER_IMPLEMENTATION
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util/AssetCook.h"
+#include "util/AssetPack.h"
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <assets directory> <output pack>" << std::endl;
+        return 1;
+    }
+
+    // Sorted so the pack comes out the same on every run
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(argv[1])) {
+        if (entry.is_regular_file()) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    AssetPackWriter writer;
+    int failures = 0;
+    for (const auto &file : files) {
+        std::string path = file.generic_string();
+        std::string extension = file.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+        std::vector<unsigned char> blob;
+        std::vector<std::string> dependencies;
+        AssetType type;
+        bool cooked;
+        if (extension == ".obj") {
+            type = AssetType::Mesh;
+            cooked = cookObjMesh(path, meshCookOptionsFor(path), blob, dependencies);
+        } else if (extension == ".png" || extension == ".jpg" || extension == ".jpeg") {
+            type = AssetType::Texture;
+            cooked = cookTexture(path, blob);
+        } else if (extension == ".gltf" || extension == ".glb") {
+            type = AssetType::Gltf;
+            cooked = cookGltf(path, blob, dependencies);
+        } else {
+            continue;
+        }
+
+        if (!cooked || !writer.add(assetKey(path), type, path, std::move(blob), dependencies)) {
+            failures++;
+            continue;
+        }
+        std::cout << "Cooked " << assetKey(path) << std::endl;
+    }
+
+    if (!writer.write(argv[2])) {
+        std::cerr << "Failed to write " << argv[2] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << writer.size() << " assets to " << argv[2] << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
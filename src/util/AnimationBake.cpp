@@ -0,0 +1,48 @@
+#include "AnimationBake.h"
+#include "GltfModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+BakedAnimation bakeAnimations(const GltfModel &model, int skin, float sampleRate) {
+    BakedAnimation baked;
+    if (skin < 0 || skin >= (int)model.skins.size()) {
+        return baked;
+    }
+    const Skeleton &skeleton = model.skins[skin];
+    baked.jointCount = (int)skeleton.jointCount();
+
+    AnimationPose pose;
+    pose.resize(model.nodes.size());
+    std::vector<glm::mat4> globals(skeleton.nodes.size());
+    std::vector<glm::mat4> joints(skeleton.jointCount());
+
+    int row = 0;
+    for (const AnimationClip &clip : model.animations) {
+        BakedClip bakedClip;
+        bakedClip.firstRow = row;
+        bakedClip.frameCount = std::max(2, (int)std::ceil(clip.duration * sampleRate) + 1);
+        bakedClip.frameRate = clip.duration > 0.0f ? (bakedClip.frameCount - 1) / clip.duration : sampleRate;
+
+        std::vector<uint32_t> cursors(clip.tracks.size(), 0);
+        for (int frame = 0; frame < bakedClip.frameCount; frame++) {
+            // The sampler wraps at the clip's end, so the last frame is taken just before it
+            float time = frame / bakedClip.frameRate;
+            if (frame == bakedClip.frameCount - 1) {
+                time = std::nextafter(clip.duration, 0.0f);
+            }
+            sampleAnimationClip(clip, time, cursors.data(), pose);
+            computeJointMatrices(skeleton, pose.localTransforms.data(), globals.data(), joints.data());
+
+            for (const glm::mat4 &joint : joints) {
+                for (int r = 0; r < 3; r++) {
+                    baked.texels.push_back(glm::vec4(joint[0][r], joint[1][r], joint[2][r], joint[3][r]));
+                }
+            }
+        }
+
+        baked.clips.push_back(bakedClip);
+        row += bakedClip.frameCount;
+    }
+    return baked;
+}
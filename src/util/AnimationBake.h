@@ -0,0 +1,31 @@
+#ifndef _ANIMATION_BAKE_H_
+#define _ANIMATION_BAKE_H_
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct GltfModel;
+
+// Where one clip's frames start in the baked texture
+struct BakedClip {
+    int firstRow = 0;
+    int frameCount = 0;
+    float frameRate = 0.0f;         // adjusted so the last frame lands on the clip's end
+};
+
+// Every clip of a model sampled at a fixed rate into joint matrices, laid out
+// for an RGBA32F texture: one row per frame, three texels per joint holding
+// the top three rows of its affine matrix
+struct BakedAnimation {
+    int jointCount = 0;
+    std::vector<BakedClip> clips;
+    std::vector<glm::vec4> texels;
+
+    int width() const { return jointCount * 3; }
+    int height() const { return width() ? (int)(texels.size() / width()) : 0; }
+};
+
+BakedAnimation bakeAnimations(const GltfModel &model, int skin, float sampleRate);
+
+#endif
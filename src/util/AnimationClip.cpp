@@ -0,0 +1,211 @@
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+// Key k such that times[k] <= t < times[k + 1], for times[0] <= t < times[count - 1]
+template <typename Time>
+uint32_t findKeyframeIndex(const Time *times, uint32_t count, float t) {
+    return uint32_t(std::upper_bound(times + 1, times + count - 1, t) - times) - 1;
+}
+
+// Starts from the previous frame's key and only searches after a seek or wrap
+template <typename Time>
+uint32_t advanceKeyframeIndex(const Time *times, uint32_t count, float t, uint32_t &cursor) {
+    uint32_t k = cursor;
+    if (k + 1 < count && times[k] <= t) {
+        if (t < times[k + 1]) {
+            return k;
+        }
+        if (k + 2 < count && t < times[k + 2]) {
+            return cursor = k + 1;
+        }
+    }
+    return cursor = findKeyframeIndex(times, count, t);
+}
+
+// Cubic Hermite spline between two keys, tangents already scaled by the key spacing
+template <typename T>
+T hermite(const T &v0, const T &outTangent0, const T &inTangent1, const T &v1, float s) {
+    float s2 = s * s, s3 = s2 * s;
+    return (2.0f * s3 - 3.0f * s2 + 1.0f) * v0 + (s3 - 2.0f * s2 + s) * outTangent0 +
+           (-2.0f * s3 + 3.0f * s2) * v1 + (s3 - s2) * inTangent1;
+}
+
+glm::vec4 slerpRotation(const glm::vec4 &value0, const glm::vec4 &value1, float factor) {
+    glm::quat rotation = glm::slerp(glm::quat(value0.w, value0.x, value0.y, value0.z),
+                                    glm::quat(value1.w, value1.x, value1.y, value1.z), factor);
+    return glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+}
+
+glm::vec4 decodeKey(const AnimationClip &clip, const AnimationTrack &track, uint32_t k) {
+    const uint16_t *words = &clip.quantizedValues[track.firstValue];
+    if (track.path == AnimationPath::Rotation) {
+        return decodeQuantizedRotation(words + k * 3);
+    }
+    glm::vec3 minimum = readQuantizedFloats(words);
+    glm::vec3 extent = readQuantizedFloats(words + 6);
+    return glm::vec4(decodeQuantizedVector(words + kQuantizedRangeWords + k * 3, minimum, extent), 0.0f);
+}
+
+// Quantized counterpart of sampleTrack, for linear and step tracks
+glm::vec4 sampleQuantizedTrack(const AnimationClip &clip, const AnimationTrack &track, float t, uint32_t &cursor) {
+    if (track.keyCount == 1) {
+        if (track.path == AnimationPath::Rotation) {
+            return decodeKey(clip, track, 0);
+        }
+        return glm::vec4(readQuantizedFloats(&clip.quantizedValues[track.firstValue]), 0.0f);
+    }
+
+    const uint16_t *times = &clip.quantizedTimes[track.firstKey];
+    float q = clip.duration > 0.0f ? t * (kQuantizedTimeSteps / clip.duration) : 0.0f;
+    if (q <= times[0]) {
+        return decodeKey(clip, track, 0);
+    }
+    if (q >= times[track.keyCount - 1]) {
+        return decodeKey(clip, track, track.keyCount - 1);
+    }
+
+    uint32_t k = advanceKeyframeIndex(times, track.keyCount, q, cursor);
+    if (track.interpolation == Interpolation::Step) {
+        return decodeKey(clip, track, k);
+    }
+
+    float factor = (q - times[k]) / float(times[k + 1] - times[k]);
+    glm::vec4 value0 = decodeKey(clip, track, k);
+    glm::vec4 value1 = decodeKey(clip, track, k + 1);
+    if (track.path == AnimationPath::Rotation) {
+        return slerpRotation(value0, value1, factor);
+    }
+    return glm::mix(value0, value1, factor);
+}
+
+// Value of one track at time t, as a vec4 (x, y, z, w for rotations)
+glm::vec4 sampleTrack(const AnimationClip &clip, const AnimationTrack &track, float t, uint32_t &cursor) {
+    const float *times = &clip.times[track.firstKey];
+    const glm::vec4 *values = &clip.values[track.firstValue];
+    bool cubic = track.interpolation == Interpolation::CubicSpline;
+    uint32_t stride = cubic ? 3 : 1;
+    uint32_t valueOffset = cubic ? 1 : 0;     // skip the in-tangent
+
+    if (t <= times[0]) {
+        return values[valueOffset];
+    }
+    if (t >= times[track.keyCount - 1]) {
+        return values[(track.keyCount - 1) * stride + valueOffset];
+    }
+
+    uint32_t k = advanceKeyframeIndex(times, track.keyCount, t, cursor);
+    float t0 = times[k];
+    float t1 = times[k + 1];
+    float delta = t1 - t0;
+    float factor = (t - t0) / delta;
+
+    if (track.interpolation == Interpolation::Step) {
+        return values[k];
+    }
+
+    if (cubic) {
+        const glm::vec4 *key0 = values + k * 3;
+        const glm::vec4 *key1 = key0 + 3;
+        return hermite(key0[1], key0[2] * delta, key1[0] * delta, key1[1], factor);
+    }
+
+    if (track.path == AnimationPath::Rotation) {
+        return slerpRotation(values[k], values[k + 1], factor);
+    }
+    return glm::mix(values[k], values[k + 1], factor);
+}
+
+}
+
+void AnimationClip::addTrack(int targetNode, AnimationPath path, Interpolation interpolation,
+                             const float *keyTimes, size_t keyCount, const glm::vec4 *keyValues, size_t valuesPerKey) {
+    AnimationTrack track;
+    track.targetNode = targetNode;
+    track.path = path;
+    track.interpolation = interpolation;
+    track.firstKey = (uint32_t)times.size();
+    track.keyCount = (uint32_t)keyCount;
+    track.firstValue = (uint32_t)values.size();
+
+    times.insert(times.end(), keyTimes, keyTimes + keyCount);
+    values.insert(values.end(), keyValues, keyValues + keyCount * valuesPerKey);
+    tracks.push_back(track);
+
+    duration = std::max(duration, keyTimes[keyCount - 1]);
+}
+
+size_t AnimationClip::residentBytes() const {
+    return sizeof(AnimationClip) + tracks.capacity() * sizeof(AnimationTrack) +
+           times.capacity() * sizeof(float) + values.capacity() * sizeof(glm::vec4) +
+           (quantizedTimes.capacity() + quantizedValues.capacity()) * sizeof(uint16_t) +
+           constants.capacity() * sizeof(AnimationConstant);
+}
+
+void AnimationPose::resize(size_t nodeCount) {
+    translations.resize(nodeCount);
+    rotations.resize(nodeCount);
+    scales.resize(nodeCount);
+    localTransforms.resize(nodeCount);
+}
+
+void sampleAnimationClip(const AnimationClip &clip, float time, uint32_t *cursors, AnimationPose &pose) {
+    std::fill(pose.translations.begin(), pose.translations.end(), glm::vec3(0.0f));
+    std::fill(pose.rotations.begin(), pose.rotations.end(), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    std::fill(pose.scales.begin(), pose.scales.end(), glm::vec3(1.0f));
+
+    // The whole clip loops, shorter tracks hold their last value until it does
+    float animationTime = clip.duration > 0.0f ? fmod(time, clip.duration) : 0.0f;
+
+    if (!clip.constants.empty()) {
+        const uint16_t *words = &clip.quantizedValues[clip.constantValues];
+        glm::vec3 minimum = readQuantizedFloats(words);
+        glm::vec3 extent = readQuantizedFloats(words + 6);
+        words += kQuantizedRangeWords;
+        for (const AnimationConstant &constant : clip.constants) {
+            if (constant.path == AnimationPath::Rotation) {
+                glm::vec4 value = decodeQuantizedRotation(words);
+                pose.rotations[constant.targetNode] = glm::quat(value.w, value.x, value.y, value.z);
+            } else if (constant.path == AnimationPath::Translation) {
+                pose.translations[constant.targetNode] = decodeQuantizedVector(words, minimum, extent);
+            } else if (constant.path == AnimationPath::Scale) {
+                pose.scales[constant.targetNode] = decodeQuantizedVector(words, minimum, extent);
+            }
+            words += 3;
+        }
+    }
+
+    for (size_t i = 0; i < clip.tracks.size(); i++) {
+        const AnimationTrack &track = clip.tracks[i];
+        glm::vec4 value = track.format == KeyFormat::Quantized ? sampleQuantizedTrack(clip, track, animationTime, cursors[i])
+                                                               : sampleTrack(clip, track, animationTime, cursors[i]);
+
+        switch (track.path) {
+            case AnimationPath::Translation:
+                pose.translations[track.targetNode] = glm::vec3(value);
+                break;
+            case AnimationPath::Rotation:
+                // Cubic splines do not preserve unit length
+                pose.rotations[track.targetNode] = glm::normalize(glm::quat(value.w, value.x, value.y, value.z));
+                break;
+            case AnimationPath::Scale:
+                pose.scales[track.targetNode] = glm::vec3(value);
+                break;
+            case AnimationPath::Weights:
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < pose.localTransforms.size(); i++) {
+        glm::mat4 &local = pose.localTransforms[i];
+        local = glm::translate(glm::mat4(1.0f), pose.translations[i]);
+        local *= glm::mat4_cast(pose.rotations[i]);
+        local = glm::scale(local, pose.scales[i]);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef _ANIMATION_CLIP_H_
+#define _ANIMATION_CLIP_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+enum class AnimationPath : uint8_t {
+    Translation,
+    Rotation,
+    Scale,
+    Weights,
+};
+
+enum class Interpolation : uint8_t {
+    Linear,
+    Step,
+    CubicSpline,
+};
+
+// How a track's keys are stored, see AnimationCompression.h
+enum class KeyFormat : uint8_t {
+    Raw,            // float times and vec4 values
+    Quantized,      // 16-bit times, three 16-bit words per value
+};
+
+// One animated property of one node. Keys live in the clip's shared arrays:
+// times[firstKey .. firstKey + keyCount) and the matching values, which hold
+// three entries per key (in-tangent, value, out-tangent) for cubic splines.
+// Quantized tracks index quantizedTimes and quantizedValues instead, and a
+// track reduced to a single key stores no time at all.
+struct AnimationTrack {
+    int targetNode = 0;
+    AnimationPath path = AnimationPath::Translation;
+    Interpolation interpolation = Interpolation::Linear;
+    KeyFormat format = KeyFormat::Raw;
+    uint32_t firstKey = 0;
+    uint32_t keyCount = 0;
+    uint32_t firstValue = 0;
+};
+
+// A channel compression found constant over the whole clip. It needs no
+// track, time, cursor or interpolation, and its value has no offset of its
+// own: constant i's three words follow the clip's constant block header, see
+// AnimationCompression.h.
+struct AnimationConstant {
+    uint16_t targetNode = 0;
+    AnimationPath path = AnimationPath::Translation;
+};
+
+// Animation compiled once at load: typed tracks over contiguous key times and
+// values, so sampling does no lookups, string compares or allocation
+struct AnimationClip {
+    std::vector<AnimationTrack> tracks;
+    std::vector<float> times;
+    std::vector<glm::vec4> values;      // vec3 values leave w at 0, rotations are x, y, z, w
+    float duration = 0.0f;
+
+    // Quantized tracks: times in 1/65535ths of the duration, and each track's
+    // values, laid out as described in AnimationCompression.h
+    std::vector<uint16_t> quantizedTimes;
+    std::vector<uint16_t> quantizedValues;
+    std::vector<AnimationConstant> constants;   // applied before the tracks
+    uint32_t constantValues = 0;        // their block in quantizedValues
+
+    // Copies one sampler's keys in; values holds valuesPerKey entries per key
+    void addTrack(int targetNode, AnimationPath path, Interpolation interpolation,
+                  const float *keyTimes, size_t keyCount, const glm::vec4 *keyValues, size_t valuesPerKey);
+
+    size_t residentBytes() const;
+};
+
+// Sampling output, sized once for the model's node count. Nothing in it
+// outlives a frame, so it can be scratch shared by every instance on a thread.
+struct AnimationPose {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> localTransforms;
+
+    void resize(size_t nodeCount);
+};
+
+// Samples clip at time (wrapped to its duration) into pose. Tracks hold their
+// first and last values outside their own key range, nodes without tracks get
+// the identity. cursors holds one entry per track and belongs to the instance:
+// the last key each track used, since time mostly moves forward a key at a time.
+// Allocates nothing once pose has been sized.
+void sampleAnimationClip(const AnimationClip &clip, float time, uint32_t *cursors, AnimationPose &pose);
+
+#endif
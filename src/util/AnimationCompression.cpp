@@ -0,0 +1,267 @@
+#include "AnimationCompression.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint16_t quantize(float value, float steps) {
+    return (uint16_t)std::lround(glm::clamp(value, 0.0f, 1.0f) * steps);
+}
+
+glm::quat toQuat(const glm::vec4 &v) {
+    return glm::quat(v.w, v.x, v.y, v.z);
+}
+
+// How far a is from b in the track's own measure: an angle for rotations, a
+// distance otherwise
+float keyError(AnimationPath path, const glm::vec4 &a, const glm::vec4 &b) {
+    if (path == AnimationPath::Rotation) {
+        // From the chord between the quaternions rather than acos of their dot
+        // product, which float cannot resolve below a few 1e-4 radians
+        glm::vec4 qa = glm::normalize(a), qb = glm::normalize(b);
+        float chord = glm::length(glm::dot(qa, qb) < 0.0f ? qa + qb : qa - qb);
+        return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+    }
+    return glm::length(glm::vec3(a) - glm::vec3(b));
+}
+
+void appendFloats(std::vector<uint16_t> &words, const glm::vec3 &value) {
+    uint16_t packed[6];
+    std::memcpy(packed, &value[0], sizeof(packed));
+    words.insert(words.end(), packed, packed + 6);
+}
+
+// A key stored without a range: every rotation key, and the one value of a
+// constant vector, which is kept exactly in about the space of a range
+void appendKey(AnimationPath path, const glm::vec4 &value, std::vector<uint16_t> &words) {
+    if (path == AnimationPath::Rotation) {
+        uint16_t key[3];
+        encodeQuantizedRotation(value, key);
+        words.insert(words.end(), key, key + 3);
+    } else {
+        appendFloats(words, glm::vec3(value));
+    }
+}
+
+// What the sampler gives nodes without a track
+glm::vec4 identityValue(AnimationPath path) {
+    return path == AnimationPath::Rotation ? glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+         : path == AnimationPath::Scale ? glm::vec4(1.0f, 1.0f, 1.0f, 0.0f) : glm::vec4(0.0f);
+}
+
+glm::vec4 interpolateKeys(AnimationPath path, const glm::vec4 &a, const glm::vec4 &b, float factor) {
+    if (path == AnimationPath::Rotation) {
+        glm::quat q = glm::slerp(toQuat(a), toQuat(b), factor);
+        return glm::vec4(q.x, q.y, q.z, q.w);
+    }
+    return glm::mix(a, b, factor);
+}
+
+// Indices of the keys worth keeping: a linear key goes when interpolating its
+// kept neighbours reproduces it and every key dropped before it, a step key
+// when it repeats the value before it. A constant track comes down to one key.
+std::vector<uint32_t> reduceKeys(const AnimationTrack &track, const float *times, const glm::vec4 *values, float tolerance) {
+    uint32_t count = track.keyCount;
+    bool constant = true;
+    for (uint32_t k = 1; k < count && constant; k++) {
+        constant = keyError(track.path, values[k], values[0]) <= tolerance;
+    }
+    if (constant) {
+        return std::vector<uint32_t>(1, 0);
+    }
+
+    std::vector<uint32_t> kept(1, 0);
+    if (track.interpolation == Interpolation::Step) {
+        for (uint32_t k = 1; k < count; k++) {
+            if (keyError(track.path, values[k], values[kept.back()]) > tolerance) {
+                kept.push_back(k);
+            }
+        }
+        return kept;
+    }
+
+    uint32_t anchor = 0;
+    for (uint32_t end = 2; end < count; end++) {
+        float span = times[end] - times[anchor];
+        for (uint32_t k = anchor + 1; k < end; k++) {
+            float factor = span > 0.0f ? (times[k] - times[anchor]) / span : 0.0f;
+            if (keyError(track.path, interpolateKeys(track.path, values[anchor], values[end], factor), values[k]) > tolerance) {
+                anchor = end - 1;
+                kept.push_back(anchor);
+                break;
+            }
+        }
+    }
+    kept.push_back(count - 1);
+    return kept;
+}
+
+float toleranceFor(AnimationPath path, const AnimationCompressionSettings &settings) {
+    return path == AnimationPath::Rotation ? settings.rotationTolerance
+         : path == AnimationPath::Scale ? settings.scaleTolerance : settings.translationTolerance;
+}
+
+// A quantized track of the kept keys, appended to compressed
+void appendQuantizedTrack(const AnimationClip &clip, const AnimationTrack &track, const std::vector<uint32_t> &kept,
+                          AnimationClip &compressed) {
+    const float *times = &clip.times[track.firstKey];
+    const glm::vec4 *values = &clip.values[track.firstValue];
+    std::vector<uint16_t> &words = compressed.quantizedValues;
+
+    AnimationTrack out = track;
+    out.format = KeyFormat::Quantized;
+    out.keyCount = (uint32_t)kept.size();
+    out.firstKey = (uint32_t)compressed.quantizedTimes.size();
+    out.firstValue = (uint32_t)words.size();
+    compressed.tracks.push_back(out);
+
+    // A single key holds for the whole clip, so it needs no time
+    if (kept.size() > 1) {
+        for (uint32_t k : kept) {
+            float normalized = clip.duration > 0.0f ? times[k] / clip.duration : 0.0f;
+            compressed.quantizedTimes.push_back(quantize(normalized, kQuantizedTimeSteps));
+        }
+    }
+
+    if (track.path == AnimationPath::Rotation || kept.size() == 1) {
+        for (uint32_t k : kept) {
+            appendKey(track.path, values[k], words);
+        }
+        return;
+    }
+
+    glm::vec3 minimum = glm::vec3(values[kept[0]]);
+    glm::vec3 maximum = minimum;
+    for (uint32_t k : kept) {
+        minimum = glm::min(minimum, glm::vec3(values[k]));
+        maximum = glm::max(maximum, glm::vec3(values[k]));
+    }
+    glm::vec3 extent = maximum - minimum;
+    appendFloats(words, minimum);
+    appendFloats(words, extent);
+    for (uint32_t k : kept) {
+        uint16_t key[3];
+        encodeQuantizedVector(glm::vec3(values[k]), minimum, extent, key);
+        words.insert(words.end(), key, key + 3);
+    }
+}
+
+}
+
+void encodeQuantizedVector(const glm::vec3 &value, const glm::vec3 &minimum, const glm::vec3 &extent, uint16_t *words) {
+    for (int i = 0; i < 3; i++) {
+        words[i] = extent[i] > 0.0f ? quantize((value[i] - minimum[i]) / extent[i], 65535.0f) : 0;
+    }
+}
+
+void encodeQuantizedRotation(const glm::vec4 &rotation, uint16_t *words) {
+    glm::vec4 q = glm::normalize(rotation);
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(q[i]) > std::fabs(q[largest])) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation; the dropped component is rebuilt positive
+    if (q[largest] < 0.0f) {
+        q = -q;
+    }
+
+    for (int i = 0, j = 0; i < 4; i++) {
+        if (i != largest) {
+            float normalized = (q[i] + kQuantizedRotationRange) / (2.0f * kQuantizedRotationRange);
+            words[j++] = quantize(normalized, 32767.0f);
+        }
+    }
+    words[0] |= (uint16_t)((largest >> 1) << 15);
+    words[1] |= (uint16_t)((largest & 1) << 15);
+}
+
+AnimationClip compressAnimationClip(const AnimationClip &clip, const AnimationCompressionSettings &settings) {
+    if (!clip.quantizedValues.empty()) {
+        return clip;
+    }
+
+    AnimationClip compressed;
+    compressed.duration = clip.duration;
+
+    // Constant channels wait for the range their values share, unless their
+    // node is past what AnimationConstant indexes
+    std::vector<const AnimationTrack *> constantTracks;
+    for (const AnimationTrack &track : clip.tracks) {
+        const float *times = &clip.times[track.firstKey];
+        const glm::vec4 *values = &clip.values[track.firstValue];
+
+        if (track.interpolation == Interpolation::CubicSpline || track.keyCount == 0) {
+            compressed.addTrack(track.targetNode, track.path, track.interpolation, times, track.keyCount, values,
+                                track.interpolation == Interpolation::CubicSpline ? 3 : 1);
+            continue;
+        }
+
+        float tolerance = toleranceFor(track.path, settings);
+        std::vector<uint32_t> kept = reduceKeys(track, times, values, tolerance);
+        if (kept.size() == 1 && keyError(track.path, values[0], identityValue(track.path)) <= tolerance) {
+            continue;
+        }
+        if (kept.size() == 1 && track.targetNode >= 0 && track.targetNode <= 0xffff) {
+            constantTracks.push_back(&track);
+            continue;
+        }
+        appendQuantizedTrack(clip, track, kept, compressed);
+    }
+
+    // One range over every vector constant, then three words each; a constant
+    // the range is too coarse for becomes a one-key track after all
+    glm::vec3 minimum(INFINITY), maximum(-INFINITY);
+    for (const AnimationTrack *track : constantTracks) {
+        if (track->path != AnimationPath::Rotation) {
+            minimum = glm::min(minimum, glm::vec3(clip.values[track->firstValue]));
+            maximum = glm::max(maximum, glm::vec3(clip.values[track->firstValue]));
+        }
+    }
+    if (minimum.x > maximum.x) {
+        minimum = maximum = glm::vec3(0.0f);
+    }
+    glm::vec3 extent = maximum - minimum;
+
+    std::vector<uint16_t> constantWords;
+    for (const AnimationTrack *track : constantTracks) {
+        const glm::vec4 &value = clip.values[track->firstValue];
+        uint16_t key[4] = {0, 0, 0, 0};
+        if (track->path == AnimationPath::Rotation) {
+            encodeQuantizedRotation(value, key);
+        } else {
+            encodeQuantizedVector(glm::vec3(value), minimum, extent, key);
+            glm::vec3 decoded = decodeQuantizedVector(key, minimum, extent);
+            if (keyError(track->path, glm::vec4(decoded, 0.0f), value) > toleranceFor(track->path, settings)) {
+                appendQuantizedTrack(clip, *track, std::vector<uint32_t>(1, 0), compressed);
+                continue;
+            }
+        }
+        AnimationConstant constant;
+        constant.targetNode = (uint16_t)track->targetNode;
+        constant.path = track->path;
+        compressed.constants.push_back(constant);
+        constantWords.insert(constantWords.end(), key, key + 3);
+    }
+    if (!compressed.constants.empty()) {
+        compressed.constantValues = (uint32_t)compressed.quantizedValues.size();
+        appendFloats(compressed.quantizedValues, minimum);
+        appendFloats(compressed.quantizedValues, extent);
+        compressed.quantizedValues.insert(compressed.quantizedValues.end(), constantWords.begin(), constantWords.end());
+    }
+
+    // The spare word decodeQuantized* may load past the last key
+    compressed.quantizedValues.push_back(0);
+
+    compressed.tracks.shrink_to_fit();
+    compressed.times.shrink_to_fit();
+    compressed.values.shrink_to_fit();
+    compressed.quantizedTimes.shrink_to_fit();
+    compressed.quantizedValues.shrink_to_fit();
+    compressed.constants.shrink_to_fit();
+    return compressed;
+}
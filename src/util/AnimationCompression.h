@@ -0,0 +1,99 @@
+#ifndef _ANIMATION_COMPRESSION_H_
+#define _ANIMATION_COMPRESSION_H_
+
+#include "AnimationClip.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ANIMATION_COMPRESSION_SSE
+#endif
+
+// How far a reduced track may stray from the source keys it replaces
+struct AnimationCompressionSettings {
+    float translationTolerance = 1e-2f;     // in the node's parent space
+    float rotationTolerance = 1e-3f;        // radians
+    float scaleTolerance = 1e-3f;
+};
+
+// Compresses linear and step tracks: keys that interpolation reproduces within
+// the tolerances are dropped, constant tracks become AnimationConstants and
+// those that only hold the identity the sampler defaults to are dropped.
+// Vector constants share one range, and any the range cannot hold within its
+// tolerance stays a one-key track. Times
+// are quantized to 16 bits of the clip's duration, rotations to the smallest
+// three components at 15 bits each and translations and scales to 16 bits
+// over their track's range. Cubic spline tracks are copied as they are.
+AnimationClip compressAnimationClip(const AnimationClip &clip,
+                                    const AnimationCompressionSettings &settings = AnimationCompressionSettings());
+
+// A quantized track's or constant's values start at quantizedValues[firstValue]:
+//   rotations                  three words per key
+//   vectors, one key           the value as three floats, in six words
+//   vectors, more keys         minimum and extent as three floats each, then
+//                              three words per key
+//   constants                  from constantValues: the minimum and extent of
+//                              every vector constant as three floats each,
+//                              then three words per constant in their order
+// A vector word is its component's position in the range; a rotation keeps the
+// three components other than the largest, each in [-1/sqrt(2), 1/sqrt(2)] at
+// 15 bits, and the top bits of the first two words give the largest's index.
+// The array ends in a spare word, since decoding loads four words at a time.
+const float kQuantizedTimeSteps = 65535.0f;
+const float kQuantizedRotationRange = 0.70710678f;
+
+const uint32_t kQuantizedRangeWords = 12;
+
+inline glm::vec3 readQuantizedFloats(const uint16_t *words) {
+    glm::vec3 value;
+    std::memcpy(&value[0], words, sizeof(float) * 3);
+    return value;
+}
+
+void encodeQuantizedVector(const glm::vec3 &value, const glm::vec3 &minimum, const glm::vec3 &extent, uint16_t *words);
+void encodeQuantizedRotation(const glm::vec4 &rotation, uint16_t *words);
+
+// Reads words[0..3], so the array needs a spare word after the last key
+inline glm::vec3 decodeQuantizedVector(const uint16_t *words, const glm::vec3 &minimum, const glm::vec3 &extent) {
+#ifdef ANIMATION_COMPRESSION_SSE
+    __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(words));
+    __m128 q = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+    __m128 scale = _mm_mul_ps(_mm_setr_ps(extent.x, extent.y, extent.z, 0.0f), _mm_set1_ps(1.0f / 65535.0f));
+    __m128 r = _mm_add_ps(_mm_setr_ps(minimum.x, minimum.y, minimum.z, 0.0f), _mm_mul_ps(q, scale));
+    float out[4];
+    _mm_storeu_ps(out, r);
+    return glm::vec3(out[0], out[1], out[2]);
+#else
+    return minimum + extent * (glm::vec3(words[0], words[1], words[2]) * (1.0f / 65535.0f));
+#endif
+}
+
+// x, y, z, w like the raw values
+inline glm::vec4 decodeQuantizedRotation(const uint16_t *words) {
+    const float scale = 2.0f * kQuantizedRotationRange / 32767.0f;
+    float c[4];
+#ifdef ANIMATION_COMPRESSION_SSE
+    __m128i packed = _mm_and_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(words)), _mm_set1_epi16(0x7fff));
+    __m128 q = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+    _mm_storeu_ps(c, _mm_sub_ps(_mm_mul_ps(q, _mm_set1_ps(scale)), _mm_set1_ps(kQuantizedRotationRange)));
+#else
+    for (int i = 0; i < 3; i++) {
+        c[i] = (words[i] & 0x7fff) * scale - kQuantizedRotationRange;
+    }
+#endif
+    int largest = ((words[0] >> 15) << 1) | (words[1] >> 15);
+    float w = std::sqrt(std::fmax(0.0f, 1.0f - c[0] * c[0] - c[1] * c[1] - c[2] * c[2]));
+
+    glm::vec4 rotation;
+    for (int i = 0, j = 0; i < 4; i++) {
+        rotation[i] = i == largest ? w : c[j++];
+    }
+    return rotation;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#include "AnimationLod.h"
+
+#include <algorithm>
+
+void AnimationLodSelector::beginFrame(glm::vec3 cameraPosition, const glm::mat4 &viewProjection,
+                                      const glm::mat4 &projection, float viewportHeight) {
+    this->cameraPosition = cameraPosition;
+    pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    frustum.extract(viewProjection);
+    std::fill(frameCounts, frameCounts + kAnimationTierCount, 0u);
+}
+
+AnimationTier AnimationLodSelector::select(glm::vec3 center, float radius) {
+    AnimationTier tier;
+    if (!frustum.intersectsSphere(center, radius)) {
+        tier = AnimationTier::Culled;
+    } else {
+        float distance = std::max(glm::length(center - cameraPosition), 1e-3f);
+        float pixels = radius / distance * pixelsPerUnit;
+        tier = pixels >= settings.fullPixels ? AnimationTier::Full
+             : pixels >= settings.sharedPixels ? AnimationTier::Reduced : AnimationTier::Shared;
+    }
+
+    frameCounts[(int)tier]++;
+    return tier;
+}
+
+bool AnimationLodSelector::reducedSampleDue(unsigned phase) const {
+    return (frameIndex + phase) % (unsigned long)std::max(settings.reducedInterval, 1) == 0;
+}
+
+void AnimationLodSelector::endFrame() {
+    std::copy(frameCounts, frameCounts + kAnimationTierCount, lastCounts);
+    frameIndex++;
+}
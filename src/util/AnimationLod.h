@@ -0,0 +1,58 @@
+#ifndef _ANIMATION_LOD_H_
+#define _ANIMATION_LOD_H_
+
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+// How much animation work a character gets this frame
+enum class AnimationTier {
+    Full,           // sampled every frame
+    Reduced,        // sampled every few frames, joint matrices blended in between
+    Shared,         // uses the one pose sampled for all distant characters
+    Culled,         // off screen, not sampled; the clock keeps running
+};
+
+const int kAnimationTierCount = 4;
+
+struct AnimationLodSettings {
+    float fullPixels = 60.0f;       // projected bounding radius at or above which sampling is per frame
+    float sharedPixels = 8.0f;      // below this, characters share one pose
+    int reducedInterval = 4;        // frames between samples in the reduced tier
+};
+
+// Picks animation tiers by on-screen size and visibility, and counts how many
+// characters landed in each tier, for the stats readout. Tiers are picked on
+// one thread before the parallel animation pass.
+class AnimationLodSelector {
+    AnimationLodSettings settings;
+
+    Frustum frustum;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float pixelsPerUnit = 1.0f;     // at a distance of one unit
+
+    unsigned long frameIndex = 0;
+    unsigned frameCounts[kAnimationTierCount] = {};
+    unsigned lastCounts[kAnimationTierCount] = {};
+
+    public:
+        explicit AnimationLodSelector(const AnimationLodSettings &settings = AnimationLodSettings())
+            : settings(settings) {}
+
+        void beginFrame(glm::vec3 cameraPosition, const glm::mat4 &viewProjection,
+                        const glm::mat4 &projection, float viewportHeight);
+
+        // center/radius bound the character in world space
+        AnimationTier select(glm::vec3 center, float radius);
+
+        // Reduced-tier characters sample when this is true; phase (any per-character
+        // number) staggers them so they do not all sample on the same frame
+        bool reducedSampleDue(unsigned phase) const;
+
+        void endFrame();
+
+        unsigned countLastFrame(AnimationTier tier) const { return lastCounts[(int)tier]; }
+        const AnimationLodSettings &currentSettings() const { return settings; }
+};
+
+#endif
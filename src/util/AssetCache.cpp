@@ -0,0 +1,285 @@
+#include "AssetCache.h"
+#include "AssetCook.h"
+#include "AssetPack.h"
+#include "LoadShaders.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// The full detail triangles of a cooked mesh, positions decoded to model space
+bool decodeTriangles(const CookedMesh &source, std::vector<glm::vec3> &positions, std::vector<uint32_t> &indices) {
+    const CookedMeshHeader &header = *source.header;
+    if (header.lodCount == 0) {
+        return false;
+    }
+    glm::mat4 dequantize;
+    memcpy(&dequantize[0][0], header.dequantize, sizeof(header.dequantize));
+
+    positions.resize(header.vertexCount);
+    for (uint32_t v = 0; v < header.vertexCount; v++) {
+        const unsigned char *vertex = source.vertices + size_t(v) * header.stride;
+        glm::vec3 position;
+        if (source.layout.position == PositionEncoding::Float) {
+            memcpy(&position, vertex, 12);
+        } else {
+            uint16_t packed[4];
+            memcpy(packed, vertex, 8);
+            position = glm::vec3(packed[0], packed[1], packed[2]) / 65535.0f;
+        }
+        positions[v] = glm::vec3(dequantize * glm::vec4(position, 1.0f));
+    }
+
+    const MeshLod &lod = source.lods[0];
+    indices.resize(lod.indexCount);
+    for (uint32_t i = 0; i < lod.indexCount; i++) {
+        size_t at = size_t(lod.indexOffset) + i;
+        if (header.indexSize == 2) {
+            uint16_t shortIndex;
+            memcpy(&shortIndex, source.indices + at * 2, 2);
+            indices[i] = shortIndex;
+        } else {
+            memcpy(&indices[i], source.indices + at * 4, 4);
+        }
+        if (indices[i] >= header.vertexCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+MeshAsset::~MeshAsset() {
+    glDeleteBuffers(1, &vertexBufferID);
+    glDeleteBuffers(1, &indexBufferID);
+    glDeleteVertexArrays(1, &vertexArrayID);
+}
+
+void MeshAsset::drawLod(int level) const {
+    glDrawElements(GL_TRIANGLES, lods[level].indexCount, indexType, (void *)lodIndexOffset(level));
+}
+
+uintptr_t MeshAsset::lodIndexOffset(int level) const {
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    return (uintptr_t)(lods[level].indexOffset * indexSize);
+}
+
+GLuint MeshAsset::createVertexArray() const {
+    GLuint vertexArray;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    setVertexAttributes(vertexLayout);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+    return vertexArray;
+}
+
+TextureAsset::~TextureAsset() {
+    glDeleteTextures(1, &textureID);
+}
+
+ProgramAsset::~ProgramAsset() {
+    glDeleteProgram(programID);
+}
+
+std::string TextureOptions::key() const {
+    return std::to_string(wrap) + (mipmaps ? ":mip" : ":nomip");
+}
+
+AssetCache::AssetCache() {
+    // S3TC is an extension in GL 3.3 core, though every desktop driver has it
+    GLint extensionCount = 0;
+    if (glGetStringi) {
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    }
+    for (GLint i = 0; i < extensionCount; i++) {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+            compressedTextures = true;
+        }
+    }
+}
+
+AssetCache &AssetCache::instance() {
+    static AssetCache cache;
+    return cache;
+}
+
+AssetCache::Upload<MeshAsset> AssetCache::prepareMesh(const std::string &objPath) {
+    size_t size = 0;
+    const unsigned char *blob = AssetPack::instance().find(assetKey(objPath), AssetType::Mesh, objPath, size);
+
+    // Pack blobs stay mapped for the whole run, cooked ones travel with the upload
+    auto cooked = std::make_shared<std::vector<unsigned char>>();
+    if (!blob) {
+        std::vector<std::string> dependencies;
+        if (!cookObjMesh(objPath, meshCookOptionsFor(objPath), *cooked, dependencies)) {
+            return nullptr;
+        }
+        blob = cooked->data();
+        size = cooked->size();
+    }
+
+    CookedMesh source;
+    if (!readCookedMesh(blob, size, source)) {
+        std::cerr << "Corrupt cooked mesh " << objPath << std::endl;
+        return nullptr;
+    }
+
+    // Decoded here on the loader thread; the upload only moves it into the mesh
+    auto occluder = std::make_shared<OccluderMesh>();
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    if (decodeTriangles(source, positions, indices)) {
+        buildOccluder(meshCookOptionsFor(objPath).occluder, positions, indices, *occluder);
+    }
+
+    return [objPath, cooked, source, occluder]() -> std::shared_ptr<MeshAsset> {
+        const CookedMeshHeader &header = *source.header;
+
+        auto mesh = std::make_shared<MeshAsset>();
+        mesh->lods.assign(source.lods, source.lods + header.lodCount);
+        mesh->boundsCenter = glm::vec3(header.boundsCenter[0], header.boundsCenter[1], header.boundsCenter[2]);
+        mesh->boundsRadius = header.boundsRadius;
+        mesh->indexCount = header.indexCount;
+        mesh->indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        memcpy(&mesh->dequantize[0][0], header.dequantize, sizeof(header.dequantize));
+        mesh->octahedralNormals = source.layout.normal == NormalEncoding::Octahedral;
+        mesh->occluder = std::move(*occluder);
+
+        // Material textures are relative to the OBJ file
+        if (!source.diffuseTexture.empty()) {
+            mesh->diffuseTexturePath = objPath.substr(0, objPath.find_last_of('/') + 1) + source.diffuseTexture;
+        }
+
+        glGenVertexArrays(1, &mesh->vertexArrayID);
+        glBindVertexArray(mesh->vertexArrayID);
+
+        // Interleaved vertex buffer, the VAO keeps the attribute layout
+        glGenBuffers(1, &mesh->vertexBufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBufferID);
+        glBufferData(GL_ARRAY_BUFFER, size_t(header.vertexCount) * header.stride, source.vertices, GL_STATIC_DRAW);
+
+        PackedVertices &layout = mesh->vertexLayout;
+        layout.layout = source.layout;
+        layout.stride = header.stride;
+        layout.uvOffset = header.uvOffset;
+        layout.normalOffset = header.normalOffset;
+        setVertexAttributes(layout);
+
+        // Index buffer
+        glGenBuffers(1, &mesh->indexBufferID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBufferID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, size_t(header.indexCount) * header.indexSize, source.indices, GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+
+        return mesh;
+    };
+}
+
+AssetCache::Upload<TextureAsset> AssetCache::prepareTexture(const std::string &path, const TextureOptions &options) {
+    // Cooked textures come with their mip chain, anything missing from the pack is
+    // cooked here on one thread, since other workers are decoding alongside
+    size_t size = 0;
+    const unsigned char *blob = AssetPack::instance().find(assetKey(path), AssetType::Texture, path, size);
+    auto cooked = std::make_shared<std::vector<unsigned char>>();
+    if (!blob) {
+        if (!cookTextureCached(path, *cooked, 1)) {
+            return nullptr;
+        }
+        blob = cooked->data();
+        size = cooked->size();
+    }
+
+    CookedTexture source;
+    if (!readCookedTexture(blob, size, source)) {
+        std::cerr << "Corrupt cooked texture " << path << std::endl;
+        return nullptr;
+    }
+
+    // Without S3TC support the blocks are expanded here rather than on the GL thread
+    int w = source.header->width, h = source.header->height;
+    TextureFormat format = (TextureFormat)source.header->format;
+    GLint levels = options.mipmaps ? (GLint)source.header->levelCount : 1;
+    auto decoded = std::make_shared<std::vector<Image>>();
+    if (format != TextureFormat::RGBA8 && !instance().compressedTextures) {
+        for (GLint level = 0; level < levels; level++) {
+            decoded->push_back(decompressImage(source.levels[level], std::max(w >> level, 1), std::max(h >> level, 1), format));
+        }
+    }
+
+    return [options, cooked, source, decoded, levels, w, h, format]() -> std::shared_ptr<TextureAsset> {
+        auto texture = std::make_shared<TextureAsset>();
+        texture->width = w;
+        texture->height = h;
+
+        glGenTextures(1, &texture->textureID);
+        glBindTexture(GL_TEXTURE_2D, texture->textureID);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        for (GLint level = 0; level < levels; level++) {
+            GLsizei levelWidth = std::max(w >> level, 1), levelHeight = std::max(h >> level, 1);
+            if (!decoded->empty()) {
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, (*decoded)[level].rgba.data());
+            } else if (format == TextureFormat::RGBA8) {
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, source.levels[level]);
+            } else {
+                GLenum internalFormat = format == TextureFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth, levelHeight, 0,
+                                       (GLsizei)source.header->levelSizes[level], source.levels[level]);
+            }
+        }
+
+        return texture;
+    };
+}
+
+std::shared_ptr<MeshAsset> AssetCache::mesh(const std::string &objPath) {
+    return acquire<MeshAsset>("mesh", objPath, [&]() -> std::shared_ptr<MeshAsset> {
+        Upload<MeshAsset> upload = prepareMesh(objPath);
+        return upload ? upload() : nullptr;
+    });
+}
+
+void AssetCache::meshAsync(const std::string &objPath, const Ready<MeshAsset> &ready) {
+    acquireAsync<MeshAsset>("mesh", objPath, [objPath]() {
+        return prepareMesh(objPath);
+    }, ready);
+}
+
+std::shared_ptr<TextureAsset> AssetCache::texture(const std::string &path, const TextureOptions &options) {
+    return acquire<TextureAsset>("texture", path + "|" + options.key(), [&]() -> std::shared_ptr<TextureAsset> {
+        Upload<TextureAsset> upload = prepareTexture(path, options);
+        return upload ? upload() : nullptr;
+    });
+}
+
+void AssetCache::textureAsync(const std::string &path, const TextureOptions &options, const Ready<TextureAsset> &ready) {
+    acquireAsync<TextureAsset>("texture", path + "|" + options.key(), [path, options]() {
+        return prepareTexture(path, options);
+    }, ready);
+}
+
+std::shared_ptr<ProgramAsset> AssetCache::program(const std::string &vertexPath, const std::string &fragmentPath,
+                                                  const std::string &defines) {
+    return acquire<ProgramAsset>("program", vertexPath + "|" + fragmentPath + "|" + defines, [&]() -> std::shared_ptr<ProgramAsset> {
+        GLuint programID = LoadShadersFromFile(vertexPath.c_str(), fragmentPath.c_str(), defines.c_str());
+        if (programID == 0) {
+            return nullptr;
+        }
+
+        auto program = std::make_shared<ProgramAsset>();
+        program->programID = programID;
+        return program;
+    });
+}
@@ -0,0 +1,214 @@
+#ifndef _ASSET_CACHE_H_
+#define _ASSET_CACHE_H_
+
+#include "AssetLoader.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
+#include "VertexFormat.h"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+// EXT_texture_compression_s3tc, not part of the core profile headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// GPU copy of a static mesh. The buffers are released when the last handle goes away.
+struct MeshAsset {
+    GLuint vertexArrayID = 0;
+    GLuint vertexBufferID = 0;      // interleaved, see VertexFormat.h
+    GLuint indexBufferID = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    // Attribute layout of the vertex buffer, without the data
+    PackedVertices vertexLayout;
+
+    // Ranges of the index buffer, finest first, all over the same vertices
+    std::vector<MeshLod> lods;
+
+    // Model space bounds
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+
+    // Applied before the model matrix to undo position quantisation
+    glm::mat4 dequantize = glm::mat4(1.0f);
+
+    // Box or heightfield inside the full detail mesh, kept on the CPU for OcclusionCuller
+    OccluderMesh occluder;
+    bool octahedralNormals = false;
+
+    // Diffuse map named by the source material, empty if it had none
+    std::string diffuseTexturePath;
+
+    // Draws one level of detail, the VAO must already be bound
+    void drawLod(int level) const;
+
+    // Byte offset of a level's first index, for drawing it some other way
+    uintptr_t lodIndexOffset(int level) const;
+
+    // Another vertex array over the same buffers, for adding attributes of the
+    // caller's own such as an instance stream; the caller deletes it
+    GLuint createVertexArray() const;
+
+    ~MeshAsset();
+};
+
+struct TextureAsset {
+    GLuint textureID = 0;
+    int width = 0;
+    int height = 0;
+
+    ~TextureAsset();
+};
+
+struct ProgramAsset {
+    GLuint programID = 0;
+
+    ~ProgramAsset();
+};
+
+// Sampling state a texture is uploaded with. Part of the cache key, so the same
+// image loaded with different options ends up as two separate textures.
+struct TextureOptions {
+    GLint wrap = GL_CLAMP_TO_EDGE;
+    bool mipmaps = true;
+
+    std::string key() const;
+};
+
+// Shares loaded assets between every object that asks for the same path.
+//
+// The cache only keeps weak references: objects hold the returned shared_ptr and
+// the asset is destroyed (and its GL objects deleted) once the last user is gone.
+//
+// Only the GL thread may call into the cache. The *Async variants do their file
+// I/O and decoding on the AssetLoader workers and report back from its upload
+// queue, also on the GL thread.
+class AssetCache {
+    public:
+        // GL half of a load, returned by the CPU half that ran on a worker
+        template <typename T>
+        using Upload = std::function<std::shared_ptr<T>()>;
+
+        // Receives the asset once it is uploaded, or null if it failed to load
+        template <typename T>
+        using Ready = std::function<void(std::shared_ptr<T>)>;
+
+    private:
+        std::map<std::string, std::weak_ptr<void>> entries;
+
+        // Loads in flight and everyone waiting on them
+        std::map<std::string, std::vector<Ready<void>>> inFlight;
+
+        unsigned long hits = 0;
+        unsigned long misses = 0;
+
+        // Set once on the GL thread, before any worker reads it
+        bool compressedTextures = false;
+
+        AssetCache();
+
+        static Upload<MeshAsset> prepareMesh(const std::string &objPath);
+        static Upload<TextureAsset> prepareTexture(const std::string &path, const TextureOptions &options);
+
+    public:
+        static AssetCache &instance();
+
+        // Returns the asset stored under kind:key, running load() only when no
+        // live copy exists. A null result from load() is not cached.
+        template <typename T>
+        std::shared_ptr<T> acquire(const std::string &kind, const std::string &key,
+                                   const std::function<std::shared_ptr<T>()> &load) {
+            std::string fullKey = kind + ":" + key;
+
+            auto it = entries.find(fullKey);
+            if (it != entries.end()) {
+                if (std::shared_ptr<void> cached = it->second.lock()) {
+                    hits++;
+                    return std::static_pointer_cast<T>(cached);
+                }
+            }
+
+            misses++;
+            std::shared_ptr<T> asset = load();
+            if (asset) {
+                entries[fullKey] = asset;
+            }
+            return asset;
+        }
+
+        // Like acquire(), but prepare() runs on a loader worker and the Upload it
+        // returns runs on the GL thread before ready() is called. Requests for a
+        // key that is already loading wait for that load instead of starting another.
+        template <typename T>
+        void acquireAsync(const std::string &kind, const std::string &key,
+                          const std::function<Upload<T>()> &prepare, const Ready<T> &ready) {
+            std::string fullKey = kind + ":" + key;
+
+            auto it = entries.find(fullKey);
+            if (it != entries.end()) {
+                if (std::shared_ptr<void> cached = it->second.lock()) {
+                    hits++;
+                    ready(std::static_pointer_cast<T>(cached));
+                    return;
+                }
+            }
+
+            Ready<void> waiter = [ready](std::shared_ptr<void> asset) {
+                ready(std::static_pointer_cast<T>(asset));
+            };
+            auto loading = inFlight.find(fullKey);
+            if (loading != inFlight.end()) {
+                hits++;
+                loading->second.push_back(waiter);
+                return;
+            }
+
+            misses++;
+            inFlight[fullKey].push_back(waiter);
+            AssetLoader::instance().submit([this, fullKey, prepare]() -> AssetLoader::Upload {
+                Upload<T> upload = prepare();
+                return [this, fullKey, upload]() {
+                    std::shared_ptr<T> asset = upload ? upload() : nullptr;
+                    if (asset) {
+                        entries[fullKey] = asset;
+                    }
+
+                    std::vector<Ready<void>> waiters;
+                    waiters.swap(inFlight[fullKey]);
+                    inFlight.erase(fullKey);
+                    for (const Ready<void> &waiter : waiters) {
+                        waiter(asset);
+                    }
+                };
+            });
+        }
+
+        // Static OBJ mesh, from the asset pack when it has an up to date copy,
+        // otherwise cooked on the spot with the same settings as the cooker
+        std::shared_ptr<MeshAsset> mesh(const std::string &objPath);
+        void meshAsync(const std::string &objPath, const Ready<MeshAsset> &ready);
+
+        std::shared_ptr<TextureAsset> texture(const std::string &path, const TextureOptions &options = TextureOptions());
+        void textureAsync(const std::string &path, const TextureOptions &options, const Ready<TextureAsset> &ready);
+
+        // defines is compiled into both shaders and is part of the cache key
+        std::shared_ptr<ProgramAsset> program(const std::string &vertexPath, const std::string &fragmentPath,
+                                              const std::string &defines = "");
+
+        unsigned long hitCount() const { return hits; }
+        unsigned long missCount() const { return misses; }
+};
+
+#endif
@@ -0,0 +1,298 @@
+#include "AssetCook.h"
+#include "AssetPack.h"
+#include "GltfModel.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include <obj/obj_loader.h>
+#include <tinygltf/stb_image.h>
+
+MeshCookOptions meshCookOptionsFor(const std::string &objPath) {
+    MeshCookOptions options;
+    if (assetKey(objPath).find("landscape/") != std::string::npos) {
+        // Terrain is lit without normals and its uvs stay inside [0, 1]
+        options.layout.position = PositionEncoding::Unorm16;
+        options.layout.uv = UvEncoding::Unorm16;
+        options.layout.normal = NormalEncoding::None;
+        options.flipV = true;
+        options.occluder = OccluderShape::Heightfield;
+    } else {
+        // Textures tile, so uvs keep their range as half floats
+        options.layout.position = PositionEncoding::Unorm16;
+        options.layout.uv = UvEncoding::Half;
+        options.layout.normal = NormalEncoding::Octahedral;
+    }
+    return options;
+}
+
+namespace {
+
+template <typename T>
+uint64_t append(std::vector<unsigned char> &blob, const T *data, size_t count) {
+    // Keep every section 16 byte aligned for direct use from the mapped pack
+    blob.resize((blob.size() + 15) & ~size_t(15));
+    uint64_t offset = blob.size();
+    blob.insert(blob.end(), reinterpret_cast<const unsigned char *>(data), reinterpret_cast<const unsigned char *>(data + count));
+    return offset;
+}
+
+// The OBJ's material libraries, remembering the ones that opened so the
+// cooked mesh can be checked against them
+class RecordingMaterialReader : public tinyobj::MaterialReader {
+    public:
+        RecordingMaterialReader(const std::string &baseDir, std::vector<std::string> &opened) : files(baseDir), opened(opened) {}
+
+        bool operator()(const std::string &matId, std::vector<tinyobj::material_t> *materials,
+                        std::map<std::string, int> *matMap, std::string *warn, std::string *err) override {
+            if (!files(matId, materials, matMap, warn, err)) {
+                return false;
+            }
+            opened.push_back(matId);
+            return true;
+        }
+
+    private:
+        tinyobj::MaterialFileReader files;
+        std::vector<std::string> &opened;
+};
+
+}
+
+bool cookObjMesh(const std::string &objPath, const MeshCookOptions &options, std::vector<unsigned char> &blob,
+                 std::vector<std::string> &dependencies) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    // Material libraries are looked up next to the OBJ
+    const char *label = objPath.c_str();
+    std::string baseDir = objPath.substr(0, objPath.find_last_of('/') + 1);
+    std::ifstream objFile(objPath);
+    if (!objFile) {
+        std::cerr << "Cannot open OBJ file " << objPath << std::endl;
+        return false;
+    }
+    dependencies.clear();
+    RecordingMaterialReader materialReader(baseDir, dependencies);
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &objFile, &materialReader)) {
+        std::cerr << "Error loading OBJ file: " << warn << err << std::endl;
+        return false;
+    }
+
+    MeshBuilder builder;
+    builder.addObjShapes(attrib, shapes, options.flipV);
+    builder.printStats(label);
+    builder.optimize(label);
+
+    std::vector<MeshLod> lods = builder.buildLods(options.lods);
+    for (size_t i = 0; i < lods.size(); i++) {
+        std::cout << label << ": LOD" << i << " " << lods[i].indexCount / 3
+                  << " triangles, error " << lods[i].error << std::endl;
+    }
+
+    PackedVertices vertices = packVertices(builder.getVertices(), options.layout);
+    printVertexFormat(label, vertices, measureQuantizationError(builder.getVertices(), vertices));
+
+    std::vector<unsigned char> indices = builder.packIndices();
+
+    std::string texturePath;
+    if (!materials.empty()) {
+        texturePath = materials[0].diffuse_texname;
+    }
+
+    CookedMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    header.vertexCount = (uint32_t)builder.getVertices().size();
+    header.indexCount = (uint32_t)builder.getIndices().size();
+    header.indexSize = (uint32_t)builder.indexSize();
+    header.stride = (uint32_t)vertices.stride;
+    header.positionEncoding = (uint32_t)vertices.layout.position;
+    header.uvEncoding = (uint32_t)vertices.layout.uv;
+    header.normalEncoding = (uint32_t)vertices.layout.normal;
+    header.lodCount = (uint32_t)lods.size();
+    header.uvOffset = (uint32_t)vertices.uvOffset;
+    header.normalOffset = (uint32_t)vertices.normalOffset;
+    header.texturePathLength = (uint32_t)texturePath.size();
+    memcpy(header.dequantize, &vertices.dequantize[0][0], sizeof(header.dequantize));
+
+    glm::vec3 center;
+    builder.boundingSphere(center, header.boundsRadius);
+    memcpy(header.boundsCenter, &center[0], sizeof(header.boundsCenter));
+
+    blob.clear();
+    append(blob, &header, 1);
+    header.lodsOffset = append(blob, lods.data(), lods.size());
+    header.verticesOffset = append(blob, vertices.data.data(), vertices.data.size());
+    header.indicesOffset = append(blob, indices.data(), indices.size());
+    header.texturePathOffset = append(blob, texturePath.data(), texturePath.size());
+    memcpy(blob.data(), &header, sizeof(header));
+
+    return true;
+}
+
+bool readCookedMesh(const unsigned char *blob, size_t size, CookedMesh &mesh) {
+    if (size < sizeof(CookedMeshHeader)) {
+        return false;
+    }
+    const CookedMeshHeader *header = reinterpret_cast<const CookedMeshHeader *>(blob);
+    if (header->texturePathOffset + header->texturePathLength > size ||
+        header->indicesOffset + uint64_t(header->indexCount) * header->indexSize > size ||
+        header->verticesOffset + uint64_t(header->vertexCount) * header->stride > size ||
+        header->lodsOffset + uint64_t(header->lodCount) * sizeof(MeshLod) > size) {
+        return false;
+    }
+
+    mesh.header = header;
+    mesh.layout.position = (PositionEncoding)header->positionEncoding;
+    mesh.layout.uv = (UvEncoding)header->uvEncoding;
+    mesh.layout.normal = (NormalEncoding)header->normalEncoding;
+    mesh.lods = reinterpret_cast<const MeshLod *>(blob + header->lodsOffset);
+    mesh.vertices = blob + header->verticesOffset;
+    mesh.indices = blob + header->indicesOffset;
+    mesh.diffuseTexture.assign(reinterpret_cast<const char *>(blob + header->texturePathOffset), header->texturePathLength);
+    return true;
+}
+
+namespace {
+
+bool readFile(const std::string &path, std::vector<unsigned char> &bytes) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+    bytes.resize((size_t)in.tellg());
+    in.seekg(0);
+    return (bool)in.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+}
+
+bool cookTextureFromMemory(const std::string &label, const std::vector<unsigned char> &source,
+                           std::vector<unsigned char> &blob, unsigned threadCount) {
+    int w, h, channels;
+    unsigned char *img = stbi_load_from_memory(source.data(), (int)source.size(), &w, &h, &channels, 4);
+    if (!img) {
+        std::cerr << "Failed to load texture " << label << std::endl;
+        return false;
+    }
+
+    Image base;
+    base.width = w;
+    base.height = h;
+    base.rgba.assign(img, img + size_t(w) * h * 4);
+    stbi_image_free(img);
+
+    std::vector<Image> levels = buildMipChain(base, MipFilter::Kaiser);
+    TextureFormat format = base.hasAlpha() ? TextureFormat::BC3 : TextureFormat::BC1;
+
+    CookedTextureHeader header;
+    memset(&header, 0, sizeof(header));
+    header.width = w;
+    header.height = h;
+    header.format = (uint32_t)format;
+    header.levelCount = (uint32_t)std::min(levels.size(), size_t(kMaxTextureLevels));
+
+    blob.clear();
+    append(blob, &header, 1);
+
+    size_t uncompressedBytes = 0;
+    float psnr = 0.0f;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        std::vector<unsigned char> data = compressImage(levels[i], format, threadCount);
+        if (i == 0) {
+            psnr = measurePsnr(levels[0], decompressImage(data.data(), w, h, format));
+        }
+        header.levelOffsets[i] = append(blob, data.data(), data.size());
+        header.levelSizes[i] = data.size();
+        uncompressedBytes += size_t(levels[i].width) * levels[i].height * (channels == 4 ? 4 : 3);
+    }
+    memcpy(blob.data(), &header, sizeof(header));
+
+    size_t compressedBytes = 0;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        compressedBytes += header.levelSizes[i];
+    }
+    std::cout << label << ": " << w << "x" << h << " " << (format == TextureFormat::BC1 ? "BC1" : "BC3")
+              << ", " << header.levelCount << " levels, " << compressedBytes << " bytes (was " << uncompressedBytes
+              << ", " << float(uncompressedBytes) / float(compressedBytes) << "x smaller), PSNR " << psnr << " dB" << std::endl;
+    return true;
+}
+
+}
+
+bool cookTexture(const std::string &path, std::vector<unsigned char> &blob, unsigned threadCount) {
+    std::vector<unsigned char> source;
+    if (!readFile(path, source)) {
+        std::cerr << "Failed to load texture " << path << std::endl;
+        return false;
+    }
+    return cookTextureFromMemory(path, source, blob, threadCount);
+}
+
+bool cookTextureCached(const std::string &path, std::vector<unsigned char> &blob, unsigned threadCount) {
+    std::vector<unsigned char> source;
+    if (!readFile(path, source)) {
+        std::cerr << "Failed to load texture " << path << std::endl;
+        return false;
+    }
+
+    // FNV-1a over the source bytes and the blob layout version
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    for (unsigned char byte : source) {
+        mix(byte);
+    }
+    for (int i = 0; i < 4; i++) {
+        mix((unsigned char)(kAssetPackVersion >> (i * 8)));
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.tex", (unsigned long long)hash);
+    std::string cachePath = std::string(kTextureCacheDirectory) + "/" + name;
+
+    CookedTexture cached;
+    if (readFile(cachePath, blob) && readCookedTexture(blob.data(), blob.size(), cached)) {
+        return true;
+    }
+
+    if (!cookTextureFromMemory(path, source, blob, threadCount)) {
+        return false;
+    }
+
+    // A failed write only costs the next run another encode
+    std::error_code ec;
+    std::filesystem::create_directories(kTextureCacheDirectory, ec);
+    std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+    return true;
+}
+
+bool readCookedTexture(const unsigned char *blob, size_t size, CookedTexture &texture) {
+    if (size < sizeof(CookedTextureHeader)) {
+        return false;
+    }
+    const CookedTextureHeader *header = reinterpret_cast<const CookedTextureHeader *>(blob);
+    if (header->levelCount == 0 || header->levelCount > kMaxTextureLevels || header->format > (uint32_t)TextureFormat::BC3) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->levelCount; i++) {
+        if (header->levelOffsets[i] + header->levelSizes[i] > size) {
+            return false;
+        }
+        texture.levels[i] = blob + header->levelOffsets[i];
+    }
+    texture.header = header;
+    return true;
+}
+
+bool cookGltf(const std::string &path, std::vector<unsigned char> &blob, std::vector<std::string> &dependencies) {
+    return cookGltfModel(path, blob, dependencies);
+}
@@ -0,0 +1,100 @@
+#ifndef _ASSET_COOK_H_
+#define _ASSET_COOK_H_
+
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
+#include "TextureCompressor.h"
+#include "VertexFormat.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Turns source assets into the GPU-ready blobs stored in the asset pack. The
+// runtime runs the same code when the pack is missing or out of date, so a
+// cooked and an uncooked build always draw the same data.
+
+// How a given OBJ is welded, packed and simplified
+struct MeshCookOptions {
+    VertexLayout layout;
+    bool flipV = false;
+    LodSettings lods;
+    OccluderShape occluder = OccluderShape::Box;   // built when the mesh loads, not cooked
+};
+
+MeshCookOptions meshCookOptionsFor(const std::string &objPath);
+
+struct CookedMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;            // every LOD level
+    uint32_t indexSize;             // 2 or 4 bytes
+    uint32_t stride;
+
+    uint32_t positionEncoding;
+    uint32_t uvEncoding;
+    uint32_t normalEncoding;
+    uint32_t lodCount;
+
+    uint32_t uvOffset;
+    uint32_t normalOffset;
+    uint32_t texturePathLength;
+    uint32_t reserved;
+
+    float dequantize[16];
+    float boundsCenter[3];
+    float boundsRadius;
+
+    // From the start of the blob
+    uint64_t lodsOffset;
+    uint64_t verticesOffset;
+    uint64_t indicesOffset;
+    uint64_t texturePathOffset;
+};
+
+// Pointers into a cooked mesh blob, nothing is copied
+struct CookedMesh {
+    const CookedMeshHeader *header = nullptr;
+    VertexLayout layout;
+    const MeshLod *lods = nullptr;
+    const unsigned char *vertices = nullptr;
+    const unsigned char *indices = nullptr;
+    std::string diffuseTexture;     // as named by the material, relative to the OBJ
+};
+
+const uint32_t kMaxTextureLevels = 16;
+
+struct CookedTextureHeader {
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;                // TextureFormat
+    uint32_t levelCount;
+    uint64_t levelOffsets[kMaxTextureLevels];
+    uint64_t levelSizes[kMaxTextureLevels];
+};
+
+struct CookedTexture {
+    const CookedTextureHeader *header = nullptr;
+    const unsigned char *levels[kMaxTextureLevels] = {};
+};
+
+// dependencies receives the material libraries next to objPath it was read
+// from, since the blob keeps their diffuse texture path
+bool cookObjMesh(const std::string &objPath, const MeshCookOptions &options, std::vector<unsigned char> &blob,
+                 std::vector<std::string> &dependencies);
+bool readCookedMesh(const unsigned char *blob, size_t size, CookedMesh &mesh);
+
+// Full gamma-correct mip chain, block compressed: BC1 for opaque images, BC3
+// when any texel has alpha. threadCount 0 encodes on every core.
+bool cookTexture(const std::string &path, std::vector<unsigned char> &blob, unsigned threadCount = 0);
+
+// cookTexture() behind a disk cache in kTextureCacheDirectory, keyed by a hash
+// of the source bytes, so each image is only ever encoded once
+const char *const kTextureCacheDirectory = "texture_cache";
+bool cookTextureCached(const std::string &path, std::vector<unsigned char> &blob, unsigned threadCount = 0);
+bool readCookedTexture(const unsigned char *blob, size_t size, CookedTexture &texture);
+
+// Parsed glTF model with its skeletons, compressed clips and buffer data, see
+// cookGltfModel; dependencies receives the files besides path it was read from
+bool cookGltf(const std::string &path, std::vector<unsigned char> &blob, std::vector<std::string> &dependencies);
+
+#endif
@@ -0,0 +1,88 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <chrono>
+
+AssetLoader::AssetLoader(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers.emplace_back(&AssetLoader::workerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+AssetLoader &AssetLoader::instance() {
+    static AssetLoader loader;
+    return loader;
+}
+
+void AssetLoader::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Upload upload = job();
+
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        uploads.push_back(std::move(upload));
+    }
+}
+
+void AssetLoader::submit(Job job) {
+    outstanding++;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobReady.notify_one();
+}
+
+unsigned AssetLoader::pumpUploads(double budgetSeconds) {
+    auto start = std::chrono::steady_clock::now();
+    unsigned count = 0;
+
+    for (;;) {
+        Upload upload;
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            if (uploads.empty()) {
+                break;
+            }
+            upload = std::move(uploads.front());
+            uploads.pop_front();
+        }
+
+        if (upload) {
+            upload();
+        }
+        outstanding--;
+        count++;
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= budgetSeconds) {
+            break;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,59 @@
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Loads assets in the background. File I/O, parsing and decoding run on a pool
+// of worker threads; each job hands back an upload step that the GL thread runs
+// from pumpUploads() within a time budget, so frames keep coming while the
+// scene fills in.
+class AssetLoader {
+    public:
+        typedef std::function<void()> Upload;
+        typedef std::function<Upload()> Job;
+
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex jobMutex;
+        std::condition_variable jobReady;
+        std::deque<Job> jobs;
+        bool stopping = false;
+
+        std::mutex uploadMutex;
+        std::deque<Upload> uploads;
+
+        // Submitted jobs whose upload has not run yet
+        std::atomic<unsigned> outstanding{0};
+
+        void workerLoop();
+
+    public:
+        // One worker per core, less the GL thread
+        explicit AssetLoader(unsigned threadCount = 0);
+        ~AssetLoader();
+
+        AssetLoader(const AssetLoader &) = delete;
+        AssetLoader &operator=(const AssetLoader &) = delete;
+
+        static AssetLoader &instance();
+
+        // job runs on a worker; the Upload it returns (may be empty) runs later on the GL thread
+        void submit(Job job);
+
+        // Runs finished uploads on the calling thread until budgetSeconds have
+        // passed. At least one upload runs per call, so large ones cannot stall.
+        // Returns the number of uploads run.
+        unsigned pumpUploads(double budgetSeconds);
+
+        unsigned pending() const { return outstanding; }
+        unsigned threadCount() const { return (unsigned)workers.size(); }
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include "AssetPack.h"
+
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+std::string assetKey(const std::string &path) {
+    // Asset paths in the code do not always match the case on disk, which only
+    // matters on case sensitive file systems
+    std::string normalized(path);
+    for (char &c : normalized) {
+        c = c == '\\' ? '/' : (char)tolower((unsigned char)c);
+    }
+
+    size_t assets = normalized.find("assets/");
+    return assets == std::string::npos ? normalized : normalized.substr(assets + 7);
+}
+
+std::string findIgnoringCase(const std::string &path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::exists(path, ec)) {
+        return path;
+    }
+
+    auto lower = [](std::string name) {
+        for (char &c : name) {
+            c = (char)tolower((unsigned char)c);
+        }
+        return name;
+    };
+
+    // Resolve one component at a time, each in the directory found so far
+    fs::path found;
+    for (const fs::path &component : fs::path(path)) {
+        fs::path exact = found / component;
+        if (found.empty() || component == "." || component == ".." || fs::exists(exact, ec)) {
+            found = found.empty() ? component : exact;
+            continue;
+        }
+        std::string wanted = lower(component.string());
+        bool matched = false;
+        for (fs::directory_iterator it(found, ec), end; !ec && it != end; it.increment(ec)) {
+            if (lower(it->path().filename().string()) == wanted) {
+                found = it->path();
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            return path;
+        }
+    }
+    return found.generic_string();
+}
+
+bool sourceStamp(const std::string &path, uint64_t &size, int64_t &time) {
+    std::string found = findIgnoringCase(path);
+    std::error_code ec;
+    size = std::filesystem::file_size(found, ec);
+    if (ec) {
+        return false;
+    }
+    time = (int64_t)std::filesystem::last_write_time(found, ec).time_since_epoch().count();
+    return !ec;
+}
+
+namespace {
+
+std::string directoryOf(const std::string &path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+}
+
+AssetPack &AssetPack::instance() {
+    static AssetPack pack;
+    return pack;
+}
+
+bool AssetPack::open(const char *path) {
+    entries.clear();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    const AssetPackHeader *header = reinterpret_cast<const AssetPackHeader *>(file.data());
+    if (file.size() < sizeof(AssetPackHeader) || header->magic != kAssetPackMagic || header->version != kAssetPackVersion ||
+        header->tocOffset + header->entryCount * sizeof(AssetPackEntry) > file.size() ||
+        header->dependencyOffset + header->dependencyCount * sizeof(AssetPackDependency) > file.size()) {
+        std::cerr << "Ignoring asset pack " << path << " from another version" << std::endl;
+        file.close();
+        return false;
+    }
+
+    const AssetPackEntry *toc = reinterpret_cast<const AssetPackEntry *>(file.data() + header->tocOffset);
+    dependencies = reinterpret_cast<const AssetPackDependency *>(file.data() + header->dependencyOffset);
+    for (uint32_t i = 0; i < header->entryCount; i++) {
+        if (toc[i].offset + toc[i].size <= file.size() &&
+            uint64_t(toc[i].firstDependency) + toc[i].dependencyCount <= header->dependencyCount) {
+            entries[std::string(toc[i].key, strnlen(toc[i].key, sizeof(toc[i].key)))] = &toc[i];
+        }
+    }
+
+    std::cout << "Mapped asset pack " << path << " with " << entries.size() << " entries" << std::endl;
+    return true;
+}
+
+const unsigned char *AssetPack::find(const std::string &key, AssetType type, const std::string &sourcePath, size_t &size) const {
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second->type != (uint32_t)type) {
+        return nullptr;
+    }
+
+    const AssetPackEntry *entry = it->second;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (sourceStamp(sourcePath, sourceSize, sourceTime) &&
+        (sourceSize != entry->sourceSize || sourceTime != entry->sourceTime)) {
+        std::cout << "Asset pack entry " << key << " is stale, loading " << sourcePath << std::endl;
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < entry->dependencyCount; i++) {
+        const AssetPackDependency &dependency = dependencies[entry->firstDependency + i];
+        std::string path = directoryOf(sourcePath) + std::string(dependency.path, strnlen(dependency.path, sizeof(dependency.path)));
+        if (sourceStamp(path, sourceSize, sourceTime) &&
+            (sourceSize != dependency.sourceSize || sourceTime != dependency.sourceTime)) {
+            std::cout << "Asset pack entry " << key << " is stale, " << path << " has changed" << std::endl;
+            return nullptr;
+        }
+    }
+
+    size = (size_t)entry->size;
+    return file.data() + entry->offset;
+}
+
+bool AssetPackWriter::add(const std::string &key, AssetType type, const std::string &sourcePath, std::vector<unsigned char> data,
+                          const std::vector<std::string> &dependencies) {
+    Pending p;
+    memset(&p.entry, 0, sizeof(p.entry));
+    if (key.size() >= sizeof(p.entry.key)) {
+        std::cerr << "Asset key too long: " << key << std::endl;
+        return false;
+    }
+    memcpy(p.entry.key, key.data(), key.size());
+    p.entry.type = (uint32_t)type;
+    p.entry.size = data.size();
+    if (!sourceStamp(sourcePath, p.entry.sourceSize, p.entry.sourceTime)) {
+        std::cerr << "Cannot stat " << sourcePath << std::endl;
+        return false;
+    }
+    for (const std::string &path : dependencies) {
+        AssetPackDependency dependency;
+        memset(&dependency, 0, sizeof(dependency));
+        if (path.size() >= sizeof(dependency.path)) {
+            std::cerr << "Dependency path too long: " << path << std::endl;
+            return false;
+        }
+        memcpy(dependency.path, path.data(), path.size());
+        if (!sourceStamp(directoryOf(sourcePath) + path, dependency.sourceSize, dependency.sourceTime)) {
+            std::cerr << "Cannot stat " << path << " for " << sourcePath << std::endl;
+            return false;
+        }
+        p.dependencies.push_back(dependency);
+    }
+    p.data = std::move(data);
+    pending.push_back(std::move(p));
+    return true;
+}
+
+bool AssetPackWriter::write(const char *path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    auto align = [](uint64_t offset) {
+        return (offset + kAssetPackAlignment - 1) / kAssetPackAlignment * kAssetPackAlignment;
+    };
+
+    // Blob offsets are known up front, so the file is written in one pass
+    std::vector<AssetPackEntry> toc;
+    std::vector<AssetPackDependency> dependencies;
+    uint64_t offset = align(sizeof(AssetPackHeader));
+    for (const Pending &p : pending) {
+        AssetPackEntry entry = p.entry;
+        entry.offset = offset;
+        entry.firstDependency = (uint32_t)dependencies.size();
+        entry.dependencyCount = (uint32_t)p.dependencies.size();
+        dependencies.insert(dependencies.end(), p.dependencies.begin(), p.dependencies.end());
+        toc.push_back(entry);
+        offset = align(offset + p.data.size());
+    }
+
+    AssetPackHeader header;
+    header.magic = kAssetPackMagic;
+    header.version = kAssetPackVersion;
+    header.entryCount = (uint32_t)toc.size();
+    header.dependencyCount = (uint32_t)dependencies.size();
+    header.tocOffset = offset;
+    header.dependencyOffset = offset + toc.size() * sizeof(AssetPackEntry);
+
+    std::vector<char> padding(kAssetPackAlignment, 0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (size_t i = 0; i < pending.size(); i++) {
+        out.write(padding.data(), toc[i].offset - written);
+        out.write(reinterpret_cast<const char *>(pending[i].data.data()), pending[i].data.size());
+        written = toc[i].offset + pending[i].data.size();
+    }
+    out.write(padding.data(), offset - written);
+    out.write(reinterpret_cast<const char *>(toc.data()), toc.size() * sizeof(AssetPackEntry));
+    out.write(reinterpret_cast<const char *>(dependencies.data()), dependencies.size() * sizeof(AssetPackDependency));
+
+    return (bool)out;
+}
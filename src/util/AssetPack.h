@@ -0,0 +1,112 @@
+#ifndef _ASSET_PACK_H_
+#define _ASSET_PACK_H_
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binary pack of cooked assets, written by the asset_cooker target and mapped
+// at runtime so blobs can go straight to glBufferData/glTexImage2D.
+//
+// Layout: AssetPackHeader, the blobs (each aligned to kAssetPackAlignment),
+// then entryCount AssetPackEntry records at tocOffset and dependencyCount
+// AssetPackDependency records at dependencyOffset.
+
+const uint32_t kAssetPackMagic = 0x4b415047;    // "GPAK"
+const uint32_t kAssetPackVersion = 5;           // bump whenever a blob layout changes
+const uint64_t kAssetPackAlignment = 64;
+const char *const kAssetPackPath = "assets.pak";
+
+enum class AssetType : uint32_t {
+    Mesh = 1,
+    Texture = 2,
+    Gltf = 3,
+};
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t dependencyCount;
+    uint64_t tocOffset;
+    uint64_t dependencyOffset;
+};
+
+struct AssetPackEntry {
+    char key[192];
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+
+    // Source file state when cooked, used to detect stale entries
+    uint64_t sourceSize;
+    int64_t sourceTime;
+
+    // Other files the blob was cooked from
+    uint32_t firstDependency;
+    uint32_t dependencyCount;
+};
+
+// A file other than the source that went into an entry, such as a glTF's
+// buffers, named relative to the source's directory
+struct AssetPackDependency {
+    char path[192];
+    uint64_t sourceSize;
+    int64_t sourceTime;
+};
+
+// Lower case path below the assets directory, so the runtime ("../src/assets/...")
+// and the cooker (any absolute path) agree on keys
+std::string assetKey(const std::string &path);
+
+// path itself if it exists, otherwise the file whose path matches it ignoring
+// case, since asset names in the code and in glTF files do not always match the
+// disk; unchanged when neither exists
+std::string findIgnoringCase(const std::string &path);
+
+// Size and modification time of path, found ignoring case
+bool sourceStamp(const std::string &path, uint64_t &size, int64_t &time);
+
+class AssetPack {
+    MappedFile file;
+    std::unordered_map<std::string, const AssetPackEntry *> entries;
+    const AssetPackDependency *dependencies = nullptr;
+
+    public:
+        static AssetPack &instance();
+
+        bool open(const char *path);
+
+        // Cooked blob for key, or null if the pack does not have it or the source
+        // file or any of its dependencies has changed since it was cooked.
+        // Sources that are missing altogether are assumed to have been left out
+        // on purpose.
+        const unsigned char *find(const std::string &key, AssetType type, const std::string &sourcePath, size_t &size) const;
+
+        bool isOpen() const { return file.isOpen(); }
+};
+
+class AssetPackWriter {
+    struct Pending {
+        AssetPackEntry entry;
+        std::vector<unsigned char> data;
+        std::vector<AssetPackDependency> dependencies;
+    };
+    std::vector<Pending> pending;
+
+    public:
+        // dependencies are further files the blob was cooked from, relative to
+        // the directory of sourcePath
+        bool add(const std::string &key, AssetType type, const std::string &sourcePath, std::vector<unsigned char> data,
+                 const std::vector<std::string> &dependencies = std::vector<std::string>());
+
+        bool write(const char *path) const;
+
+        size_t size() const { return pending.size(); }
+};
+
+#endif
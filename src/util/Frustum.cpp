@@ -0,0 +1,187 @@
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+#include "SceneIndex.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+namespace {
+
+// Set bits in each four-bit lane mask
+const uint8_t kMaskBits[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+}
+
+void Frustum::extract(const glm::mat4 &viewProjection) {
+    // Rows of the column-major matrix
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    planes[0] = row[3] + row[0];    // left
+    planes[1] = row[3] - row[0];    // right
+    planes[2] = row[3] + row[1];    // bottom
+    planes[3] = row[3] - row[1];    // top
+    planes[4] = row[3] + row[2];    // near
+    planes[5] = row[3] - row[2];    // far
+
+    for (glm::vec4 &plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersectsSphere(glm::vec3 center, float radius) const {
+    for (const glm::vec4 &plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Frustum::cullSpheres(const SphereSoA &spheres, uint8_t *visible) const {
+    size_t count = spheres.size();
+    const float *xs = spheres.x.data();
+    const float *ys = spheres.y.data();
+    const float *zs = spheres.z.data();
+    const float *radii = spheres.radius.data();
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#if defined(FRUSTUM_AVX)
+    __m256 px[6], py[6], pz[6], pw[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm256_set1_ps(planes[p].x);
+        py[p] = _mm256_set1_ps(planes[p].y);
+        pz[p] = _mm256_set1_ps(planes[p].z);
+        pw[p] = _mm256_set1_ps(planes[p].w);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+        __m256 z = _mm256_loadu_ps(zs + i);
+        __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(radii + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            // Summed in intersectsSphere's order, so spheres touching a plane agree
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+                                                          _mm256_mul_ps(pz[p], z)), pw[p]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_NLT_UQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+        visibleCount += kMaskBits[mask & 0xf] + kMaskBits[mask >> 4];
+    }
+#elif defined(FRUSTUM_SSE)
+    __m128 px[6], py[6], pz[6], pw[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm_set1_ps(planes[p].x);
+        py[p] = _mm_set1_ps(planes[p].y);
+        pz[p] = _mm_set1_ps(planes[p].z);
+        pw[p] = _mm_set1_ps(planes[p].w);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        // Two independent groups of four keep both halves of the pipeline busy
+        __m128 x0 = _mm_loadu_ps(xs + i), x1 = _mm_loadu_ps(xs + i + 4);
+        __m128 y0 = _mm_loadu_ps(ys + i), y1 = _mm_loadu_ps(ys + i + 4);
+        __m128 z0 = _mm_loadu_ps(zs + i), z1 = _mm_loadu_ps(zs + i + 4);
+        __m128 r0 = _mm_sub_ps(zero, _mm_loadu_ps(radii + i));
+        __m128 r1 = _mm_sub_ps(zero, _mm_loadu_ps(radii + i + 4));
+
+        __m128 inside0 = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        __m128 inside1 = inside0;
+        for (int p = 0; p < 6; p++) {
+            // Summed in intersectsSphere's order, so spheres touching a plane agree
+            __m128 d0 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x0), _mm_mul_ps(py[p], y0)),
+                                              _mm_mul_ps(pz[p], z0)), pw[p]);
+            __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x1), _mm_mul_ps(py[p], y1)),
+                                              _mm_mul_ps(pz[p], z1)), pw[p]);
+            inside0 = _mm_and_ps(inside0, _mm_cmpnlt_ps(d0, r0));
+            inside1 = _mm_and_ps(inside1, _mm_cmpnlt_ps(d1, r1));
+        }
+
+        int mask = _mm_movemask_ps(inside0) | (_mm_movemask_ps(inside1) << 4);
+        for (int lane = 0; lane < 8; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+        }
+        visibleCount += kMaskBits[mask & 0xf] + kMaskBits[mask >> 4];
+    }
+#endif
+
+    for (; i < count; i++) {
+        visible[i] = intersectsSphere(glm::vec3(xs[i], ys[i], zs[i]), radii[i]) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+void SphereSoA::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+void SphereSoA::add(glm::vec3 center, float sphereRadius) {
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(sphereRadius);
+}
+
+void FrustumCuller::beginFrame(const glm::mat4 &viewProjection) {
+    frustum.extract(viewProjection);
+    frameDrawn = 0;
+    frameCulled = 0;
+    frameOccluded = 0;
+}
+
+bool FrustumCuller::occluded(glm::vec3 center, float radius) {
+    if (!occlusion || occlusion->testSphere(center, radius)) {
+        return false;
+    }
+    frameOccluded++;
+    return true;
+}
+
+void FrustumCuller::cull(const SceneIndex &index, std::vector<uint32_t> &visible) {
+    index.queryFrustum(frustum, visible, &queried);
+    frameCulled += index.size() - visible.size();
+    if (occlusion) {
+        size_t kept = 0;
+        for (size_t i = 0; i < visible.size(); i++) {
+            if (!occluded(glm::vec3(queried.x[i], queried.y[i], queried.z[i]), queried.radius[i])) {
+                visible[kept] = visible[i];
+                queried.x[kept] = queried.x[i];
+                queried.y[kept] = queried.y[i];
+                queried.z[kept] = queried.z[i];
+                queried.radius[kept] = queried.radius[i];
+                kept++;
+            }
+        }
+        visible.resize(kept);
+        queried.x.resize(kept);
+        queried.y.resize(kept);
+        queried.z.resize(kept);
+        queried.radius.resize(kept);
+    }
+    frameDrawn += visible.size();
+}
+
+void FrustumCuller::endFrame() {
+    lastDrawn = frameDrawn;
+    lastCulled = frameCulled;
+    lastOccluded = frameOccluded;
+}
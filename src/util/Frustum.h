@@ -0,0 +1,81 @@
+#ifndef _FRUSTUM_H_
+#define _FRUSTUM_H_
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class OcclusionCuller;
+class SceneIndex;
+
+// Bounding spheres as one array per component, so the culling pass loads the
+// x, y, z and radius of several spheres with one instruction each
+struct SphereSoA {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    void clear();
+    void add(glm::vec3 center, float radius);
+    size_t size() const { return x.size(); }
+};
+
+// View frustum as six inward-facing planes (xyz normal, w distance), taken
+// from a view-projection matrix (Gribb & Hartmann)
+struct Frustum {
+    glm::vec4 planes[6];
+
+    void extract(const glm::mat4 &viewProjection);
+
+    // Conservative: may accept spheres just outside a corner
+    bool intersectsSphere(glm::vec3 center, float radius) const;
+
+    // The same test over every sphere, eight at a time with AVX or two SSE
+    // registers of four: visible[i] is set to 1 for spheres intersectsSphere
+    // accepts and 0 for the rest. Returns how many are visible.
+    size_t cullSpheres(const SphereSoA &spheres, uint8_t *visible) const;
+};
+
+// The frame's frustum, and counts of the objects drawn and culled against it
+// for the stats readout. Everything drawn is culled through a SceneIndex. With
+// an occlusion culler set, whatever passes the frustum is also tested against
+// its depth buffer.
+class FrustumCuller {
+    Frustum frustum;
+    const OcclusionCuller *occlusion = nullptr;
+    SphereSoA queried;                  // bounds of what the last cull kept, in visible's order
+
+    unsigned long frameDrawn = 0;
+    unsigned long frameCulled = 0;
+    unsigned long frameOccluded = 0;
+    unsigned long lastDrawn = 0;
+    unsigned long lastCulled = 0;
+    unsigned long lastOccluded = 0;
+
+    bool occluded(glm::vec3 center, float radius);
+
+    public:
+        void beginFrame(const glm::mat4 &viewProjection);
+
+        // occlusion must be rasterised before anything is culled, or null to skip the test
+        void setOcclusion(const OcclusionCuller *occlusion) { this->occlusion = occlusion; }
+
+        // The userData of the entities in index that are in view, replacing
+        // visible's contents; everything else in the index counts as culled
+        // or occluded
+        void cull(const SceneIndex &index, std::vector<uint32_t> &visible);
+
+        // The spheres of the last cull's visible entities, index for index
+        const SphereSoA &visibleBounds() const { return queried; }
+
+        void endFrame();
+
+        unsigned long drawnLastFrame() const { return lastDrawn; }
+        unsigned long culledLastFrame() const { return lastCulled; }
+        unsigned long occludedLastFrame() const { return lastOccluded; }
+};
+
+#endif
@@ -0,0 +1,847 @@
+#include "GltfModel.h"
+#include "AnimationCompression.h"
+#include "AssetPack.h"
+#include "MeshOptimizer.h"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <tinygltf/json.hpp>
+
+namespace {
+
+using json = nlohmann::json;
+
+const uint32_t kGlbMagic = 0x46546c67;         // "glTF"
+const uint32_t kGlbChunkJson = 0x4e4f534a;
+const uint32_t kGlbChunkBin = 0x004e4942;
+
+const int kComponentUnsignedByte = 5121;
+const int kComponentUnsignedShort = 5123;
+const int kComponentFloat = 5126;
+
+struct BufferView {
+    int buffer = 0;
+    size_t byteOffset = 0;
+    size_t byteLength = 0;
+    size_t byteStride = 0;
+};
+
+struct Accessor {
+    int bufferView = -1;
+    size_t byteOffset = 0;
+    int componentType = kComponentFloat;
+    size_t count = 0;
+    int components = 1;
+    bool normalized = false;
+};
+
+int componentCount(const std::string &type) {
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT2") return 4;
+    if (type == "MAT3") return 9;
+    if (type == "MAT4") return 16;
+    return 1;
+}
+
+size_t componentSize(int componentType) {
+    switch (componentType) {
+        case 5120: case 5121: return 1;
+        case 5122: case 5123: return 2;
+        default:              return 4;
+    }
+}
+
+// JSON and binary data of one file, with accessors resolved to raw pointers
+struct GltfSource {
+    json doc;
+    std::vector<std::shared_ptr<MappedFile>> files;
+    std::vector<std::string> dependencies;     // external files, relative to the .gltf
+    std::vector<const unsigned char *> buffers;
+    std::vector<size_t> bufferSizes;
+    std::vector<BufferView> views;
+    std::vector<Accessor> accessors;
+
+    size_t stride(const Accessor &accessor) const {
+        size_t packed = componentSize(accessor.componentType) * accessor.components;
+        const BufferView &view = views[accessor.bufferView];
+        return view.byteStride ? view.byteStride : packed;
+    }
+
+    const unsigned char *data(const Accessor &accessor) const {
+        const BufferView &view = views[accessor.bufferView];
+        return buffers[view.buffer] + view.byteOffset + accessor.byteOffset;
+    }
+
+    // Float accessor into components-wide rows, padding or truncating each element
+    bool readFloats(int accessorIndex, int components, std::vector<float> &out) const {
+        if (accessorIndex < 0 || accessorIndex >= (int)accessors.size()) {
+            return false;
+        }
+        const Accessor &accessor = accessors[accessorIndex];
+        if (accessor.componentType != kComponentFloat || accessor.bufferView < 0) {
+            return false;
+        }
+        out.assign(accessor.count * components, 0.0f);
+        const unsigned char *src = data(accessor);
+        size_t step = stride(accessor);
+        size_t copy = std::min(accessor.components, components) * sizeof(float);
+        for (size_t i = 0; i < accessor.count; i++) {
+            memcpy(&out[i * components], src + i * step, copy);
+        }
+        return true;
+    }
+};
+
+std::string directoryOf(const std::string &path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+bool parseSource(const std::string &path, GltfSource &source) {
+    bool binary = path.size() > 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(findIgnoringCase(path).c_str())) {
+        std::cerr << "Failed to open glTF: " << path << std::endl;
+        return false;
+    }
+    const unsigned char *bytes = file->data();
+    size_t size = file->size();
+    source.files.push_back(file);
+
+    const char *jsonBegin = reinterpret_cast<const char *>(bytes);
+    const char *jsonEnd = jsonBegin + size;
+    const unsigned char *bin = nullptr;
+    size_t binSize = 0;
+
+    if (binary) {
+        uint32_t header[3];
+        if (size < 20) {
+            std::cerr << "Truncated glb: " << path << std::endl;
+            return false;
+        }
+        memcpy(header, bytes, sizeof(header));
+        if (header[0] != kGlbMagic || header[1] != 2 || header[2] > size) {
+            std::cerr << "Not a glTF 2.0 glb: " << path << std::endl;
+            return false;
+        }
+
+        // Chunks: JSON first, then an optional BIN, each with an 8 byte header
+        size_t offset = 12;
+        while (offset + 8 <= header[2]) {
+            uint32_t chunk[2];
+            memcpy(chunk, bytes + offset, sizeof(chunk));
+            const unsigned char *chunkData = bytes + offset + 8;
+            if (offset + 8 + chunk[0] > header[2]) {
+                break;
+            }
+            if (chunk[1] == kGlbChunkJson) {
+                jsonBegin = reinterpret_cast<const char *>(chunkData);
+                jsonEnd = jsonBegin + chunk[0];
+            } else if (chunk[1] == kGlbChunkBin && !bin) {
+                bin = chunkData;
+                binSize = chunk[0];
+            }
+            offset += 8 + ((chunk[0] + 3) & ~3u);
+        }
+    }
+
+    source.doc = json::parse(jsonBegin, jsonEnd, nullptr, false);
+    if (source.doc.is_discarded()) {
+        std::cerr << "Invalid glTF JSON: " << path << std::endl;
+        return false;
+    }
+    json &doc = source.doc;
+
+    for (const json &buffer : doc.value("buffers", json::array())) {
+        size_t byteLength = buffer.value("byteLength", size_t(0));
+        if (!buffer.contains("uri")) {
+            if (!bin || binSize < byteLength) {
+                std::cerr << "glTF buffer without data: " << path << std::endl;
+                return false;
+            }
+            source.buffers.push_back(bin);
+            source.bufferSizes.push_back(binSize);
+            continue;
+        }
+
+        std::string uri = buffer["uri"].get<std::string>();
+        if (uri.compare(0, 5, "data:") == 0) {
+            std::cerr << "Embedded glTF buffers are not supported: " << path << std::endl;
+            return false;
+        }
+        auto bufferFile = std::make_shared<MappedFile>();
+        if (!bufferFile->open(findIgnoringCase(directoryOf(path) + uri).c_str()) || bufferFile->size() < byteLength) {
+            std::cerr << "Failed to open glTF buffer " << uri << " for " << path << std::endl;
+            return false;
+        }
+        source.buffers.push_back(bufferFile->data());
+        source.bufferSizes.push_back(bufferFile->size());
+        source.files.push_back(bufferFile);
+        source.dependencies.push_back(uri);
+    }
+
+    // Images are not loaded here, but a cooked model is still stale once they change
+    for (const json &image : doc.value("images", json::array())) {
+        std::string uri = image.value("uri", std::string());
+        if (!uri.empty() && uri.compare(0, 5, "data:") != 0) {
+            source.dependencies.push_back(uri);
+        }
+    }
+
+    for (const json &view : doc.value("bufferViews", json::array())) {
+        BufferView v;
+        v.buffer = view.value("buffer", 0);
+        v.byteOffset = view.value("byteOffset", size_t(0));
+        v.byteLength = view.value("byteLength", size_t(0));
+        v.byteStride = view.value("byteStride", size_t(0));
+        if (v.buffer < 0 || v.buffer >= (int)source.buffers.size() || v.byteOffset + v.byteLength > source.bufferSizes[v.buffer]) {
+            std::cerr << "glTF buffer view out of range: " << path << std::endl;
+            return false;
+        }
+        source.views.push_back(v);
+    }
+
+    for (const json &accessor : doc.value("accessors", json::array())) {
+        Accessor a;
+        a.bufferView = accessor.value("bufferView", -1);
+        a.byteOffset = accessor.value("byteOffset", size_t(0));
+        a.componentType = accessor.value("componentType", kComponentFloat);
+        a.count = accessor.value("count", size_t(0));
+        a.components = componentCount(accessor.value("type", std::string("SCALAR")));
+        a.normalized = accessor.value("normalized", false);
+        if (a.bufferView >= (int)source.views.size()) {
+            std::cerr << "glTF accessor without a buffer view: " << path << std::endl;
+            return false;
+        }
+        source.accessors.push_back(a);
+    }
+
+    return true;
+}
+
+glm::mat4 nodeTransform(const json &node) {
+    if (node.contains("matrix")) {
+        std::vector<float> m = node["matrix"].get<std::vector<float>>();
+        if (m.size() == 16) {
+            return glm::make_mat4(m.data());
+        }
+    }
+
+    glm::mat4 transform(1.0f);
+    if (node.contains("translation")) {
+        std::vector<float> t = node["translation"].get<std::vector<float>>();
+        transform = glm::translate(transform, glm::vec3(t[0], t[1], t[2]));
+    }
+    if (node.contains("rotation")) {
+        std::vector<float> r = node["rotation"].get<std::vector<float>>();
+        transform *= glm::mat4_cast(glm::quat(r[3], r[0], r[1], r[2]));
+    }
+    if (node.contains("scale")) {
+        std::vector<float> s = node["scale"].get<std::vector<float>>();
+        transform = glm::scale(transform, glm::vec3(s[0], s[1], s[2]));
+    }
+    return transform;
+}
+
+GLuint attributeLocation(const std::string &name) {
+    if (name == "POSITION")   return kGltfPositionLocation;
+    if (name == "NORMAL")     return kGltfNormalLocation;
+    if (name == "TEXCOORD_0") return kGltfTexcoordLocation;
+    if (name == "JOINTS_0")   return kGltfJointsLocation;
+    if (name == "WEIGHTS_0")  return kGltfWeightsLocation;
+    if (name == "COLOR_0")    return kGltfColorLocation;
+    return ~0u;
+}
+
+// What the GL thread has to create: buffers per view, then VAOs over them
+struct BufferUpload {
+    GLenum target;
+    const unsigned char *data;
+    size_t size;
+    std::shared_ptr<std::vector<unsigned char>> copy;     // optimised index data
+};
+
+}
+
+size_t GltfModel::residentBytes() const {
+    size_t bytes = sizeof(GltfModel);
+    bytes += nodes.capacity() * sizeof(GltfNode) + sceneRoots.capacity() * sizeof(int);
+    for (const GltfNode &node : nodes) {
+        bytes += node.children.capacity() * sizeof(int);
+    }
+    bytes += meshes.capacity() * sizeof(GltfMesh) + primitives.capacity() * sizeof(GltfPrimitive);
+    for (const GltfPrimitive &primitive : primitives) {
+        bytes += primitive.attributes.capacity() * sizeof(GltfAttribute);
+    }
+    bytes += draws.capacity() * sizeof(GltfDraw);
+    for (const Skeleton &skin : skins) {
+        bytes += skin.residentBytes();
+    }
+    for (const AnimationClip &animation : animations) {
+        bytes += animation.residentBytes();
+    }
+    return bytes + bufferIDs.capacity() * sizeof(GLuint);
+}
+
+GltfModel::~GltfModel() {
+    // Models built by the cooker never reach the GL thread
+    for (const GltfPrimitive &primitive : primitives) {
+        if (primitive.vertexArrayID) {
+            glDeleteVertexArrays(1, &primitive.vertexArrayID);
+        }
+    }
+    if (!bufferIDs.empty()) {
+        glDeleteBuffers((GLsizei)bufferIDs.size(), bufferIDs.data());
+    }
+}
+
+GLuint createGltfVertexArray(const GltfModel &model, const GltfPrimitive &primitive) {
+    GLuint vertexArrayID;
+    glGenVertexArrays(1, &vertexArrayID);
+    glBindVertexArray(vertexArrayID);
+    for (const GltfAttribute &attribute : primitive.attributes) {
+        glBindBuffer(GL_ARRAY_BUFFER, model.bufferIDs[attribute.buffer]);
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                              attribute.stride, (void *)attribute.offset);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.bufferIDs[primitive.indexBuffer]);
+    return vertexArrayID;
+}
+
+void optimizeGltfIndices(void *indexData, int componentType, size_t indexCount,
+                         const float *positions, size_t positionStride, size_t vertexCount, const char *label) {
+    unsigned char *bytes = static_cast<unsigned char *>(indexData);
+
+    std::vector<uint32_t> indices(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        switch (componentType) {
+            case kComponentUnsignedByte:  indices[i] = bytes[i]; break;
+            case kComponentUnsignedShort: { uint16_t v; memcpy(&v, bytes + i * 2, 2); indices[i] = v; break; }
+            default:                      memcpy(&indices[i], bytes + i * 4, 4); break;
+        }
+    }
+
+    VertexCacheStats before = analyzeVertexCache(indices, vertexCount);
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertexCount, kVertexCacheSize, &clusters);
+    optimizeOverdraw(indices, positions, positionStride, vertexCount, clusters);
+
+    for (size_t i = 0; i < indexCount; i++) {
+        switch (componentType) {
+            case kComponentUnsignedByte:  bytes[i] = (unsigned char)indices[i]; break;
+            case kComponentUnsignedShort: { uint16_t v = (uint16_t)indices[i]; memcpy(bytes + i * 2, &v, 2); break; }
+            default:                      memcpy(bytes + i * 4, &indices[i], 4); break;
+        }
+    }
+
+    printVertexCacheStats(label, before, analyzeVertexCache(indices, vertexCount));
+}
+
+namespace {
+
+// Everything but the GL objects, from a parsed source. Index buffers are copied
+// and reordered for the vertex cache, vertex data points into the source.
+std::shared_ptr<GltfModel> buildModel(const std::string &path, const GltfSource &source, std::vector<BufferUpload> &uploads) {
+    const json &doc = source.doc;
+
+    auto model = std::make_shared<GltfModel>();
+
+    for (const json &node : doc.value("nodes", json::array())) {
+        GltfNode n;
+        n.localTransform = nodeTransform(node);
+        n.mesh = node.value("mesh", -1);
+        n.children = node.value("children", std::vector<int>());
+        model->nodes.push_back(std::move(n));
+    }
+
+    const json &scenes = doc.value("scenes", json::array());
+    int scene = doc.value("scene", 0);
+    if (scene < (int)scenes.size()) {
+        model->sceneRoots = scenes[scene].value("nodes", std::vector<int>());
+    }
+
+    for (const json &skin : doc.value("skins", json::array())) {
+        std::vector<int> joints = skin.value("joints", std::vector<int>());
+        std::vector<glm::mat4> inverseBindMatrices;
+        std::vector<float> matrices;
+        if (source.readFloats(skin.value("inverseBindMatrices", -1), 16, matrices)) {
+            for (size_t i = 0; i + 16 <= matrices.size(); i += 16) {
+                inverseBindMatrices.push_back(glm::make_mat4(&matrices[i]));
+            }
+        }
+        inverseBindMatrices.resize(joints.size(), glm::mat4(1.0f));
+        model->skins.push_back(buildSkeleton(*model, joints, inverseBindMatrices));
+    }
+
+    // Samplers are decoded once here and copied into the clip per channel
+    struct Sampler {
+        std::vector<float> input;
+        std::vector<float> output;
+        Interpolation interpolation = Interpolation::Linear;
+    };
+    for (const json &animation : doc.value("animations", json::array())) {
+        std::vector<Sampler> samplers;
+        for (const json &sampler : animation.value("samplers", json::array())) {
+            Sampler s;
+            std::string interpolation = sampler.value("interpolation", std::string("LINEAR"));
+            s.interpolation = interpolation == "STEP" ? Interpolation::Step
+                            : interpolation == "CUBICSPLINE" ? Interpolation::CubicSpline : Interpolation::Linear;
+            source.readFloats(sampler.value("input", -1), 1, s.input);
+            source.readFloats(sampler.value("output", -1), 4, s.output);
+            samplers.push_back(std::move(s));
+        }
+
+        AnimationClip clip;
+        for (const json &channel : animation.value("channels", json::array())) {
+            const json &target = channel.value("target", json::object());
+            std::string targetPath = target.value("path", std::string());
+
+            int samplerIndex = channel.value("sampler", 0);
+            int targetNode = target.value("node", -1);
+            AnimationPath path = targetPath == "rotation" ? AnimationPath::Rotation
+                               : targetPath == "scale" ? AnimationPath::Scale
+                               : targetPath == "weights" ? AnimationPath::Weights : AnimationPath::Translation;
+            if (targetNode < 0 || targetNode >= (int)model->nodes.size() || path == AnimationPath::Weights ||
+                samplerIndex < 0 || samplerIndex >= (int)samplers.size()) {
+                continue;
+            }
+
+            const Sampler &sampler = samplers[samplerIndex];
+            size_t valuesPerKey = sampler.interpolation == Interpolation::CubicSpline ? 3 : 1;
+            if (sampler.input.size() < 2 || sampler.output.size() / 4 < sampler.input.size() * valuesPerKey) {
+                continue;
+            }
+            clip.addTrack(targetNode, path, sampler.interpolation, sampler.input.data(), sampler.input.size(),
+                          reinterpret_cast<const glm::vec4 *>(sampler.output.data()), valuesPerKey);
+        }
+        model->animations.push_back(compressAnimationClip(clip));
+    }
+
+    // Buffer views to upload, each one once however many primitives use it
+    std::map<int, int> viewBuffers;
+    std::set<int> optimizedAccessors;
+
+    auto bufferFor = [&](int view, GLenum target) {
+        auto it = viewBuffers.find(view);
+        if (it != viewBuffers.end()) {
+            return it->second;
+        }
+        const BufferView &v = source.views[view];
+        BufferUpload upload = {target, source.buffers[v.buffer] + v.byteOffset, v.byteLength, nullptr};
+        uploads.push_back(upload);
+        viewBuffers[view] = (int)uploads.size() - 1;
+        return (int)uploads.size() - 1;
+    };
+
+    for (const json &mesh : doc.value("meshes", json::array())) {
+        GltfMesh m;
+        m.firstPrimitive = (int)model->primitives.size();
+        std::string meshName = mesh.value("name", path);
+
+        for (const json &primitive : mesh.value("primitives", json::array())) {
+            int indices = primitive.value("indices", -1);
+            if (indices < 0 || indices >= (int)source.accessors.size() || source.accessors[indices].bufferView < 0) {
+                std::cerr << "Skipping non-indexed primitive in " << path << std::endl;
+                continue;
+            }
+
+            GltfPrimitive gp;
+            const json &attributes = primitive.value("attributes", json::object());
+            for (auto it = attributes.begin(); it != attributes.end(); ++it) {
+                GLuint location = attributeLocation(it.key());
+                int accessorIndex = it.value().get<int>();
+                if (location == ~0u || accessorIndex < 0 || accessorIndex >= (int)source.accessors.size()) {
+                    continue;
+                }
+                const Accessor &accessor = source.accessors[accessorIndex];
+                if (accessor.bufferView < 0) {
+                    continue;
+                }
+                GltfAttribute binding;
+                binding.location = location;
+                binding.buffer = bufferFor(accessor.bufferView, GL_ARRAY_BUFFER);
+                binding.size = accessor.components;
+                binding.type = (GLenum)accessor.componentType;
+                binding.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+                binding.stride = (GLsizei)source.views[accessor.bufferView].byteStride;
+                binding.offset = accessor.byteOffset;
+                gp.attributes.push_back(binding);
+            }
+
+            const Accessor &indexAccessor = source.accessors[indices];
+            gp.indexBuffer = bufferFor(indexAccessor.bufferView, GL_ELEMENT_ARRAY_BUFFER);
+
+            gp.mode = (GLenum)primitive.value("mode", 4);
+            gp.indexCount = (GLsizei)indexAccessor.count;
+            gp.indexType = (GLenum)indexAccessor.componentType;
+            gp.indexOffset = indexAccessor.byteOffset;
+
+            // Indices are reordered in a private copy; vertex data is shared
+            // between primitives, so only triangle order changes
+            int positionAccessor = attributes.value("POSITION", -1);
+            if (gp.mode == GL_TRIANGLES && positionAccessor >= 0 && optimizedAccessors.insert(indices).second) {
+                BufferUpload &upload = uploads[gp.indexBuffer];
+                if (!upload.copy) {
+                    upload.copy = std::make_shared<std::vector<unsigned char>>(upload.data, upload.data + upload.size);
+                    upload.data = upload.copy->data();
+                }
+                const Accessor &positions = source.accessors[positionAccessor];
+                optimizeGltfIndices(upload.copy->data() + indexAccessor.byteOffset, indexAccessor.componentType, indexAccessor.count,
+                                    reinterpret_cast<const float *>(source.data(positions)), source.stride(positions),
+                                    positions.count, meshName.c_str());
+            }
+
+            model->primitives.push_back(std::move(gp));
+        }
+
+        m.primitiveCount = (int)model->primitives.size() - m.firstPrimitive;
+        model->meshes.push_back(m);
+    }
+
+    // Flatten the scene in depth-first order, the same order the recursive walk drew in
+    std::vector<int> stack(model->sceneRoots.rbegin(), model->sceneRoots.rend());
+    while (!stack.empty()) {
+        int nodeIndex = stack.back();
+        stack.pop_back();
+        if (nodeIndex < 0 || nodeIndex >= (int)model->nodes.size()) {
+            continue;
+        }
+        const GltfNode &node = model->nodes[nodeIndex];
+        if (node.mesh >= 0 && node.mesh < (int)model->meshes.size()) {
+            const GltfMesh &mesh = model->meshes[node.mesh];
+            for (int p = mesh.firstPrimitive; p < mesh.firstPrimitive + mesh.primitiveCount; p++) {
+                const GltfPrimitive &primitive = model->primitives[p];
+                GltfDraw draw;
+                draw.mode = primitive.mode;
+                draw.indexCount = primitive.indexCount;
+                draw.indexType = primitive.indexType;
+                draw.indexOffset = primitive.indexOffset;
+                draw.node = nodeIndex;
+                draw.primitive = p;
+                model->draws.push_back(draw);
+            }
+        }
+        stack.insert(stack.end(), node.children.rbegin(), node.children.rend());
+    }
+
+    return model;
+}
+
+// Cooked models are a flat sequence of values and counted arrays, read back in
+// the order they were written; buffer data is 16 byte aligned so it can be
+// uploaded straight from the mapped pack
+const uint32_t kCookedGltfMagic = 0x4d46544b;   // "KTFM"
+
+template <typename T>
+void write(std::vector<unsigned char> &blob, const T &value) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+    blob.insert(blob.end(), bytes, bytes + sizeof(T));
+}
+
+// Only for element types without padding, so the pack comes out the same on every run
+template <typename T>
+void writeArray(std::vector<unsigned char> &blob, const std::vector<T> &values) {
+    write(blob, uint64_t(values.size()));
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(values.data());
+    blob.insert(blob.end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+struct BlobReader {
+    const unsigned char *cursor;
+    const unsigned char *end;
+    bool ok = true;
+
+    template <typename T>
+    T read() {
+        T value = T();
+        if (size_t(end - cursor) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    void readArray(std::vector<T> &values) {
+        uint64_t count = read<uint64_t>();
+        if (!ok || count > size_t(end - cursor) / sizeof(T)) {
+            ok = false;
+            values.clear();
+            return;
+        }
+        values.resize(count);
+        memcpy(values.data(), cursor, count * sizeof(T));
+        cursor += count * sizeof(T);
+    }
+
+    // An element count, refused when fewer than count * minimumSize bytes are left
+    size_t count(size_t minimumSize) {
+        uint64_t value = read<uint64_t>();
+        if (!ok || value > size_t(end - cursor) / minimumSize) {
+            ok = false;
+            return 0;
+        }
+        return size_t(value);
+    }
+
+    const unsigned char *bytes(size_t count) {
+        if (!ok || count > size_t(end - cursor)) {
+            ok = false;
+            return nullptr;
+        }
+        const unsigned char *start = cursor;
+        cursor += count;
+        return start;
+    }
+};
+
+void writeCookedModel(const GltfModel &model, const std::vector<BufferUpload> &uploads, std::vector<unsigned char> &blob) {
+    blob.clear();
+    write(blob, kCookedGltfMagic);
+
+    write(blob, uint64_t(model.nodes.size()));
+    for (const GltfNode &node : model.nodes) {
+        write(blob, node.localTransform);
+        write(blob, node.mesh);
+        writeArray(blob, node.children);
+    }
+    writeArray(blob, model.sceneRoots);
+    writeArray(blob, model.meshes);
+
+    write(blob, uint64_t(model.primitives.size()));
+    for (const GltfPrimitive &primitive : model.primitives) {
+        write(blob, primitive.mode);
+        write(blob, primitive.indexCount);
+        write(blob, primitive.indexType);
+        write(blob, uint64_t(primitive.indexOffset));
+        write(blob, primitive.indexBuffer);
+        write(blob, uint64_t(primitive.attributes.size()));
+        for (const GltfAttribute &attribute : primitive.attributes) {
+            write(blob, attribute.location);
+            write(blob, attribute.buffer);
+            write(blob, attribute.size);
+            write(blob, attribute.type);
+            write(blob, uint32_t(attribute.normalized));
+            write(blob, attribute.stride);
+            write(blob, uint64_t(attribute.offset));
+        }
+    }
+    writeArray(blob, model.draws);
+
+    write(blob, uint64_t(model.skins.size()));
+    for (const Skeleton &skin : model.skins) {
+        writeArray(blob, skin.nodes);
+        writeArray(blob, skin.parents);
+        writeArray(blob, skin.jointEntries);
+        writeArray(blob, skin.inverseBindMatrices);
+    }
+
+    write(blob, uint64_t(model.animations.size()));
+    for (const AnimationClip &clip : model.animations) {
+        write(blob, uint64_t(clip.tracks.size()));
+        for (const AnimationTrack &track : clip.tracks) {
+            write(blob, track.targetNode);
+            write(blob, uint32_t(track.path) | uint32_t(track.interpolation) << 8 | uint32_t(track.format) << 16);
+            write(blob, track.firstKey);
+            write(blob, track.keyCount);
+            write(blob, track.firstValue);
+        }
+        writeArray(blob, clip.times);
+        writeArray(blob, clip.values);
+        write(blob, clip.duration);
+        writeArray(blob, clip.quantizedTimes);
+        writeArray(blob, clip.quantizedValues);
+        write(blob, clip.constantValues);
+        write(blob, uint64_t(clip.constants.size()));
+        for (const AnimationConstant &constant : clip.constants) {
+            write(blob, uint32_t(constant.targetNode) | uint32_t(constant.path) << 16);
+        }
+    }
+
+    write(blob, uint64_t(uploads.size()));
+    for (const BufferUpload &upload : uploads) {
+        write(blob, upload.target);
+        write(blob, uint64_t(upload.size));
+        blob.resize((blob.size() + 15) & ~size_t(15));
+        blob.insert(blob.end(), upload.data, upload.data + upload.size);
+    }
+}
+
+// Buffer uploads point into blob, which has to outlive the upload
+std::shared_ptr<GltfModel> readCookedModel(const unsigned char *blob, size_t size, std::vector<BufferUpload> &uploads) {
+    BlobReader in = {blob, blob + size};
+    if (in.read<uint32_t>() != kCookedGltfMagic) {
+        return nullptr;
+    }
+    auto model = std::make_shared<GltfModel>();
+
+    model->nodes.resize(in.count(sizeof(glm::mat4)));
+    for (GltfNode &node : model->nodes) {
+        node.localTransform = in.read<glm::mat4>();
+        node.mesh = in.read<int>();
+        in.readArray(node.children);
+    }
+    in.readArray(model->sceneRoots);
+    in.readArray(model->meshes);
+
+    model->primitives.resize(in.count(sizeof(uint32_t) * 4));
+    for (GltfPrimitive &primitive : model->primitives) {
+        primitive.mode = in.read<GLenum>();
+        primitive.indexCount = in.read<GLsizei>();
+        primitive.indexType = in.read<GLenum>();
+        primitive.indexOffset = (uintptr_t)in.read<uint64_t>();
+        primitive.indexBuffer = in.read<int>();
+        primitive.attributes.resize(in.count(sizeof(uint32_t) * 6));
+        for (GltfAttribute &attribute : primitive.attributes) {
+            attribute.location = in.read<GLuint>();
+            attribute.buffer = in.read<int>();
+            attribute.size = in.read<GLint>();
+            attribute.type = in.read<GLenum>();
+            attribute.normalized = (GLboolean)in.read<uint32_t>();
+            attribute.stride = in.read<GLsizei>();
+            attribute.offset = (uintptr_t)in.read<uint64_t>();
+        }
+    }
+    in.readArray(model->draws);
+
+    model->skins.resize(in.count(sizeof(uint64_t) * 4));
+    for (Skeleton &skin : model->skins) {
+        in.readArray(skin.nodes);
+        in.readArray(skin.parents);
+        in.readArray(skin.jointEntries);
+        in.readArray(skin.inverseBindMatrices);
+    }
+
+    model->animations.resize(in.count(sizeof(uint64_t) * 6));
+    for (AnimationClip &clip : model->animations) {
+        clip.tracks.resize(in.count(sizeof(uint32_t) * 5));
+        for (AnimationTrack &track : clip.tracks) {
+            track.targetNode = in.read<int>();
+            uint32_t kinds = in.read<uint32_t>();
+            track.path = AnimationPath(kinds & 0xff);
+            track.interpolation = Interpolation((kinds >> 8) & 0xff);
+            track.format = KeyFormat((kinds >> 16) & 0xff);
+            track.firstKey = in.read<uint32_t>();
+            track.keyCount = in.read<uint32_t>();
+            track.firstValue = in.read<uint32_t>();
+        }
+        in.readArray(clip.times);
+        in.readArray(clip.values);
+        clip.duration = in.read<float>();
+        in.readArray(clip.quantizedTimes);
+        in.readArray(clip.quantizedValues);
+        clip.constantValues = in.read<uint32_t>();
+        clip.constants.resize(in.count(sizeof(uint32_t)));
+        for (AnimationConstant &constant : clip.constants) {
+            uint32_t target = in.read<uint32_t>();
+            constant.targetNode = uint16_t(target & 0xffff);
+            constant.path = AnimationPath((target >> 16) & 0xff);
+        }
+    }
+
+    uploads.resize(in.count(sizeof(uint32_t) + sizeof(uint64_t)));
+    for (BufferUpload &upload : uploads) {
+        upload.target = in.read<GLenum>();
+        upload.size = (size_t)in.read<uint64_t>();
+        in.bytes(((in.cursor - blob + 15) & ~ptrdiff_t(15)) - (in.cursor - blob));
+        upload.data = in.bytes(upload.size);
+    }
+
+    if (!in.ok) {
+        return nullptr;
+    }
+
+    // Indices read from the pack are only trusted as far as not reaching past the model
+    for (const GltfPrimitive &primitive : model->primitives) {
+        bool valid = primitive.indexBuffer >= 0 && primitive.indexBuffer < (int)uploads.size();
+        for (const GltfAttribute &attribute : primitive.attributes) {
+            valid = valid && attribute.buffer >= 0 && attribute.buffer < (int)uploads.size();
+        }
+        if (!valid) {
+            return nullptr;
+        }
+    }
+    for (const GltfDraw &draw : model->draws) {
+        if (draw.primitive < 0 || draw.primitive >= (int)model->primitives.size()) {
+            return nullptr;
+        }
+    }
+    return model;
+}
+
+// GL half of a load; keepAlive holds whatever the upload data points into
+std::function<std::shared_ptr<GltfModel>()> uploadModel(std::shared_ptr<GltfModel> model, std::shared_ptr<void> keepAlive,
+                                                        std::shared_ptr<std::vector<BufferUpload>> uploads) {
+    return [model, keepAlive, uploads]() -> std::shared_ptr<GltfModel> {
+        model->bufferIDs.resize(uploads->size());
+        glGenBuffers((GLsizei)model->bufferIDs.size(), model->bufferIDs.data());
+        for (size_t i = 0; i < uploads->size(); i++) {
+            const BufferUpload &upload = (*uploads)[i];
+            glBindBuffer(upload.target, model->bufferIDs[i]);
+            glBufferData(upload.target, upload.size, upload.data, GL_STATIC_DRAW);
+        }
+
+        for (GltfPrimitive &primitive : model->primitives) {
+            primitive.vertexArrayID = createGltfVertexArray(*model, primitive);
+        }
+        glBindVertexArray(0);
+
+        for (GltfDraw &draw : model->draws) {
+            draw.vertexArrayID = model->primitives[draw.primitive].vertexArrayID;
+        }
+
+        return model;
+    };
+}
+
+}
+
+std::function<std::shared_ptr<GltfModel>()> prepareGltfModel(const std::string &path, const unsigned char *bytes, size_t size) {
+    auto uploads = std::make_shared<std::vector<BufferUpload>>();
+    std::shared_ptr<GltfModel> model;
+    std::shared_ptr<GltfSource> source;
+
+    if (bytes) {
+        model = readCookedModel(bytes, size, *uploads);
+        if (!model) {
+            std::cerr << "Invalid cooked glTF: " << path << std::endl;
+            return nullptr;
+        }
+    } else {
+        source = std::make_shared<GltfSource>();
+        if (!parseSource(path, *source)) {
+            return nullptr;
+        }
+        model = buildModel(path, *source, *uploads);
+    }
+
+    std::cout << (bytes ? "Read cooked glTF " : "Parsed glTF ") << path << ": " << model->residentBytes() / 1024 << " KB resident, "
+              << uploads->size() << " buffers to upload, " << model->draws.size() << " draws" << std::endl;
+
+    // The source (and with it the mapped files) lives until the upload has run
+    return uploadModel(model, source, uploads);
+}
+
+bool cookGltfModel(const std::string &path, std::vector<unsigned char> &blob, std::vector<std::string> &dependencies) {
+    GltfSource source;
+    if (!parseSource(path, source)) {
+        return false;
+    }
+    std::vector<BufferUpload> uploads;
+    std::shared_ptr<GltfModel> model = buildModel(path, source, uploads);
+    writeCookedModel(*model, uploads, blob);
+    dependencies = source.dependencies;
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef _GLTF_MODEL_H_
+#define _GLTF_MODEL_H_
+
+#include "AnimationClip.h"
+#include "MappedFile.h"
+#include "Skeleton.h"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runtime form of a skinned glTF model: only what drawing and animating it
+// needs, immutable once uploaded and shared by every instance. The JSON tree is dropped after parsing and vertex data never gets a
+// CPU copy, the GL buffers are filled straight from the mapped BIN data.
+
+// Attribute locations used by the robot shaders
+const GLuint kGltfPositionLocation = 0;
+const GLuint kGltfNormalLocation = 1;
+const GLuint kGltfTexcoordLocation = 2;
+const GLuint kGltfJointsLocation = 3;
+const GLuint kGltfWeightsLocation = 4;
+const GLuint kGltfColorLocation = 5;
+
+// One vertex attribute of a primitive; buffer indexes GltfModel::bufferIDs
+struct GltfAttribute {
+    GLuint location = 0;
+    int buffer = 0;
+    GLint size = 0;
+    GLenum type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+    GLsizei stride = 0;
+    uintptr_t offset = 0;
+};
+
+struct GltfPrimitive {
+    GLuint vertexArrayID = 0;
+    GLenum mode = GL_TRIANGLES;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    uintptr_t indexOffset = 0;
+
+    // Layout kept so other passes can build their own VAOs over the same buffers
+    std::vector<GltfAttribute> attributes;
+    int indexBuffer = 0;
+};
+
+// One entry of the flattened draw list, in scene traversal order
+struct GltfDraw {
+    GLuint vertexArrayID = 0;
+    GLenum mode = GL_TRIANGLES;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    uintptr_t indexOffset = 0;
+    int node = 0;
+    int primitive = 0;
+};
+
+struct GltfMesh {
+    int firstPrimitive = 0;
+    int primitiveCount = 0;
+};
+
+struct GltfNode {
+    glm::mat4 localTransform = glm::mat4(1.0f);
+    int mesh = -1;
+    std::vector<int> children;
+};
+
+struct GltfModel {
+    std::vector<GltfNode> nodes;
+    std::vector<int> sceneRoots;
+    std::vector<GltfMesh> meshes;
+    std::vector<GltfPrimitive> primitives;
+    std::vector<Skeleton> skins;
+    std::vector<AnimationClip> animations;
+
+    // Every primitive reachable from the scene roots, compiled when the model is
+    // bound so drawing is a linear walk with no graph traversal
+    std::vector<GltfDraw> draws;
+
+    // One per uploaded buffer view
+    std::vector<GLuint> bufferIDs;
+
+    // CPU memory held by this object, for comparison with the source size
+    size_t residentBytes() const;
+
+    ~GltfModel();
+};
+
+// CPU half of a load: maps the file (.glb, or .gltf plus its .bin), parses the
+// JSON, flattens skins, compresses animations into clips and copies index
+// buffers to reorder them for the vertex cache. Returns the GL half, which
+// creates the buffers and VAOs, or an empty function on failure.
+//
+// bytes, if given, is a blob from cookGltfModel that outlives the upload (an
+// asset pack entry), which skips all of the above and uploads from it directly.
+std::function<std::shared_ptr<GltfModel>()> prepareGltfModel(const std::string &path, const unsigned char *bytes = nullptr, size_t size = 0);
+
+// Runs the CPU half of a load and stores its result: nodes, meshes, skeletons,
+// compressed clips and the optimised buffer data. dependencies receives the
+// external buffers and images the model names, relative to its directory.
+bool cookGltfModel(const std::string &path, std::vector<unsigned char> &blob, std::vector<std::string> &dependencies);
+
+// Creates a VAO with primitive's attributes and index buffer and leaves it bound
+GLuint createGltfVertexArray(const GltfModel &model, const GltfPrimitive &primitive);
+
+// Reorders one triangle list in place for the post-transform cache and overdraw.
+// componentType is the glTF index type (5121, 5123 or 5125).
+void optimizeGltfIndices(void *indexData, int componentType, size_t indexCount,
+                         const float *positions, size_t positionStride, size_t vertexCount, const char *label);
+
+#endif
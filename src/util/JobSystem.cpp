@@ -0,0 +1,137 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace {
+
+// Deque owned by this thread: 0 outside the pool, 1.. for workers
+thread_local unsigned currentQueue = 0;
+
+}
+
+JobSystem::JobSystem(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (unsigned i = 0; i <= threadCount; i++) {
+        queues.emplace_back(new WorkQueue());
+    }
+    for (unsigned i = 1; i <= threadCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+JobSystem &JobSystem::instance() {
+    static JobSystem jobs;
+    return jobs;
+}
+
+void JobSystem::workerLoop(unsigned index) {
+    currentQueue = index;
+    for (;;) {
+        Task task;
+        if (popTask(index, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        workAvailable.wait(lock, [this]() { return stopping || queuedTasks > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+bool JobSystem::popTask(unsigned index, Task &task) {
+    // Newest first from our own deque, it is the most likely to be in cache
+    {
+        WorkQueue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    // Oldest first from everyone else's, which tends to be the larger piece
+    for (size_t i = 1; i < queues.size(); i++) {
+        WorkQueue &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Task &task) {
+    task.job();
+    if (task.counter) {
+        task.counter->pending--;
+    }
+}
+
+void JobSystem::run(Job job, JobCounter *counter) {
+    if (counter) {
+        counter->pending++;
+    }
+
+    Task task;
+    task.job = std::move(job);
+    task.counter = counter;
+    {
+        WorkQueue &own = *queues[currentQueue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.tasks.push_back(std::move(task));
+    }
+    queuedTasks++;
+
+    // Taking the lock orders this with a worker's check before it sleeps
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    workAvailable.notify_one();
+}
+
+void JobSystem::wait(JobCounter &counter) {
+    while (counter.pending > 0) {
+        Task task;
+        if (popTask(currentQueue, task)) {
+            execute(task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body) {
+    grain = std::max<size_t>(grain, 1);
+    if (count <= grain || workers.empty()) {
+        body(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = std::min(begin + grain, count);
+        run([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+    wait(counter);
+}
@@ -0,0 +1,75 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts unfinished jobs of a group; wait() on it returns once all have run
+struct JobCounter {
+    std::atomic<unsigned> pending{0};
+};
+
+// Short CPU jobs for the frame, unlike AssetLoader's long-running loads. Each
+// thread pushes to and pops from the back of its own deque and, when that is
+// empty, steals from the front of the others'. Threads that wait on a counter
+// run jobs meanwhile instead of blocking, so jobs may wait on other jobs.
+class JobSystem {
+    public:
+        typedef std::function<void()> Job;
+
+    private:
+        struct Task {
+            Job job;
+            JobCounter *counter = nullptr;
+        };
+
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        // Queue 0 belongs to threads outside the pool, the main thread among them
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex sleepMutex;
+        std::condition_variable workAvailable;
+        std::atomic<unsigned> queuedTasks{0};
+        bool stopping = false;
+
+        void workerLoop(unsigned index);
+        bool popTask(unsigned index, Task &task);
+        void execute(Task &task);
+
+    public:
+        // One worker per core, less the thread that submits the frame's work
+        explicit JobSystem(unsigned threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        static JobSystem &instance();
+
+        // Queues job on the calling thread's deque; counter, if given, is
+        // incremented now and decremented once the job has run
+        void run(Job job, JobCounter *counter = nullptr);
+
+        // Runs queued jobs on the calling thread until counter reaches zero
+        void wait(JobCounter &counter);
+
+        // Calls body over [0, count) in ranges of at most grain items, spread over
+        // the pool and the calling thread; returns once every range has run
+        void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body);
+
+        // Threads that run jobs, counting the caller of wait()
+        unsigned concurrency() const { return (unsigned)workers.size() + 1; }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "JointPalette.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+
+namespace {
+
+// Relative spread of per-joint scales still treated as one uniform scale
+const float kScaleTolerance = 1e-3f;
+
+}
+
+const char *skinningModeName(SkinningMode mode) {
+    switch (mode) {
+        case SkinningMode::Matrix4x4: return "4x4 uniforms";
+        case SkinningMode::Affine3x4: return "3x4 palette";
+        case SkinningMode::DualQuaternion: return "dual quaternion palette";
+    }
+    return "";
+}
+
+const char *skinningModeDefine(SkinningMode mode) {
+    switch (mode) {
+        case SkinningMode::Matrix4x4: return "";
+        case SkinningMode::Affine3x4: return "#define SKINNING_AFFINE_3X4\n";
+        case SkinningMode::DualQuaternion: return "#define SKINNING_DUAL_QUATERNION\n";
+    }
+    return "";
+}
+
+int paletteVec4sPerJoint(SkinningMode mode) {
+    switch (mode) {
+        case SkinningMode::Matrix4x4: return 4;
+        case SkinningMode::Affine3x4: return 3;
+        case SkinningMode::DualQuaternion: return 2;
+    }
+    return 4;
+}
+
+bool packJointPalette(SkinningMode mode, const glm::mat4 *joints, size_t count,
+                      std::vector<glm::vec4> &out, float &scale) {
+    scale = 1.0f;
+    out.resize(count * paletteVec4sPerJoint(mode));
+
+    if (mode == SkinningMode::Matrix4x4) {
+        for (size_t j = 0; j < count; j++) {
+            for (int c = 0; c < 4; c++) {
+                out[j * 4 + c] = joints[j][c];
+            }
+        }
+        return true;
+    }
+
+    if (mode == SkinningMode::Affine3x4) {
+        // Rows, so the shader transforms with three dot products
+        for (size_t j = 0; j < count; j++) {
+            const glm::mat4 &m = joints[j];
+            for (int r = 0; r < 3; r++) {
+                out[j * 3 + r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+            }
+        }
+        return true;
+    }
+
+    if (count == 0) {
+        return true;
+    }
+
+    // Every column of every joint's 3x3 part must have the same length and the
+    // columns must stay orthogonal, or there is shear or non-uniform scale
+    scale = glm::length(glm::vec3(joints[0][0]));
+    if (scale <= 0.0f) {
+        return false;
+    }
+    for (size_t j = 0; j < count; j++) {
+        glm::mat3 m = glm::mat3(joints[j]) / scale;
+        for (int c = 0; c < 3; c++) {
+            if (std::fabs(glm::length(m[c]) - 1.0f) > kScaleTolerance ||
+                std::fabs(glm::dot(m[c], m[(c + 1) % 3])) > kScaleTolerance) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t j = 0; j < count; j++) {
+        glm::quat real = glm::normalize(glm::quat_cast(glm::mat3(joints[j]) / scale));
+        glm::vec3 t = glm::vec3(joints[j][3]);
+        glm::quat dual = 0.5f * (glm::quat(0.0f, t.x, t.y, t.z) * real);
+        out[j * 2] = glm::vec4(real.x, real.y, real.z, real.w);
+        out[j * 2 + 1] = glm::vec4(dual.x, dual.y, dual.z, dual.w);
+    }
+    return true;
+}
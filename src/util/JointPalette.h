@@ -0,0 +1,33 @@
+#ifndef _JOINT_PALETTE_H_
+#define _JOINT_PALETTE_H_
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// How skinned vertex shaders receive their joints. Matrix4x4 is the original
+// uniform array; the others stage a packed palette in the UniformStream, bound
+// to the JointPalette block at kJointPaletteBinding.
+enum class SkinningMode {
+    Matrix4x4,          // mat4 uniforms, 64 bytes a joint
+    Affine3x4,          // top three rows of the affine matrix, 48 bytes a joint
+    DualQuaternion      // rotation and translation quaternions, 32 bytes a joint
+};
+const int kSkinningModeCount = 3;
+
+const char *skinningModeName(SkinningMode mode);
+
+// Line robot.vert is compiled with to select the palette layout, empty for Matrix4x4
+const char *skinningModeDefine(SkinningMode mode);
+
+// vec4s each joint takes up in the packed palette
+int paletteVec4sPerJoint(SkinningMode mode);
+
+// Packs count joint matrices into out, resized to the mode's layout. Dual
+// quaternions only hold rotation and translation, so they need every joint to
+// share one uniform scale, returned in scale for the shader to apply first;
+// returns false when the joints do not, leaving the caller to fall back to 3x4.
+bool packJointPalette(SkinningMode mode, const glm::mat4 *joints, size_t count,
+                      std::vector<glm::vec4> &out, float &scale);
+
+#endif
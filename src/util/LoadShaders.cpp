@@ -1,4 +1,5 @@
 #include "LoadShaders.h"
+#include "UniformBlocks.h"
 
 #include <string>
 #include <iostream>
@@ -6,7 +7,21 @@
 #include <sstream>
 #include <vector>
 
-GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
+namespace {
+
+void insertDefines(std::string &code, const char *defines)
+{
+	if (defines == NULL || defines[0] == '\0')
+	{
+		return;
+	}
+	size_t lineEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+	code.insert(lineEnd == std::string::npos ? 0 : lineEnd + 1, defines);
+}
+
+}
+
+GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path, const char *defines)
 {
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -44,6 +59,9 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 		return 0;
 	}
 
+	insertDefines(VertexShaderCode, defines);
+	insertDefines(FragmentShaderCode, defines);
+
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
@@ -107,6 +125,8 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	bindUniformBlocks(ProgramID);
+
 	return ProgramID;
 }
 
@@ -179,5 +199,7 @@ GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentS
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	bindUniformBlocks(ProgramID);
+
 	return ProgramID;
 }
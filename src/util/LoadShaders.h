@@ -4,7 +4,9 @@
 #include <glad/gl.h>
 #include <string>
 
-GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path);
+// Programs come back with their Frame and Object blocks bound, see UniformBlocks.h.
+// defines, if given, is inserted after the #version line of both shaders
+GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path, const char *defines = NULL);
 
 GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode);
 
@@ -0,0 +1,32 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Pages are only read from disk
+// when they are first touched.
+class MappedFile {
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+    public:
+        MappedFile() {}
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool open(const char *path);
+        void close();
+
+        bool isOpen() const { return bytes != nullptr; }
+        const unsigned char *data() const { return bytes; }
+        size_t size() const { return length; }
+
+        ~MappedFile() { close(); }
+};
+
+#endif
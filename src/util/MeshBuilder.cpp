@@ -0,0 +1,176 @@
+#include "MeshBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <cstring>
+#include <iostream>
+
+size_t MeshBuilder::VertexHash::operator()(const MeshVertex &v) const {
+    // FNV-1a over the raw attribute bits
+    uint32_t words[8];
+    memcpy(words, &v.position, sizeof(float) * 3);
+    memcpy(words + 3, &v.uv, sizeof(float) * 2);
+    memcpy(words + 5, &v.normal, sizeof(float) * 3);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : words) {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return (size_t)hash;
+}
+
+bool MeshBuilder::VertexEqual::operator()(const MeshVertex &a, const MeshVertex &b) const {
+    return memcmp(&a.position, &b.position, sizeof(float) * 3) == 0 &&
+           memcmp(&a.uv, &b.uv, sizeof(float) * 2) == 0 &&
+           memcmp(&a.normal, &b.normal, sizeof(float) * 3) == 0;
+}
+
+uint32_t MeshBuilder::addVertex(const MeshVertex &v) {
+    auto it = lookup.find(v);
+    uint32_t index;
+    if (it != lookup.end()) {
+        index = it->second;
+    } else {
+        index = (uint32_t)vertices.size();
+        vertices.push_back(v);
+        lookup.emplace(v, index);
+    }
+    indices.push_back(index);
+    return index;
+}
+
+void MeshBuilder::addObjShapes(const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes, bool flipV) {
+    size_t corners = indices.size();
+    for (const auto &shape : shapes) {
+        corners += shape.mesh.indices.size();
+    }
+    indices.reserve(corners);
+    lookup.reserve(corners);
+
+    for (const auto &shape : shapes) {
+        for (const auto &index : shape.mesh.indices) {
+            MeshVertex v;
+            v.position = glm::vec3(attrib.vertices[3 * index.vertex_index + 0],
+                                   attrib.vertices[3 * index.vertex_index + 1],
+                                   attrib.vertices[3 * index.vertex_index + 2]);
+
+            if (index.texcoord_index >= 0) {
+                float t = attrib.texcoords[2 * index.texcoord_index + 1];
+                v.uv = glm::vec2(attrib.texcoords[2 * index.texcoord_index + 0], flipV ? 1.0f - t : t);
+            }
+
+            if (index.normal_index >= 0) {
+                v.normal = glm::vec3(attrib.normals[3 * index.normal_index + 0],
+                                     attrib.normals[3 * index.normal_index + 1],
+                                     attrib.normals[3 * index.normal_index + 2]);
+            }
+
+            addVertex(v);
+        }
+    }
+}
+
+void MeshBuilder::optimize(const char *label) {
+    if (indices.empty()) {
+        return;
+    }
+
+    VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertices.size(), kVertexCacheSize, &clusters);
+    optimizeOverdraw(indices, &vertices[0].position.x, sizeof(MeshVertex), vertices.size(), clusters);
+
+    size_t uniqueVertexCount;
+    std::vector<uint32_t> remap = optimizeVertexFetch(indices, vertices.size(), uniqueVertexCount);
+    std::vector<MeshVertex> reordered(uniqueVertexCount);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (remap[i] != ~0u) {
+            reordered[remap[i]] = vertices[i];
+        }
+    }
+    vertices.swap(reordered);
+
+    // The welding lookup refers to the old vertex order
+    lookup.clear();
+
+    printVertexCacheStats(label, before, analyzeVertexCache(indices, vertices.size()));
+}
+
+std::vector<MeshLod> MeshBuilder::buildLods(const LodSettings &settings) {
+    return buildLodChain(vertices, indices, settings);
+}
+
+void MeshBuilder::boundingSphere(glm::vec3 &center, float &radius) const {
+    if (vertices.empty()) {
+        center = glm::vec3(0.0f);
+        radius = 0.0f;
+        return;
+    }
+
+    glm::vec3 minPosition = vertices[0].position, maxPosition = vertices[0].position;
+    for (const MeshVertex &v : vertices) {
+        minPosition = glm::min(minPosition, v.position);
+        maxPosition = glm::max(maxPosition, v.position);
+    }
+    center = (minPosition + maxPosition) * 0.5f;
+    radius = glm::length(maxPosition - minPosition) * 0.5f;
+}
+
+std::vector<float> MeshBuilder::positions() const {
+    std::vector<float> out;
+    out.reserve(vertices.size() * 3);
+    for (const MeshVertex &v : vertices) {
+        out.insert(out.end(), {v.position.x, v.position.y, v.position.z});
+    }
+    return out;
+}
+
+std::vector<float> MeshBuilder::uvs() const {
+    std::vector<float> out;
+    out.reserve(vertices.size() * 2);
+    for (const MeshVertex &v : vertices) {
+        out.insert(out.end(), {v.uv.x, v.uv.y});
+    }
+    return out;
+}
+
+std::vector<float> MeshBuilder::normals() const {
+    std::vector<float> out;
+    out.reserve(vertices.size() * 3);
+    for (const MeshVertex &v : vertices) {
+        out.insert(out.end(), {v.normal.x, v.normal.y, v.normal.z});
+    }
+    return out;
+}
+
+size_t MeshBuilder::indexSize() const {
+    return vertices.size() <= 0x10000 ? 2 : 4;
+}
+
+std::vector<unsigned char> MeshBuilder::packIndices() const {
+    std::vector<unsigned char> out(indices.size() * indexSize());
+    if (indexSize() == 2) {
+        uint16_t *dst = reinterpret_cast<uint16_t *>(out.data());
+        for (size_t i = 0; i < indices.size(); i++) {
+            dst[i] = (uint16_t)indices[i];
+        }
+    } else {
+        memcpy(out.data(), indices.data(), out.size());
+    }
+    return out;
+}
+
+float MeshBuilder::dedupRatio() const {
+    if (indices.empty()) {
+        return 0.0f;
+    }
+    return 1.0f - float(vertices.size()) / float(indices.size());
+}
+
+void MeshBuilder::printStats(const char *label) const {
+    std::cout << label << ": " << indices.size() << " corners welded to " << vertices.size()
+              << " vertices (" << int(dedupRatio() * 100.0f + 0.5f) << "% shared, "
+              << indexSize() * 8 << "-bit indices)" << std::endl;
+}
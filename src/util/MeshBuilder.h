@@ -0,0 +1,72 @@
+#ifndef _MESH_BUILDER_H_
+#define _MESH_BUILDER_H_
+
+#include <glm/glm.hpp>
+#include <obj/obj_loader.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct MeshLod;
+struct LodSettings;
+
+struct MeshVertex {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec2 uv = glm::vec2(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+};
+
+// Builds an indexed triangle list, welding vertices whose position, uv and
+// normal are bit-identical so that the index buffer actually shares them.
+class MeshBuilder {
+    struct VertexHash {
+        size_t operator()(const MeshVertex &v) const;
+    };
+    struct VertexEqual {
+        bool operator()(const MeshVertex &a, const MeshVertex &b) const;
+    };
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::unordered_map<MeshVertex, uint32_t, VertexHash, VertexEqual> lookup;
+
+    public:
+        // Returns the index of v, adding it only if an identical vertex was not seen before
+        uint32_t addVertex(const MeshVertex &v);
+
+        // Appends every face corner of the shapes. flipV converts OBJ texture
+        // coordinates to the top-left origin used by stb_image.
+        void addObjShapes(const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes, bool flipV = false);
+
+        // Reorders triangles for the post-transform cache and overdraw, then
+        // vertices for fetch locality. Call once every vertex has been added.
+        void optimize(const char *label);
+
+        // Appends simplified copies of the triangles to the index list, see
+        // buildLodChain. Call after optimize(); level 0 is the original mesh.
+        std::vector<MeshLod> buildLods(const LodSettings &settings);
+
+        // Sphere around the bounding box of every vertex
+        void boundingSphere(glm::vec3 &center, float &radius) const;
+
+        const std::vector<MeshVertex> &getVertices() const { return vertices; }
+        const std::vector<uint32_t> &getIndices() const { return indices; }
+
+        std::vector<float> positions() const;
+        std::vector<float> uvs() const;
+        std::vector<float> normals() const;
+
+        // 2 when every index fits in 16 bits, otherwise 4
+        size_t indexSize() const;
+
+        // Index buffer contents in the width given by indexSize()
+        std::vector<unsigned char> packIndices() const;
+
+        // Fraction of input corners that turned out to be duplicates
+        float dedupRatio() const;
+
+        void printStats(const char *label) const;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize) {
+    VertexCacheStats stats;
+
+    // A vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t clock = cacheSize + 1;
+    size_t uniqueVertices = 0;
+
+    for (uint32_t v : indices) {
+        if (clock - loadedAt[v] > cacheSize) {
+            loadedAt[v] = clock++;
+            stats.transforms++;
+        }
+        if (!referenced[v]) {
+            referenced[v] = true;
+            uniqueVertices++;
+        }
+    }
+
+    size_t triangles = indices.size() / 3;
+    stats.acmr = triangles ? float(stats.transforms) / float(triangles) : 0.0f;
+    stats.atvr = uniqueVertices ? float(stats.transforms) / float(uniqueVertices) : 0.0f;
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize, std::vector<uint32_t> *clusters) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Vertex -> triangle adjacency, stored as offsets into one flat array
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t v : indices) {
+        liveTriangles[v]++;
+    }
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+
+    size_t timestamp = cacheSize + 1;
+    size_t cursor = 0;
+    int fanning = (int)indices[0];
+
+    if (clusters) {
+        clusters->assign(1, 0);
+    }
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (uint32_t a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Prefer a candidate that is still in the cache and will not be evicted
+        // before its remaining triangles are emitted
+        int next = -1;
+        size_t bestPriority = 0;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            size_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timestamp - cacheTime[v];
+            }
+            if (next < 0 || priority > bestPriority) {
+                bestPriority = priority;
+                next = (int)v;
+            }
+        }
+
+        if (next < 0) {
+            // Dead end: fall back to recently used vertices, then to a linear scan
+            while (!deadEnd.empty() && next < 0) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) {
+                    next = (int)v;
+                }
+            }
+            while (next < 0 && cursor < vertexCount) {
+                if (liveTriangles[cursor] > 0) {
+                    next = (int)cursor;
+                }
+                cursor++;
+            }
+            if (clusters && next >= 0) {
+                clusters->push_back((uint32_t)(output.size() / 3));
+            }
+        }
+
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const float *positions, size_t positionStride,
+                      size_t vertexCount, const std::vector<uint32_t> &hardClusters, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || positions == nullptr) {
+        return;
+    }
+
+    auto position = [&](uint32_t v) {
+        const float *p = reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + v * positionStride);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Split hard clusters further wherever the cache cost so far is already
+    // close to the cost of the whole cluster
+    std::vector<uint32_t> clusters;
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    size_t timestamp = kVertexCacheSize + 1;
+
+    std::vector<uint32_t> bounds(hardClusters);
+    if (bounds.empty() || bounds[0] != 0) {
+        bounds.insert(bounds.begin(), 0);
+    }
+    bounds.push_back((uint32_t)triangleCount);
+
+    for (size_t c = 0; c + 1 < bounds.size(); c++) {
+        uint32_t begin = bounds[c], end = bounds[c + 1];
+        if (begin >= end) {
+            continue;
+        }
+
+        std::vector<uint32_t> slice(indices.begin() + begin * 3, indices.begin() + end * 3);
+        float clusterThreshold = threshold * analyzeVertexCache(slice, vertexCount).acmr;
+
+        timestamp += kVertexCacheSize + 1;
+        size_t misses = 0;
+        uint32_t start = begin;
+        clusters.push_back(begin);
+
+        for (uint32_t t = begin; t < end; t++) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                if (timestamp - cacheTime[v] > kVertexCacheSize) {
+                    cacheTime[v] = timestamp++;
+                    misses++;
+                }
+            }
+            if (t + 1 < end && float(misses) / float(t - start + 1) <= clusterThreshold) {
+                start = t + 1;
+                misses = 0;
+                timestamp += kVertexCacheSize + 1;
+                clusters.push_back(start);
+            }
+        }
+    }
+    clusters.push_back((uint32_t)triangleCount);
+
+    // Area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> triangleCentroid(triangleCount);
+    std::vector<glm::vec3> triangleNormal(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        glm::vec3 a = position(indices[t * 3 + 0]);
+        glm::vec3 b = position(indices[t * 3 + 1]);
+        glm::vec3 c = position(indices[t * 3 + 2]);
+        triangleNormal[t] = glm::cross(b - a, c - a);
+        triangleCentroid[t] = (a + b + c) / 3.0f;
+
+        float area = glm::length(triangleNormal[t]);
+        meshCentroid += triangleCentroid[t] * area;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the centroid are likely to occlude the rest
+    struct ClusterKey {
+        float outwardness;
+        uint32_t cluster;
+    };
+    std::vector<ClusterKey> keys(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            float a = glm::length(triangleNormal[t]);
+            centroid += triangleCentroid[t] * a;
+            normal += triangleNormal[t];
+            area += a;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f) {
+            keys[c].outwardness = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+        } else {
+            keys[c].outwardness = 0.0f;
+        }
+        keys[c].cluster = (uint32_t)c;
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey &a, const ClusterKey &b) {
+        return a.outwardness > b.outwardness;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const ClusterKey &key : keys) {
+        output.insert(output.end(), indices.begin() + clusters[key.cluster] * 3, indices.begin() + clusters[key.cluster + 1] * 3);
+    }
+    indices.swap(output);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertexCount, size_t &uniqueVertexCount) {
+    std::vector<uint32_t> remap(vertexCount, ~0u);
+    uint32_t next = 0;
+
+    for (uint32_t &v : indices) {
+        if (remap[v] == ~0u) {
+            remap[v] = next++;
+        }
+        v = remap[v];
+    }
+
+    uniqueVertexCount = next;
+    return remap;
+}
+
+void printVertexCacheStats(const char *label, const VertexCacheStats &before, const VertexCacheStats &after) {
+    std::cout << label << ": ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
@@ -0,0 +1,37 @@
+#ifndef _MESH_OPTIMIZER_H_
+#define _MESH_OPTIMIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Transform cache behaviour of a triangle list on a simulated FIFO cache
+struct VertexCacheStats {
+    size_t transforms = 0;
+    float acmr = 0.0f;      // transformed vertices per triangle, 0.5 is ideal for large grids
+    float atvr = 0.0f;      // transformed vertices per unique vertex, 1.0 is ideal
+};
+
+const size_t kVertexCacheSize = 16;
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize = kVertexCacheSize);
+
+// Tipsify (Sander et al. 2007) triangle reordering for the post-transform cache.
+// clusters, if given, receives the first triangle of each run that started
+// from a dead end, which the overdraw pass uses as hard cluster boundaries.
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount,
+                         size_t cacheSize = kVertexCacheSize, std::vector<uint32_t> *clusters = nullptr);
+
+// Reorders the clusters of a cache-optimised index list so that outward-facing
+// ones come first and occlude the rest. Clusters are only split where the
+// cache cost stays within threshold of the whole mesh, so ACMR barely moves.
+void optimizeOverdraw(std::vector<uint32_t> &indices, const float *positions, size_t positionStride,
+                      size_t vertexCount, const std::vector<uint32_t> &hardClusters, float threshold = 1.05f);
+
+// Renumbers vertices in first-use order and rewrites indices to match.
+// Returns remap such that new vertex remap[i] holds old vertex i, or ~0u if unused.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertexCount, size_t &uniqueVertexCount);
+
+void printVertexCacheStats(const char *label, const VertexCacheStats &before, const VertexCacheStats &after);
+
+#endif
@@ -0,0 +1,427 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// Sum of squared distances to a set of planes, weighted by triangle area
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double weight = 0;
+
+    void addPlane(glm::dvec3 n, double d, double w) {
+        a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+        b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+        c2 += w * n.z * n.z; cd += w * n.z * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric &q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+    }
+
+    // Mean squared distance of p to the planes
+    double evaluate(glm::dvec3 p) const {
+        double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+                 + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+                 + c2 * p.z * p.z + 2 * cd * p.z
+                 + d2;
+        return weight > 0 ? std::fabs(e) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+// How different two copies of a vertex at the same position look
+float attributeDistance(const MeshVertex &a, const MeshVertex &b) {
+    glm::vec2 uv = a.uv - b.uv;
+    return glm::dot(uv, uv) + (1.0f - glm::dot(a.normal, b.normal));
+}
+
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<MeshVertex> &vertices, const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount, float maxError, float *resultError) {
+    std::vector<uint32_t> result(indices);
+    size_t vertexCount = vertices.size();
+    double maxCost = double(maxError) * double(maxError);
+    double worstCost = 0.0;
+
+    // Vertices split only by uv or normal share a position. Topology, quadrics
+    // and the collapses themselves work on positions, so a seam does not stop
+    // the mesh from simplifying; each split copy then follows its own twin.
+    std::vector<uint32_t> position(vertexCount);
+    {
+        std::vector<uint32_t> order(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            order[v] = uint32_t(v);
+        }
+        auto less = [&](uint32_t a, uint32_t b) {
+            const glm::vec3 &pa = vertices[a].position, &pb = vertices[b].position;
+            return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+        };
+        std::sort(order.begin(), order.end(), less);
+        for (size_t i = 0; i < vertexCount; i++) {
+            bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+            position[order[i]] = same ? position[order[i - 1]] : order[i];
+        }
+    }
+
+    // Quadrics from the input triangles, one per position
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        glm::dvec3 a(vertices[result[t]].position), b(vertices[result[t + 1]].position), c(vertices[result[t + 2]].position);
+        glm::dvec3 n = glm::cross(b - a, c - a);
+        double area = glm::length(n);
+        if (area == 0.0) {
+            continue;
+        }
+        n /= area;
+        for (int k = 0; k < 3; k++) {
+            quadrics[position[result[t + k]]].addPlane(n, -glm::dot(n, a), area);
+        }
+    }
+
+    // Edges of the welded mesh used by a single triangle are on its boundary,
+    // and those used by more are not manifold; neither kind of vertex moves.
+    // Edges used once only before welding are attribute seams, which get a
+    // plane across the triangle so that collapses keep seams straight.
+    std::vector<bool> locked(vertexCount, false);
+    {
+        struct Edge {
+            uint64_t welded;
+            uint64_t split;
+            uint32_t triangle;
+        };
+        std::vector<Edge> edges;
+        edges.reserve(result.size());
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = result[t + k], b = result[t + (k + 1) % 3];
+                edges.push_back({edgeKey(position[a], position[b]), edgeKey(a, b), uint32_t(t / 3)});
+            }
+        }
+        std::sort(edges.begin(), edges.end(), [](const Edge &x, const Edge &y) {
+            return x.welded != y.welded ? x.welded < y.welded : x.split < y.split;
+        });
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j].welded == edges[i].welded) {
+                j++;
+            }
+            uint32_t a = uint32_t(edges[i].welded >> 32), b = uint32_t(edges[i].welded & 0xffffffffu);
+            if (j - i != 2) {
+                locked[a] = true;
+                locked[b] = true;
+            } else if (edges[i].split != edges[i + 1].split) {
+                for (size_t k = i; k < j; k++) {
+                    const uint32_t *tri = &result[edges[k].triangle * 3];
+                    glm::dvec3 p0(vertices[tri[0]].position), p1(vertices[tri[1]].position), p2(vertices[tri[2]].position);
+                    glm::dvec3 pa(vertices[a].position), pb(vertices[b].position);
+                    glm::dvec3 n = glm::cross(glm::cross(p1 - p0, p2 - p0), pb - pa);
+                    double length = glm::length(n);
+                    if (length == 0.0) {
+                        continue;
+                    }
+                    n /= length;
+                    double weight = glm::dot(pb - pa, pb - pa);
+                    quadrics[a].addPlane(n, -glm::dot(n, pa), weight);
+                    quadrics[b].addPlane(n, -glm::dot(n, pa), weight);
+                }
+            }
+            i = j;
+        }
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint64_t> edges;
+    std::vector<std::pair<uint32_t, uint32_t>> twins;
+    std::vector<uint32_t> targets;
+
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        // Unique edges between positions and the cheaper allowed direction to collapse each one
+        edges.clear();
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int k = 0; k < 3; k++) {
+                edges.push_back(edgeKey(position[result[t * 3 + k]], position[result[t * 3 + (k + 1) % 3]]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t e : edges) {
+            uint32_t a = uint32_t(e >> 32), b = uint32_t(e & 0xffffffffu);
+            Quadric q = quadrics[a];
+            q.add(quadrics[b]);
+
+            Collapse c = {0, 0, DBL_MAX};
+            if (!locked[a]) {
+                c = {a, b, q.evaluate(glm::dvec3(vertices[b].position))};
+            }
+            if (!locked[b]) {
+                double cost = q.evaluate(glm::dvec3(vertices[a].position));
+                if (cost < c.cost) {
+                    c = {b, a, cost};
+                }
+            }
+            if (c.cost <= maxCost) {
+                collapses.push_back(c);
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) {
+            return x.cost < y.cost;
+        });
+
+        // Position -> triangle adjacency for the flip test
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (uint32_t v : result) {
+            adjacencyOffset[position[v] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        }
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency[fill[position[result[i]]]++] = uint32_t(i / 3);
+            }
+        }
+
+        for (size_t v = 0; v < vertexCount; v++) {
+            remap[v] = uint32_t(v);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+
+        for (const Collapse &c : collapses) {
+            if (removed >= trianglesToRemove) {
+                break;
+            }
+            if (touched[c.from] || touched[c.to]) {
+                continue;
+            }
+
+            // Each copy of c.from collapses onto the copy of c.to it shares an
+            // edge with, so seams move along themselves. Copies on the far side
+            // of a crease share none and take the copy with the nearest
+            // attributes instead; a copy sharing edges with two is ambiguous.
+            twins.clear();
+            targets.clear();
+            for (uint32_t a = adjacencyOffset[c.to]; a < adjacencyOffset[c.to + 1]; a++) {
+                const uint32_t *tri = &result[adjacency[a] * 3];
+                for (int k = 0; k < 3; k++) {
+                    if (position[tri[k]] == c.to) {
+                        targets.push_back(tri[k]);
+                    }
+                }
+            }
+            for (uint32_t a = adjacencyOffset[c.from]; a < adjacencyOffset[c.from + 1]; a++) {
+                const uint32_t *tri = &result[adjacency[a] * 3];
+                for (int k = 0; k < 3; k++) {
+                    if (position[tri[k]] != c.from) {
+                        continue;
+                    }
+                    uint32_t target = ~0u;
+                    for (int j = 1; j < 3; j++) {
+                        if (position[tri[(k + j) % 3]] == c.to) {
+                            target = tri[(k + j) % 3];
+                        }
+                    }
+                    twins.push_back({tri[k], target});
+                }
+            }
+            std::sort(twins.begin(), twins.end());
+            twins.erase(std::unique(twins.begin(), twins.end()), twins.end());
+            bool valid = true;
+            size_t write = 0;
+            for (size_t i = 0; i < twins.size() && valid;) {
+                size_t j = i, shared = 0;
+                for (; j < twins.size() && twins[j].first == twins[i].first; j++) {
+                    shared += twins[j].second != ~0u;
+                }
+                uint32_t copy = twins[i].first, target = twins[i].second;
+                if (shared == 0) {
+                    float best = FLT_MAX;
+                    for (uint32_t t : targets) {
+                        float distance = attributeDistance(vertices[copy], vertices[t]);
+                        if (distance < best) {
+                            best = distance;
+                            target = t;
+                        }
+                    }
+                }
+                valid = shared <= 1 && target != ~0u;
+                twins[write++] = {copy, target};
+                i = j;
+            }
+            twins.resize(write);
+
+            // Reject collapses that would flip a triangle or touch one already changed in this pass
+            size_t dying = 0;
+            for (uint32_t a = adjacencyOffset[c.from]; a < adjacencyOffset[c.from + 1] && valid; a++) {
+                const uint32_t *tri = &result[adjacency[a] * 3];
+                if (position[tri[0]] == c.to || position[tri[1]] == c.to || position[tri[2]] == c.to) {
+                    dying++;
+                    continue;
+                }
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++) {
+                    if (touched[position[tri[k]]]) {
+                        valid = false;
+                    }
+                    p[k] = vertices[tri[k]].position;
+                    q[k] = position[tri[k]] == c.from ? vertices[c.to].position : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0f) {
+                    valid = false;
+                }
+            }
+            if (!valid) {
+                continue;
+            }
+
+            for (uint32_t a = adjacencyOffset[c.from]; a < adjacencyOffset[c.from + 1]; a++) {
+                const uint32_t *tri = &result[adjacency[a] * 3];
+                touched[position[tri[0]]] = touched[position[tri[1]]] = touched[position[tri[2]]] = true;
+            }
+            touched[c.to] = true;
+
+            for (const auto &twin : twins) {
+                remap[twin.first] = twin.second;
+            }
+            quadrics[c.to].add(quadrics[c.from]);
+            worstCost = std::max(worstCost, c.cost);
+            removed += dying;
+        }
+
+        if (removed == 0) {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            uint32_t a = remap[result[t * 3 + 0]], b = remap[result[t * 3 + 1]], c = remap[result[t * 3 + 2]];
+            if (position[a] == position[b] || position[b] == position[c] || position[a] == position[c]) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (resultError) {
+        *resultError = float(std::sqrt(worstCost));
+    }
+    return result;
+}
+
+std::vector<MeshLod> buildLodChain(const std::vector<MeshVertex> &vertices, std::vector<uint32_t> &indices, const LodSettings &settings) {
+    std::vector<MeshLod> lods;
+
+    MeshLod full;
+    full.indexCount = uint32_t(indices.size());
+    lods.push_back(full);
+
+    std::vector<uint32_t> previous(indices);
+    float error = 0.0f;
+
+    for (int level = 1; level < settings.levels; level++) {
+        size_t target = size_t(previous.size() / 3 * settings.reduction) * 3;
+
+        float levelError;
+        std::vector<uint32_t> simplified = simplifyMesh(vertices, previous, target, FLT_MAX, &levelError);
+
+        // Not worth another level if the collapses mostly hit locked vertices
+        if (simplified.empty() || simplified.size() > previous.size() * 0.9f) {
+            break;
+        }
+
+        // Each level is simplified from the one before, so the errors add up
+        error += levelError;
+        optimizeVertexCache(simplified, vertices.size());
+
+        MeshLod lod;
+        lod.indexOffset = uint32_t(indices.size());
+        lod.indexCount = uint32_t(simplified.size());
+        lod.error = error;
+        lods.push_back(lod);
+
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
+
+    return lods;
+}
+
+void LodSelector::beginFrame(glm::vec3 cameraPosition, const glm::mat4 &projection, float viewportHeight) {
+    this->cameraPosition = cameraPosition;
+    pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    frameTriangles = 0;
+}
+
+int LodSelector::select(const std::vector<MeshLod> &lods, glm::vec3 center, float radius, float scale) {
+    if (lods.empty()) {
+        return -1;
+    }
+
+    float distance = std::max(glm::length(center - cameraPosition) - radius, 1e-3f);
+
+    // Coarsest level whose projected error is still under the threshold
+    int level = 0;
+    for (int i = (int)lods.size() - 1; i > 0; i--) {
+        float pixels = lods[i].error * scale / distance * pixelsPerUnit;
+        if (pixels <= threshold) {
+            level = i;
+            break;
+        }
+    }
+
+    frameTriangles += lods[level].indexCount / 3;
+    return level;
+}
+
+void LodSelector::endFrame() {
+    if (frameTriangles > triangleBudget) {
+        threshold *= 1.25f;
+    } else if (frameTriangles < triangleBudget * 8 / 10) {
+        threshold = std::max(baseThreshold, threshold / 1.1f);
+    }
+}
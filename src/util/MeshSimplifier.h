@@ -0,0 +1,64 @@
+#ifndef _MESH_SIMPLIFIER_H_
+#define _MESH_SIMPLIFIER_H_
+
+#include "MeshBuilder.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// One level of detail: a range of the shared index buffer plus the largest
+// deviation from the full mesh, in model space units
+struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+struct LodSettings {
+    int levels = 4;                 // including the full resolution mesh
+    float reduction = 0.5f;         // triangle ratio between consecutive levels
+};
+
+// Quadric error metric edge collapse (Garland & Heckbert 1997). Vertices are
+// only ever collapsed onto other existing vertices, so the result indexes the
+// same vertex buffer. Collapses are between positions: the copies of a vertex
+// split by an attribute seam move together, each onto the copy on its side of
+// the seam. Vertices on the boundary of the welded mesh never move.
+// resultError receives the largest collapse error in model space units.
+std::vector<uint32_t> simplifyMesh(const std::vector<MeshVertex> &vertices, const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount, float maxError, float *resultError);
+
+// Appends coarser copies of indices to it and returns the ranges of every level,
+// finest first. Stops early once a level no longer gets meaningfully smaller.
+std::vector<MeshLod> buildLodChain(const std::vector<MeshVertex> &vertices, std::vector<uint32_t> &indices, const LodSettings &settings);
+
+// Picks levels by their projected error in pixels. Keeps the triangles drawn per
+// frame near a budget by raising the pixel threshold when the previous frame
+// went over and lowering it back towards the base value when it was under.
+class LodSelector {
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float pixelsPerUnit = 1.0f;     // at a distance of one unit
+
+    float baseThreshold;
+    float threshold;
+    unsigned long triangleBudget;
+    unsigned long frameTriangles = 0;
+
+    public:
+        LodSelector(float thresholdPixels = 1.0f, unsigned long triangleBudget = 2000000)
+            : baseThreshold(thresholdPixels), threshold(thresholdPixels), triangleBudget(triangleBudget) {}
+
+        void beginFrame(glm::vec3 cameraPosition, const glm::mat4 &projection, float viewportHeight);
+
+        // center/radius bound the mesh in world space, scale converts model space errors to world space
+        int select(const std::vector<MeshLod> &lods, glm::vec3 center, float radius, float scale);
+
+        void endFrame();
+
+        unsigned long trianglesLastFrame() const { return frameTriangles; }
+        float currentThreshold() const { return threshold; }
+};
+
+#endif
@@ -0,0 +1,662 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OCCLUSION_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+namespace {
+
+const int kTileSize = 8;
+
+// Occluders set up per job, enough to be worth queueing one
+const size_t kOccludersPerJob = 64;
+
+// Outcodes against the side and far planes of clip space; the near plane is clipped instead
+unsigned outcode(const glm::vec4 &v) {
+    unsigned code = 0;
+    code |= v.x < -v.w ? 1u : 0u;
+    code |= v.x > v.w ? 2u : 0u;
+    code |= v.y < -v.w ? 4u : 0u;
+    code |= v.y > v.w ? 8u : 0u;
+    code |= v.z > v.w ? 16u : 0u;
+    return code;
+}
+
+// Pixel coordinates, y up, and 1/w
+glm::vec3 toScreen(const glm::vec4 &clip, float width, float height) {
+    float inverseW = 1.0f / clip.w;
+    return glm::vec3((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height, inverseW);
+}
+
+// Eight pixels of one row starting at x: keeps the nearer of the stored depth
+// and the triangle's where every edge function is non-negative. Depths are
+// never negative, so zeroing the triangle's outside it leaves those pixels be.
+inline void rasterizeSpan(float *pixels, float x, const float *edgeA, const float *rowEdges, float depthA, float rowDepth) {
+#if defined(OCCLUSION_AVX)
+    __m256 xs = _mm256_add_ps(_mm256_set1_ps(x + 0.5f), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 zero = _mm256_setzero_ps();
+    __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA[0]), xs), _mm256_set1_ps(rowEdges[0])), zero, _CMP_GE_OQ);
+    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA[1]), xs), _mm256_set1_ps(rowEdges[1])), zero, _CMP_GE_OQ));
+    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA[2]), xs), _mm256_set1_ps(rowEdges[2])), zero, _CMP_GE_OQ));
+    if (_mm256_movemask_ps(inside) == 0) {
+        return;
+    }
+    __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(depthA), xs), _mm256_set1_ps(rowDepth));
+    __m256 stored = _mm256_loadu_ps(pixels);
+    _mm256_storeu_ps(pixels, _mm256_max_ps(stored, _mm256_and_ps(z, inside)));
+#elif defined(OCCLUSION_SSE)
+    __m128 zero = _mm_setzero_ps();
+    for (int half = 0; half < 2; half++) {
+        __m128 xs = _mm_add_ps(_mm_set1_ps(x + 0.5f + 4.0f * half), _mm_setr_ps(0, 1, 2, 3));
+        __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), xs), _mm_set1_ps(rowEdges[0])), zero);
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), xs), _mm_set1_ps(rowEdges[1])), zero));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), xs), _mm_set1_ps(rowEdges[2])), zero));
+        if (_mm_movemask_ps(inside) == 0) {
+            continue;
+        }
+        __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), xs), _mm_set1_ps(rowDepth));
+        __m128 stored = _mm_loadu_ps(pixels + 4 * half);
+        _mm_storeu_ps(pixels + 4 * half, _mm_max_ps(stored, _mm_and_ps(z, inside)));
+    }
+#else
+    for (int lane = 0; lane < 8; lane++) {
+        float px = x + lane + 0.5f;
+        if (edgeA[0] * px + rowEdges[0] >= 0.0f && edgeA[1] * px + rowEdges[1] >= 0.0f &&
+            edgeA[2] * px + rowEdges[2] >= 0.0f) {
+            pixels[lane] = std::max(pixels[lane], depthA * px + rowDepth);
+        }
+    }
+#endif
+}
+
+// Smallest of an 8x8 tile of pixels
+inline float tileMinimum(const float *pixels, int stride) {
+#if defined(OCCLUSION_AVX)
+    __m256 lowest = _mm256_loadu_ps(pixels);
+    for (int row = 1; row < kTileSize; row++) {
+        lowest = _mm256_min_ps(lowest, _mm256_loadu_ps(pixels + row * stride));
+    }
+    __m128 half = _mm_min_ps(_mm256_castps256_ps128(lowest), _mm256_extractf128_ps(lowest, 1));
+    half = _mm_min_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_min_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+#elif defined(OCCLUSION_SSE)
+    __m128 lowest = _mm_min_ps(_mm_loadu_ps(pixels), _mm_loadu_ps(pixels + 4));
+    for (int row = 1; row < kTileSize; row++) {
+        lowest = _mm_min_ps(lowest, _mm_min_ps(_mm_loadu_ps(pixels + row * stride), _mm_loadu_ps(pixels + row * stride + 4)));
+    }
+    lowest = _mm_min_ps(lowest, _mm_movehl_ps(lowest, lowest));
+    lowest = _mm_min_ss(lowest, _mm_shuffle_ps(lowest, lowest, 1));
+    return _mm_cvtss_f32(lowest);
+#else
+    float lowest = pixels[0];
+    for (int row = 0; row < kTileSize; row++) {
+        for (int column = 0; column < kTileSize; column++) {
+            lowest = std::min(lowest, pixels[row * stride + column]);
+        }
+    }
+    return lowest;
+#endif
+}
+
+}
+
+OcclusionCuller::OcclusionCuller(const OcclusionSettings &settings) : settings(settings) {
+    // Whole tiles only, so spans and tiles never run off the buffer
+    this->settings.width = std::max(kTileSize, (settings.width + kTileSize - 1) / kTileSize * kTileSize);
+    this->settings.height = std::max(kTileSize, (settings.height + kTileSize - 1) / kTileSize * kTileSize);
+    tilesX = this->settings.width / kTileSize;
+    tilesY = this->settings.height / kTileSize;
+    depth.assign(size_t(this->settings.width) * this->settings.height, 0.0f);
+    tileDepth.assign(size_t(tilesX) * tilesY, 0.0f);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4 &viewProjection) {
+    this->viewProjection = viewProjection;
+    frustum.extract(viewProjection);
+    occluders.clear();
+    std::fill(depth.begin(), depth.end(), 0.0f);
+    std::fill(tileDepth.begin(), tileDepth.end(), 0.0f);
+    frameTriangles = 0;
+}
+
+void OcclusionCuller::addOccluder(const OccluderMesh &mesh, const glm::mat4 &model) {
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    glm::vec3 center = glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f));
+    float radius = mesh.boundsRadius * scale;
+    if (!frustum.intersectsSphere(center, radius)) {
+        return;
+    }
+
+    // The projection's vertical scale is the length of the second row's xyz,
+    // since the view's rotation keeps it unit length
+    glm::vec4 clip = viewProjection * glm::vec4(center, 1.0f);
+    if (clip.w > radius) {
+        glm::vec3 rowY(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1]);
+        float pixels = radius * glm::length(rowY) * 0.5f * settings.height / clip.w;
+        if (pixels < settings.minOccluderPixels) {
+            return;
+        }
+    }
+
+    Occluder occluder;
+    occluder.mesh = &mesh;
+    occluder.transform = viewProjection * model;
+    occluders.push_back(occluder);
+}
+
+void OcclusionCuller::setupTriangles(const Occluder &occluder, std::vector<Triangle> &out) {
+    const OccluderMesh &mesh = *occluder.mesh;
+    float width = float(settings.width);
+    float height = float(settings.height);
+
+    // Vertices in front of the near plane are projected once, here
+    static thread_local std::vector<glm::vec4> clip;
+    static thread_local std::vector<glm::vec3> screen;
+    static thread_local std::vector<unsigned> codes;
+    clip.resize(mesh.vertices.size());
+    screen.resize(mesh.vertices.size());
+    codes.resize(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        clip[i] = occluder.transform * glm::vec4(mesh.vertices[i], 1.0f);
+        codes[i] = outcode(clip[i]);
+        if (clip[i].z >= -clip[i].w) {
+            screen[i] = toScreen(clip[i], width, height);
+        }
+    }
+
+    auto emit = [&](const glm::vec3 &s0, const glm::vec3 &first, const glm::vec3 &second) {
+        // The scene draws without face culling, so clockwise triangles are turned around rather than dropped
+        float area = (first.x - s0.x) * (second.y - s0.y) - (first.y - s0.y) * (second.x - s0.x);
+        if (area == 0.0f || area != area) {
+            return;
+        }
+        const glm::vec3 &s1 = area > 0.0f ? first : second;
+        const glm::vec3 &s2 = area > 0.0f ? second : first;
+        area = std::fabs(area);
+
+        // Pixels whose centers the triangle may cover
+        float left = std::min(s0.x, std::min(s1.x, s2.x));
+        float right = std::max(s0.x, std::max(s1.x, s2.x));
+        float bottom = std::min(s0.y, std::min(s1.y, s2.y));
+        float top = std::max(s0.y, std::max(s1.y, s2.y));
+        if (right < 0.5f || left > width - 0.5f || top < 0.5f || bottom > height - 0.5f) {
+            return;
+        }
+        int minX = std::max(0, (int)std::ceil(left - 0.5f));
+        int maxX = std::min(settings.width - 1, (int)std::floor(right - 0.5f));
+        int minY = std::max(0, (int)std::ceil(bottom - 0.5f));
+        int maxY = std::min(settings.height - 1, (int)std::floor(top - 0.5f));
+        if (minX > maxX || minY > maxY) {
+            return;
+        }
+
+        // Edge k is opposite vertex k, so its function over area is that vertex's barycentric weight
+        out.push_back(Triangle());
+        Triangle &triangle = out.back();
+        const glm::vec3 *s[3] = {&s0, &s1, &s2};
+        float inverseArea = 1.0f / area;
+        triangle.depthA = triangle.depthB = triangle.depthC = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec3 &from = *s[(k + 1) % 3];
+            const glm::vec3 &to = *s[(k + 2) % 3];
+            triangle.edgeA[k] = from.y - to.y;
+            triangle.edgeB[k] = to.x - from.x;
+            triangle.edgeC[k] = from.x * to.y - from.y * to.x;
+            float inverse = triangle.edgeA[k] != 0.0f ? 1.0f / triangle.edgeA[k] : 0.0f;
+            triangle.crossSlope[k] = -triangle.edgeB[k] * inverse;
+            triangle.crossOffset[k] = -triangle.edgeC[k] * inverse - 0.5f;
+            triangle.depthA += s[k]->z * triangle.edgeA[k] * inverseArea;
+            triangle.depthB += s[k]->z * triangle.edgeB[k] * inverseArea;
+            triangle.depthC += s[k]->z * triangle.edgeC[k] * inverseArea;
+        }
+
+        // Spans start on a multiple of eight; pixels outside the triangle fail the edge tests
+        triangle.minX = minX & ~7;
+        triangle.maxX = maxX;
+        triangle.minY = minY;
+        triangle.maxY = maxY;
+    };
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        uint32_t index[3] = {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]};
+        if (codes[index[0]] & codes[index[1]] & codes[index[2]]) {
+            continue;
+        }
+
+        int inFront = 0;
+        for (int k = 0; k < 3; k++) {
+            inFront += clip[index[k]].z >= -clip[index[k]].w ? 1 : 0;
+        }
+        if (inFront == 3) {
+            emit(screen[index[0]], screen[index[1]], screen[index[2]]);
+            continue;
+        }
+        if (inFront == 0) {
+            continue;
+        }
+
+        // Clipped against the near plane, z >= -w, into a triangle or a quad
+        glm::vec3 polygon[4];
+        int corners = 0;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec4 &a = clip[index[k]];
+            const glm::vec4 &b = clip[index[(k + 1) % 3]];
+            float da = a.z + a.w;
+            float db = b.z + b.w;
+            if (da >= 0.0f) {
+                polygon[corners++] = screen[index[k]];
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                polygon[corners++] = toScreen(a + (b - a) * (da / (da - db)), width, height);
+            }
+        }
+        emit(polygon[0], polygon[1], polygon[2]);
+        if (corners == 4) {
+            emit(polygon[0], polygon[2], polygon[3]);
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeTileRow(int tileRow) {
+    int rowBegin = tileRow * kTileSize;
+    int rowEnd = rowBegin + kTileSize;
+
+    for (uint32_t index : rowTriangles[tileRow]) {
+        const Triangle &triangle = triangles[index];
+        int firstRow = std::max(triangle.minY, rowBegin);
+        int lastRow = std::min(triangle.maxY, rowEnd - 1);
+        for (int y = firstRow; y <= lastRow; y++) {
+            float py = y + 0.5f;
+            float rowEdges[3];
+            for (int k = 0; k < 3; k++) {
+                rowEdges[k] = triangle.edgeB[k] * py + triangle.edgeC[k];
+            }
+            float rowDepth = triangle.depthB * py + triangle.depthC;
+
+            // Where the edges cross the row bounds the pixels worth testing; horizontal
+            // edges only ever bound rows outside minY to maxY
+            float left = float(triangle.minX);
+            float right = float(triangle.maxX);
+            for (int k = 0; k < 3; k++) {
+                float cross = triangle.crossSlope[k] * py + triangle.crossOffset[k];
+                if (triangle.edgeA[k] > 0.0f) {
+                    left = std::max(left, cross);
+                } else if (triangle.edgeA[k] < 0.0f) {
+                    right = std::min(right, cross);
+                }
+            }
+            if (left > right) {
+                continue;
+            }
+
+            // Both are at least minX, which is not negative, so truncating rounds down
+            int firstX = (int)left & ~7;
+            int lastX = std::min(triangle.maxX, (int)right + 1);
+
+            float *row = &depth[size_t(y) * settings.width];
+            for (int x = firstX; x <= lastX; x += 8) {
+                rasterizeSpan(row + x, float(x), triangle.edgeA, rowEdges, triangle.depthA, rowDepth);
+            }
+        }
+    }
+
+    for (int tileX = 0; tileX < tilesX; tileX++) {
+        tileDepth[size_t(tileRow) * tilesX + tileX] = tileMinimum(&depth[size_t(rowBegin) * settings.width + tileX * kTileSize], settings.width);
+    }
+}
+
+void OcclusionCuller::rasterize() {
+    if (occluders.empty()) {
+        return;
+    }
+
+    // Each job sets up a fixed run of occluders into its own list
+    size_t chunks = (occluders.size() + kOccludersPerJob - 1) / kOccludersPerJob;
+    chunkTriangles.resize(std::max(chunkTriangles.size(), chunks));
+    JobSystem::instance().parallelFor(chunks, 1, [this](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; chunk++) {
+            std::vector<Triangle> &out = chunkTriangles[chunk];
+            out.clear();
+            size_t last = std::min(occluders.size(), (chunk + 1) * kOccludersPerJob);
+            for (size_t i = chunk * kOccludersPerJob; i < last; i++) {
+                setupTriangles(occluders[i], out);
+            }
+        }
+    });
+
+    // Packed together and binned by the rows of tiles they reach, so each row's job only sees its own
+    triangles.clear();
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        triangles.insert(triangles.end(), chunkTriangles[chunk].begin(), chunkTriangles[chunk].end());
+    }
+    frameTriangles = triangles.size();
+    rowTriangles.resize(tilesY);
+    for (std::vector<uint32_t> &bin : rowTriangles) {
+        bin.clear();
+    }
+    for (size_t t = 0; t < triangles.size(); t++) {
+        for (int row = triangles[t].minY / kTileSize; row <= triangles[t].maxY / kTileSize; row++) {
+            rowTriangles[row].push_back((uint32_t)t);
+        }
+    }
+    if (frameTriangles == 0) {
+        return;
+    }
+
+    JobSystem::instance().parallelFor(tilesY, 1, [this](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            rasterizeTileRow((int)row);
+        }
+    });
+}
+
+bool OcclusionCuller::testBox(glm::vec3 boundsMin, glm::vec3 boundsMax) const {
+    if (frameTriangles == 0) {
+        return true;
+    }
+
+    float width = float(settings.width);
+    float height = float(settings.height);
+    glm::vec2 screenMin(INFINITY);
+    glm::vec2 screenMax(-INFINITY);
+    float nearest = 0.0f;
+
+    // Corners as one transformed corner plus the transformed edges of the box
+    glm::vec3 size = boundsMax - boundsMin;
+    glm::vec4 base = viewProjection * glm::vec4(boundsMin, 1.0f);
+    glm::vec4 edges[3] = {viewProjection[0] * size.x, viewProjection[1] * size.y, viewProjection[2] * size.z};
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 clip = base;
+        for (int axis = 0; axis < 3; axis++) {
+            if (corner & (1 << axis)) {
+                clip += edges[axis];
+            }
+        }
+        if (clip.z < -clip.w || clip.w <= 0.0f) {
+            return true;
+        }
+        glm::vec3 screen = toScreen(clip, width, height);
+        screenMin = glm::min(screenMin, glm::vec2(screen));
+        screenMax = glm::max(screenMax, glm::vec2(screen));
+        nearest = std::max(nearest, screen.z);
+    }
+
+    // Every pixel the screen rectangle touches; off screen is the frustum's call
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= width || screenMin.y >= height) {
+        return true;
+    }
+    int minX = std::max(0, (int)std::floor(screenMin.x));
+    int minY = std::max(0, (int)std::floor(screenMin.y));
+    int maxX = std::min(settings.width - 1, (int)std::floor(screenMax.x));
+    int maxY = std::min(settings.height - 1, (int)std::floor(screenMax.y));
+
+    for (int tileY = minY / kTileSize; tileY <= maxY / kTileSize; tileY++) {
+        for (int tileX = minX / kTileSize; tileX <= maxX / kTileSize; tileX++) {
+            if (tileDepth[size_t(tileY) * tilesX + tileX] > nearest) {
+                continue;
+            }
+
+            // Some of the tile is as far as the box; look at the pixels the box covers
+            int x0 = std::max(minX, tileX * kTileSize);
+            int x1 = std::min(maxX, tileX * kTileSize + kTileSize - 1);
+            int y0 = std::max(minY, tileY * kTileSize);
+            int y1 = std::min(maxY, tileY * kTileSize + kTileSize - 1);
+            for (int y = y0; y <= y1; y++) {
+                const float *row = &depth[size_t(y) * settings.width];
+                for (int x = x0; x <= x1; x++) {
+                    if (row[x] <= nearest) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionCuller::testSphere(glm::vec3 center, float radius) const {
+    return testBox(center - radius, center + radius);
+}
+
+namespace {
+
+// Triangle bounds widened a little, so surfaces on a cell boundary mark both sides
+void triangleBounds(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, glm::vec3 &lower, glm::vec3 &upper) {
+    lower = glm::min(a, glm::min(b, c));
+    upper = glm::max(a, glm::max(b, c));
+    glm::vec3 margin = (upper - lower) * 1e-4f + 1e-6f;
+    lower -= margin;
+    upper += margin;
+}
+
+void setBounds(OccluderMesh &occluder, glm::vec3 lower, glm::vec3 upper) {
+    occluder.boundsCenter = (lower + upper) * 0.5f;
+    occluder.boundsRadius = glm::length(upper - lower) * 0.5f;
+}
+
+void addQuad(OccluderMesh &occluder, glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 d) {
+    uint32_t first = (uint32_t)occluder.vertices.size();
+    occluder.vertices.insert(occluder.vertices.end(), {a, b, c, d});
+    occluder.indices.insert(occluder.indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+}
+
+}
+
+void buildBoxOccluder(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                      OccluderMesh &occluder, int resolution) {
+    occluder = OccluderMesh();
+    if (indices.size() < 3 || resolution < 1) {
+        return;
+    }
+    glm::vec3 lower(INFINITY), upper(-INFINITY);
+    for (uint32_t index : indices) {
+        lower = glm::min(lower, positions[index]);
+        upper = glm::max(upper, positions[index]);
+    }
+    glm::vec3 cellSize = (upper - lower) / float(resolution);
+    if (!(cellSize.x > 0.0f && cellSize.y > 0.0f && cellSize.z > 0.0f)) {
+        return;
+    }
+
+    // Voxels with a ring of empty ones around, so the outside is connected
+    const int size = resolution + 2;
+    auto cell = [size](int x, int y, int z) { return (size_t(z) * size + y) * size + x; };
+    enum : uint8_t { Empty, Surface, Outside };
+    std::vector<uint8_t> voxels(size_t(size) * size * size, Empty);
+
+    // Every voxel a triangle's plane passes through inside its bounds, which
+    // marks a few more than the triangle touches but never fewer
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+        glm::vec3 triangleLower, triangleUpper;
+        triangleBounds(a, b, c, triangleLower, triangleUpper);
+        glm::ivec3 first = glm::clamp(glm::ivec3(glm::floor((triangleLower - lower) / cellSize)), 0, resolution - 1);
+        glm::ivec3 last = glm::clamp(glm::ivec3(glm::floor((triangleUpper - lower) / cellSize)), 0, resolution - 1);
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float reach = glm::dot(glm::abs(normal), cellSize * 0.5f) * 1.001f;
+        for (int z = first.z; z <= last.z; z++) {
+            for (int y = first.y; y <= last.y; y++) {
+                for (int x = first.x; x <= last.x; x++) {
+                    glm::vec3 center = lower + (glm::vec3(x, y, z) + 0.5f) * cellSize;
+                    if (std::abs(glm::dot(normal, center - a)) <= reach) {
+                        voxels[cell(x + 1, y + 1, z + 1)] = Surface;
+                    }
+                }
+            }
+        }
+    }
+
+    // Flood the outside in; empty voxels it cannot reach are enclosed
+    std::vector<glm::ivec3> stack(1, glm::ivec3(0));
+    voxels[0] = Outside;
+    const glm::ivec3 steps[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    while (!stack.empty()) {
+        glm::ivec3 at = stack.back();
+        stack.pop_back();
+        for (const glm::ivec3 &step : steps) {
+            glm::ivec3 next = at + step;
+            if (next.x < 0 || next.y < 0 || next.z < 0 || next.x >= size || next.y >= size || next.z >= size) {
+                continue;
+            }
+            uint8_t &voxel = voxels[cell(next.x, next.y, next.z)];
+            if (voxel == Empty) {
+                voxel = Outside;
+                stack.push_back(next);
+            }
+        }
+    }
+
+    // Enclosed voxels summed from the origin corner, for the count in any box at once
+    const int sums = resolution + 1;
+    auto sum = [sums](int x, int y, int z) { return (size_t(z) * sums + y) * sums + x; };
+    std::vector<uint32_t> enclosed(size_t(sums) * sums * sums, 0);
+    for (int z = 1; z <= resolution; z++) {
+        for (int y = 1; y <= resolution; y++) {
+            for (int x = 1; x <= resolution; x++) {
+                enclosed[sum(x, y, z)] = (voxels[cell(x, y, z)] == Empty ? 1u : 0u) + enclosed[sum(x - 1, y, z)] +
+                                         enclosed[sum(x, y - 1, z)] + enclosed[sum(x, y, z - 1)] - enclosed[sum(x - 1, y - 1, z)] -
+                                         enclosed[sum(x - 1, y, z - 1)] - enclosed[sum(x, y - 1, z - 1)] + enclosed[sum(x - 1, y - 1, z - 1)];
+            }
+        }
+    }
+    auto count = [&](glm::ivec3 from, glm::ivec3 to) {
+        return enclosed[sum(to.x, to.y, to.z)] - enclosed[sum(from.x, to.y, to.z)] - enclosed[sum(to.x, from.y, to.z)] -
+               enclosed[sum(to.x, to.y, from.z)] + enclosed[sum(from.x, from.y, to.z)] + enclosed[sum(from.x, to.y, from.z)] +
+               enclosed[sum(to.x, from.y, from.z)] - enclosed[sum(from.x, from.y, from.z)];
+    };
+
+    // The largest box that is enclosed throughout; each x and y range stops
+    // growing along z at the first voxel that is not
+    float cellVolume = cellSize.x * cellSize.y * cellSize.z;
+    float bestVolume = 0.0f;
+    glm::ivec3 bestFrom(0), bestTo(0);
+    for (int x0 = 0; x0 < resolution; x0++) {
+        for (int x1 = x0 + 1; x1 <= resolution; x1++) {
+            for (int y0 = 0; y0 < resolution; y0++) {
+                for (int y1 = y0 + 1; y1 <= resolution; y1++) {
+                    uint32_t slice = uint32_t((x1 - x0) * (y1 - y0));
+                    if (float(slice) * resolution * cellVolume <= bestVolume) {
+                        continue;
+                    }
+                    for (int z0 = 0; z0 < resolution; z0++) {
+                        int z1 = z0;
+                        while (z1 < resolution && count(glm::ivec3(x0, y0, z1), glm::ivec3(x1, y1, z1 + 1)) == slice) {
+                            z1++;
+                        }
+                        float volume = float(slice) * float(z1 - z0) * cellVolume;
+                        if (volume > bestVolume) {
+                            bestVolume = volume;
+                            bestFrom = glm::ivec3(x0, y0, z0);
+                            bestTo = glm::ivec3(x1, y1, z1);
+                        }
+                        z0 = z1;
+                    }
+                }
+            }
+        }
+    }
+    if (bestVolume == 0.0f) {
+        return;
+    }
+
+    glm::vec3 boxLower = lower + glm::vec3(bestFrom) * cellSize;
+    glm::vec3 boxUpper = lower + glm::vec3(bestTo) * cellSize;
+    for (int corner = 0; corner < 8; corner++) {
+        occluder.vertices.push_back(glm::vec3(corner & 1 ? boxUpper.x : boxLower.x, corner & 2 ? boxUpper.y : boxLower.y,
+                                              corner & 4 ? boxUpper.z : boxLower.z));
+    }
+    const uint32_t faces[6][4] = {{0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}};
+    for (const uint32_t *face : faces) {
+        occluder.indices.insert(occluder.indices.end(), {face[0], face[1], face[2], face[0], face[2], face[3]});
+    }
+    setBounds(occluder, boxLower, boxUpper);
+}
+
+void buildHeightfieldOccluder(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                              OccluderMesh &occluder, int resolution) {
+    occluder = OccluderMesh();
+    if (indices.size() < 3 || resolution < 1) {
+        return;
+    }
+    glm::vec3 lower(INFINITY), upper(-INFINITY);
+    for (uint32_t index : indices) {
+        lower = glm::min(lower, positions[index]);
+        upper = glm::max(upper, positions[index]);
+    }
+    glm::vec2 cellSize = glm::vec2(upper.x - lower.x, upper.z - lower.z) / float(resolution);
+    if (!(cellSize.x > 0.0f && cellSize.y > 0.0f)) {
+        return;
+    }
+
+    // Each cell takes the lowest point of every triangle whose bounds reach
+    // it, no higher than the surface anywhere over the cell, edges included
+    std::vector<float> heights(size_t(resolution) * resolution, INFINITY);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+        glm::vec3 triangleLower, triangleUpper;
+        triangleBounds(a, b, c, triangleLower, triangleUpper);
+        int firstX = glm::clamp((int)std::floor((triangleLower.x - lower.x) / cellSize.x), 0, resolution - 1);
+        int lastX = glm::clamp((int)std::floor((triangleUpper.x - lower.x) / cellSize.x), 0, resolution - 1);
+        int firstZ = glm::clamp((int)std::floor((triangleLower.z - lower.z) / cellSize.y), 0, resolution - 1);
+        int lastZ = glm::clamp((int)std::floor((triangleUpper.z - lower.z) / cellSize.y), 0, resolution - 1);
+        float lowest = std::min(a.y, std::min(b.y, c.y));
+        for (int z = firstZ; z <= lastZ; z++) {
+            for (int x = firstX; x <= lastX; x++) {
+                float &height = heights[size_t(z) * resolution + x];
+                height = std::min(height, lowest);
+            }
+        }
+    }
+
+    // Tops, then a step up the shared edge wherever a neighbour stands higher;
+    // cells no triangle reaches are left open
+    auto corner = [&](int x, int z, float y) { return glm::vec3(lower.x + x * cellSize.x, y, lower.z + z * cellSize.y); };
+    float highest = -INFINITY;
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            float height = heights[size_t(z) * resolution + x];
+            if (height == INFINITY) {
+                continue;
+            }
+            highest = std::max(highest, height);
+            addQuad(occluder, corner(x, z, height), corner(x, z + 1, height), corner(x + 1, z + 1, height), corner(x + 1, z, height));
+            if (x + 1 < resolution) {
+                float next = heights[size_t(z) * resolution + x + 1];
+                if (next != INFINITY && next != height) {
+                    addQuad(occluder, corner(x + 1, z, height), corner(x + 1, z + 1, height), corner(x + 1, z + 1, next), corner(x + 1, z, next));
+                }
+            }
+            if (z + 1 < resolution) {
+                float next = heights[size_t(z + 1) * resolution + x];
+                if (next != INFINITY && next != height) {
+                    addQuad(occluder, corner(x, z + 1, height), corner(x + 1, z + 1, height), corner(x + 1, z + 1, next), corner(x, z + 1, next));
+                }
+            }
+        }
+    }
+    if (!occluder.indices.empty()) {
+        setBounds(occluder, glm::vec3(lower.x, lower.y, lower.z), glm::vec3(upper.x, highest, upper.z));
+    }
+}
+
+void buildOccluder(OccluderShape shape, const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                   OccluderMesh &occluder) {
+    if (shape == OccluderShape::Heightfield) {
+        buildHeightfieldOccluder(positions, indices, occluder);
+    } else {
+        buildBoxOccluder(positions, indices, occluder);
+    }
+}
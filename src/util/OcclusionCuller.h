@@ -0,0 +1,125 @@
+#ifndef _OCCLUSION_CULLER_H_
+#define _OCCLUSION_CULLER_H_
+
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stand-in for a mesh, lying inside it, for rasterising on the CPU
+struct OccluderMesh {
+    std::vector<glm::vec3> vertices;    // model space
+    std::vector<uint32_t> indices;      // triangles, either winding
+
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+};
+
+// Occluders have to lie inside the surface they stand in for, or they hide
+// what is in plain view past its edges. Both builders take the full detail
+// mesh in model space.
+enum class OccluderShape {
+    Box,                        // buildings
+    Heightfield,                // terrain
+};
+
+// The largest box of voxels the surface encloses; nothing when the surface has
+// a gap to the outside wider than a voxel
+void buildBoxOccluder(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                      OccluderMesh &occluder, int resolution = 24);
+
+// A grid of flat cells, each as low as the lowest surface over it, with upright
+// steps between neighbours. Everything under the surface counts as solid
+// ground, as it does for tiles laid edge to edge.
+void buildHeightfieldOccluder(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                              OccluderMesh &occluder, int resolution = 32);
+
+void buildOccluder(OccluderShape shape, const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                   OccluderMesh &occluder);
+
+struct OcclusionSettings {
+    int width = 256;                // both multiples of the 8 pixel tile
+    int height = 144;
+    float minOccluderPixels = 6.0f;     // projected radius below which an occluder is not worth drawing
+};
+
+// Software occlusion culling. Occluder triangles are rasterised into a small
+// depth buffer holding 1/w, which is linear in screen space and larger for
+// nearer surfaces, eight pixels at a time with AVX or two SSE registers of
+// four. Each row of 8x8 tiles is a job of its own, and once a row is done its
+// tiles record their farthest depth. Occludees are boxes: one is hidden when
+// its nearest point is behind the farthest occluder depth of every tile its
+// screen rectangle covers, and tiles that cannot settle that alone are tested
+// pixel by pixel.
+class OcclusionCuller {
+    struct Occluder {
+        const OccluderMesh *mesh;
+        glm::mat4 transform;            // model to clip space
+    };
+
+    // Set up in screen space after near plane clipping, counter-clockwise:
+    // edge functions a * x + b * y + c, positive inside, where each edge
+    // crosses a row as crossSlope * y + crossOffset, and 1/w as a plane
+    struct Triangle {
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float crossSlope[3];
+        float crossOffset[3];
+        float depthA;
+        float depthB;
+        float depthC;
+        int minX;                       // first span, a multiple of eight
+        int maxX;
+        int minY;
+        int maxY;                       // inclusive
+    };
+
+    OcclusionSettings settings;
+    int tilesX;
+    int tilesY;
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    Frustum frustum;
+
+    std::vector<Occluder> occluders;
+    std::vector<std::vector<Triangle>> chunkTriangles;  // set up by each job, kept for their capacity
+    std::vector<Triangle> triangles;    // all of them, packed together for rasterising
+    std::vector<std::vector<uint32_t>> rowTriangles;    // the triangles reaching each row of tiles
+    std::vector<float> depth;           // per pixel, 0 where nothing was drawn
+    std::vector<float> tileDepth;       // farthest depth in each tile
+
+    size_t frameTriangles = 0;
+
+    void setupTriangles(const Occluder &occluder, std::vector<Triangle> &out);
+    void rasterizeTileRow(int tileRow);
+
+    public:
+        explicit OcclusionCuller(const OcclusionSettings &settings = OcclusionSettings());
+
+        // Drops last frame's occluders and clears the depth buffer
+        void beginFrame(const glm::mat4 &viewProjection);
+
+        // mesh must stay alive until rasterize() has returned; occluders outside
+        // the view or too small on screen to hide much are skipped here
+        void addOccluder(const OccluderMesh &mesh, const glm::mat4 &model);
+
+        // Fills the depth buffer from every occluder added this frame, spread
+        // over the job system
+        void rasterize();
+
+        // False when the box or sphere is certainly hidden; anything crossing
+        // the near plane counts as visible. Safe to call from several threads.
+        bool testBox(glm::vec3 boundsMin, glm::vec3 boundsMax) const;
+        bool testSphere(glm::vec3 center, float radius) const;
+
+        size_t trianglesLastFrame() const { return frameTriangles; }
+        int width() const { return settings.width; }
+        int height() const { return settings.height; }
+        const std::vector<float> &depthBuffer() const { return depth; }
+};
+
+#endif
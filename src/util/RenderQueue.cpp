@@ -0,0 +1,141 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+
+namespace {
+
+// Positive floats order like their bit patterns; the top 16 bits keep the
+// exponent and seven bits of mantissa, plenty to sort by distance
+uint64_t depthBits(float depth) {
+    if (!(depth > 0.0f)) {
+        return 0;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 16;
+}
+
+}
+
+uint64_t RenderQueue::sortKey(RenderPass pass, GLuint programID, GLuint textureID, GLuint vertexArrayID, float depth) {
+    return (uint64_t((uint8_t)pass & 0xf) << 60) | (uint64_t(programID & 0xfff) << 48) |
+           (uint64_t(textureID & 0xffff) << 32) | (uint64_t(vertexArrayID & 0xffff) << 16) | depthBits(depth);
+}
+
+void RenderQueue::beginFrame() {
+    packets.clear();
+    keys.clear();
+}
+
+void RenderQueue::submit(DrawPacket packet, RenderPass pass, float depth) {
+    packet.key = sortKey(pass, packet.programID, packet.textureID, packet.vertexArrayID, depth);
+    keys.push_back(packet.key);
+    packets.push_back(packet);
+}
+
+void RenderQueue::sort() {
+    size_t count = keys.size();
+    order.resize(count);
+    sortedKeys.resize(count);
+    sortedOrder.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        order[i] = (uint32_t)i;
+    }
+
+    // Least significant byte first, eight stable counting passes; a byte every
+    // key shares, such as most of the pass field, costs only its histogram
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (size_t i = 0; i < count; i++) {
+            counts[(keys[i] >> shift) & 0xff]++;
+        }
+        if (counts[(keys[0] >> shift) & 0xff] == count) {
+            continue;
+        }
+
+        size_t offsets[256];
+        size_t total = 0;
+        for (int b = 0; b < 256; b++) {
+            offsets[b] = total;
+            total += counts[b];
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = offsets[(keys[i] >> shift) & 0xff]++;
+            sortedKeys[slot] = keys[i];
+            sortedOrder[slot] = order[i];
+        }
+        keys.swap(sortedKeys);
+        order.swap(sortedOrder);
+    }
+}
+
+RenderStats RenderQueue::countChanges(const std::vector<uint32_t> &sequence) const {
+    RenderStats stats;
+    const DrawPacket *previous = nullptr;
+    for (uint32_t index : sequence) {
+        const DrawPacket &packet = packets[index];
+        if (!previous || packet.programID != previous->programID) {
+            stats.programChanges++;
+        }
+        if (!previous || packet.textureID != previous->textureID) {
+            stats.textureChanges++;
+        }
+        if (!previous || packet.vertexArrayID != previous->vertexArrayID) {
+            stats.vertexArrayChanges++;
+        }
+        if (packet.setup && (!previous || packet.setup != previous->setup || packet.object != previous->object ||
+                             packet.programID != previous->programID)) {
+            stats.setupCalls++;
+        }
+        stats.draws++;
+        previous = &packet;
+    }
+    return stats;
+}
+
+void RenderQueue::flush() {
+    if (packets.empty()) {
+        lastStats = RenderStats();
+        lastUnsortedStats = RenderStats();
+        return;
+    }
+
+    // Submission order, for comparison
+    order.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); i++) {
+        order[i] = (uint32_t)i;
+    }
+    lastUnsortedStats = countChanges(order);
+
+    sort();
+    lastStats = countChanges(order);
+
+    glActiveTexture(GL_TEXTURE0);
+    const DrawPacket *previous = nullptr;
+    for (uint32_t index : order) {
+        const DrawPacket &packet = packets[index];
+        if (!previous || packet.programID != previous->programID) {
+            glUseProgram(packet.programID);
+        }
+        if (!previous || packet.textureID != previous->textureID) {
+            glBindTexture(GL_TEXTURE_2D, packet.textureID);
+        }
+        if (!previous || packet.vertexArrayID != previous->vertexArrayID) {
+            glBindVertexArray(packet.vertexArrayID);
+        }
+        // Uniforms belong to the program, so a program change means setting them again
+        if (packet.setup && (!previous || packet.setup != previous->setup || packet.object != previous->object ||
+                             packet.programID != previous->programID)) {
+            packet.setup(packet.object);
+        }
+
+        if (packet.instanceCount == 1) {
+            glDrawElements(packet.mode, packet.indexCount, packet.indexType, (void *)packet.indexOffset);
+        } else if (packet.instanceCount > 1) {
+            glDrawElementsInstanced(packet.mode, packet.indexCount, packet.indexType, (void *)packet.indexOffset,
+                                    packet.instanceCount);
+        }
+        previous = &packet;
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,82 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Passes run in this order; the pass is the most significant part of the key
+enum class RenderPass : uint8_t {
+    Background,
+    Opaque,
+};
+
+// One draw and the state it needs. The queue binds the program, the texture on
+// unit 0 and the vertex array, skipping whatever is already bound, then calls
+// setup with object for per-object uniforms (skipped when the previous packet
+// had the same object and setup) and issues the indexed draw. setup must not
+// change the program, unit 0's texture or the vertex array.
+struct DrawPacket {
+    uint64_t key = 0;
+    GLuint programID = 0;
+    GLuint textureID = 0;
+    GLuint vertexArrayID = 0;
+
+    void (*setup)(const void *object) = nullptr;
+    const void *object = nullptr;
+
+    GLenum mode = GL_TRIANGLES;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    uintptr_t indexOffset = 0;
+    GLsizei instanceCount = 1;
+};
+
+// State changes one frame's packets caused
+struct RenderStats {
+    unsigned draws = 0;
+    unsigned programChanges = 0;
+    unsigned textureChanges = 0;
+    unsigned vertexArrayChanges = 0;
+    unsigned setupCalls = 0;
+};
+
+// Collects the frame's draw packets, radix sorts them by key and submits them
+// with redundant binds filtered out. Keys, most significant first:
+//   pass 4 bits | program 12 | texture 16 | vertex array 16 | depth 16
+// GL names are truncated to their field, which at worst splits a group.
+class RenderQueue {
+    std::vector<DrawPacket> packets;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> sortedKeys;
+    std::vector<uint32_t> sortedOrder;
+
+    RenderStats lastStats;
+    RenderStats lastUnsortedStats;
+
+    void sort();
+    RenderStats countChanges(const std::vector<uint32_t> &sequence) const;
+
+    public:
+        // depth is the distance from the camera, nearest first within a group
+        static uint64_t sortKey(RenderPass pass, GLuint programID, GLuint textureID, GLuint vertexArrayID, float depth);
+
+        void beginFrame();
+
+        // Fills in the key from the packet's state and depth
+        void submit(DrawPacket packet, RenderPass pass, float depth);
+
+        // Sorts and draws everything submitted since beginFrame
+        void flush();
+
+        size_t size() const { return packets.size(); }
+
+        // Changes made by the last flush, and what submission order would have made
+        const RenderStats &statsLastFrame() const { return lastStats; }
+        const RenderStats &unsortedStatsLastFrame() const { return lastUnsortedStats; }
+};
+
+#endif
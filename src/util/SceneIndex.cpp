@@ -0,0 +1,485 @@
+#include "SceneIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const uint64_t kEmptyKey = ~0ull;
+const int kCoordinateBits = 20;
+const int64_t kCoordinateBias = int64_t(1) << (kCoordinateBits - 1);
+const uint64_t kCoordinateMask = (uint64_t(1) << kCoordinateBits) - 1;
+
+uint64_t packCoordinate(int64_t c) {
+    return uint64_t(std::min(std::max(c + kCoordinateBias, int64_t(0)), int64_t(kCoordinateMask)));
+}
+
+uint32_t hashKey(uint64_t key, uint32_t mask) {
+    key ^= key >> 31;
+    key *= 0x9e3779b97f4a7c15ull;
+    return uint32_t(key >> 32) & mask;
+}
+
+// Whether an axis aligned box is outside the frustum (-1), straddles it (0)
+// or lies entirely inside (1)
+int classifyBox(const Frustum &frustum, glm::vec3 boxMin, glm::vec3 boxMax) {
+    int result = 1;
+    for (const glm::vec4 &plane : frustum.planes) {
+        glm::vec3 normal = glm::vec3(plane);
+        glm::vec3 farthest = glm::vec3(normal.x >= 0.0f ? boxMax.x : boxMin.x, normal.y >= 0.0f ? boxMax.y : boxMin.y,
+                                       normal.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(normal, farthest) + plane.w < 0.0f) {
+            return -1;
+        }
+        glm::vec3 nearest = glm::vec3(normal.x >= 0.0f ? boxMin.x : boxMax.x, normal.y >= 0.0f ? boxMin.y : boxMax.y,
+                                      normal.z >= 0.0f ? boxMin.z : boxMax.z);
+        if (glm::dot(normal, nearest) + plane.w < 0.0f) {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+}
+
+SceneIndex::SceneIndex(const SceneIndexSettings &settings) : settings(settings) {
+    // Four bits of the key hold the level, and the all-ones key marks empty slots
+    this->settings.levelCount = std::min(std::max(settings.levelCount, 1), 15);
+    levelCells.assign(this->settings.levelCount, 0);
+    levelLow.assign(this->settings.levelCount, glm::vec3(INFINITY));
+    levelHigh.assign(this->settings.levelCount, glm::vec3(-INFINITY));
+    slotKeys.assign(64, kEmptyKey);
+    slotCells.assign(64, kNone);
+    largestRadius = 0.0f;
+}
+
+int SceneIndex::levelFor(float radius) const {
+    int level = 0;
+    float size = settings.finestCellSize;
+    while (level + 1 < settings.levelCount && size < 2.0f * radius) {
+        size *= 2.0f;
+        level++;
+    }
+    return level;
+}
+
+float SceneIndex::cellSize(int level) const {
+    return std::ldexp(settings.finestCellSize, level);
+}
+
+float SceneIndex::reachOf(int level) const {
+    // The coarsest level takes whatever is too big for it, so its reach is what it holds
+    float halfCell = cellSize(level) * 0.5f;
+    return level + 1 == settings.levelCount ? std::max(halfCell, largestRadius) : halfCell;
+}
+
+uint64_t SceneIndex::keyFor(int level, glm::vec3 center) const {
+    float inverse = 1.0f / cellSize(level);
+    uint64_t x = packCoordinate((int64_t)std::floor(center.x * inverse));
+    uint64_t y = packCoordinate((int64_t)std::floor(center.y * inverse));
+    uint64_t z = packCoordinate((int64_t)std::floor(center.z * inverse));
+    return (uint64_t(level) << (3 * kCoordinateBits)) | (x << (2 * kCoordinateBits)) | (y << kCoordinateBits) | z;
+}
+
+uint64_t SceneIndex::parentKey(uint64_t key) {
+    uint64_t parent = ((key >> (3 * kCoordinateBits)) + 1) << (3 * kCoordinateBits);
+    for (int shift = 0; shift < 3 * kCoordinateBits; shift += kCoordinateBits) {
+        // Halved rounding down, as floor(center / cellSize) is at twice the size
+        int64_t c = int64_t((key >> shift) & kCoordinateMask) - kCoordinateBias;
+        parent |= packCoordinate((c - (c < 0 ? 1 : 0)) / 2) << shift;
+    }
+    return parent;
+}
+
+uint32_t SceneIndex::findSlot(uint64_t key) const {
+    uint32_t mask = (uint32_t)slotKeys.size() - 1;
+    for (uint32_t slot = hashKey(key, mask);; slot = (slot + 1) & mask) {
+        if (slotKeys[slot] == key || slotKeys[slot] == kEmptyKey) {
+            return slot;
+        }
+    }
+}
+
+uint32_t SceneIndex::findCell(uint64_t key) const {
+    uint32_t slot = findSlot(key);
+    return slotKeys[slot] == key ? slotCells[slot] : kNone;
+}
+
+void SceneIndex::growSlots() {
+    std::vector<uint64_t> oldKeys(slotKeys.size() * 2, kEmptyKey);
+    std::vector<uint32_t> oldCells(slotCells.size() * 2, kNone);
+    oldKeys.swap(slotKeys);
+    oldCells.swap(slotCells);
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+        if (oldKeys[i] != kEmptyKey) {
+            uint32_t slot = findSlot(oldKeys[i]);
+            slotKeys[slot] = oldKeys[i];
+            slotCells[slot] = oldCells[i];
+        }
+    }
+}
+
+uint32_t SceneIndex::acquireCell(uint64_t key, int level) {
+    uint32_t existing = findCell(key);
+    if (existing != kNone) {
+        return existing;
+    }
+
+    // Parents first, so every cell's chain up to the coarsest level exists
+    uint32_t parent = level + 1 < settings.levelCount ? acquireCell(parentKey(key), level + 1) : kNone;
+    uint32_t slot = findSlot(key);
+
+    glm::vec3 coordinates = glm::vec3(float((key >> (2 * kCoordinateBits)) & kCoordinateMask),
+                                      float((key >> kCoordinateBits) & kCoordinateMask), float(key & kCoordinateMask)) -
+                            float(kCoordinateBias);
+    levelLow[level] = glm::min(levelLow[level], coordinates);
+    levelHigh[level] = glm::max(levelHigh[level], coordinates);
+
+    Cell cell;
+    cell.key = key;
+    cell.level = level;
+    cell.boundsMin = glm::vec3(INFINITY);
+    cell.boundsMax = glm::vec3(-INFINITY);
+    cell.treeMin = glm::vec3(INFINITY);
+    cell.treeMax = glm::vec3(-INFINITY);
+    cell.first = kNone;
+    cell.count = 0;
+    cell.parent = parent;
+    cell.firstChild = kNone;
+    cell.previousSibling = kNone;
+    cell.nextSibling = parent != kNone ? cells[parent].firstChild : firstRoot;
+    uint32_t cellIndex = (uint32_t)cells.size();
+    if (cell.nextSibling != kNone) {
+        cells[cell.nextSibling].previousSibling = cellIndex;
+    }
+    (parent != kNone ? cells[parent].firstChild : firstRoot) = cellIndex;
+    cells.push_back(cell);
+    levelCells[level]++;
+
+    slotKeys[slot] = key;
+    slotCells[slot] = cellIndex;
+    // At most half full, so probe runs stay short
+    if (cells.size() * 2 > slotKeys.size()) {
+        growSlots();
+    }
+    return cellIndex;
+}
+
+void SceneIndex::releaseCell(uint32_t cellIndex) {
+    Cell &cell = cells[cellIndex];
+    uint32_t parent = cell.parent;
+    uint64_t parentCellKey = parent != kNone ? cells[parent].key : kEmptyKey;
+    if (cell.previousSibling != kNone) {
+        cells[cell.previousSibling].nextSibling = cell.nextSibling;
+    } else {
+        (parent != kNone ? cells[parent].firstChild : firstRoot) = cell.nextSibling;
+    }
+    if (cell.nextSibling != kNone) {
+        cells[cell.nextSibling].previousSibling = cell.previousSibling;
+    }
+
+    // Backward shift deletion: later entries of the probe run move up into the
+    // hole, so lookups never need tombstones
+    uint32_t mask = (uint32_t)slotKeys.size() - 1;
+    uint32_t hole = findSlot(cells[cellIndex].key);
+    for (uint32_t slot = (hole + 1) & mask; slotKeys[slot] != kEmptyKey; slot = (slot + 1) & mask) {
+        uint32_t home = hashKey(slotKeys[slot], mask);
+        bool movable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (movable) {
+            slotKeys[hole] = slotKeys[slot];
+            slotCells[hole] = slotCells[slot];
+            hole = slot;
+        }
+    }
+    slotKeys[hole] = kEmptyKey;
+    slotCells[hole] = kNone;
+    levelCells[cells[cellIndex].level]--;
+
+    // Keep the array dense: the last cell takes the released one's place, and
+    // whatever pointed at it is repointed
+    uint32_t last = (uint32_t)cells.size() - 1;
+    if (cellIndex != last) {
+        Cell &moved = cells[cellIndex];
+        moved = cells[last];
+        slotCells[findSlot(moved.key)] = cellIndex;
+        for (uint32_t e = moved.first; e != kNone; e = entities[e].next) {
+            entities[e].cell = cellIndex;
+        }
+        for (uint32_t c = moved.firstChild; c != kNone; c = cells[c].nextSibling) {
+            cells[c].parent = cellIndex;
+        }
+        if (moved.previousSibling != kNone) {
+            cells[moved.previousSibling].nextSibling = cellIndex;
+        } else {
+            (moved.parent != kNone ? cells[moved.parent].firstChild : firstRoot) = cellIndex;
+        }
+        if (moved.nextSibling != kNone) {
+            cells[moved.nextSibling].previousSibling = cellIndex;
+        }
+    }
+    cells.pop_back();
+
+    // A parent left with nothing below it goes too
+    if (parent != kNone) {
+        parent = findCell(parentCellKey);
+        if (cells[parent].count == 0 && cells[parent].firstChild == kNone) {
+            releaseCell(parent);
+        }
+    }
+}
+
+void SceneIndex::growTree(uint32_t cellIndex, glm::vec3 boxMin, glm::vec3 boxMax) {
+    // Up to the first ancestor whose box already holds this one
+    for (uint32_t c = cellIndex; c != kNone; c = cells[c].parent) {
+        Cell &cell = cells[c];
+        if (glm::all(glm::lessThanEqual(cell.treeMin, boxMin)) && glm::all(glm::greaterThanEqual(cell.treeMax, boxMax))) {
+            return;
+        }
+        cell.treeMin = glm::min(cell.treeMin, boxMin);
+        cell.treeMax = glm::max(cell.treeMax, boxMax);
+    }
+}
+
+void SceneIndex::link(SceneHandle handle, uint32_t cellIndex) {
+    Entity &entity = entities[handle];
+    Cell &cell = cells[cellIndex];
+    entity.cell = cellIndex;
+    entity.previous = kNone;
+    entity.next = cell.first;
+    if (cell.first != kNone) {
+        entities[cell.first].previous = handle;
+    }
+    cell.first = handle;
+    cell.count++;
+    cell.boundsMin = glm::min(cell.boundsMin, entity.center - entity.radius);
+    cell.boundsMax = glm::max(cell.boundsMax, entity.center + entity.radius);
+    growTree(cellIndex, entity.center - entity.radius, entity.center + entity.radius);
+}
+
+void SceneIndex::unlink(SceneHandle handle) {
+    Entity &entity = entities[handle];
+    uint32_t cellIndex = entity.cell;
+    Cell &cell = cells[cellIndex];
+    if (entity.previous != kNone) {
+        entities[entity.previous].next = entity.next;
+    } else {
+        cell.first = entity.next;
+    }
+    if (entity.next != kNone) {
+        entities[entity.next].previous = entity.previous;
+    }
+    entity.cell = kNone;
+    if (--cell.count == 0 && cell.firstChild == kNone) {
+        releaseCell(cellIndex);
+    }
+}
+
+SceneHandle SceneIndex::insert(glm::vec3 center, float radius, uint32_t userData) {
+    SceneHandle handle;
+    if (freeEntity != kNone) {
+        handle = freeEntity;
+        freeEntity = entities[handle].next;
+    } else {
+        handle = (SceneHandle)entities.size();
+        entities.push_back(Entity());
+    }
+
+    Entity &entity = entities[handle];
+    entity.center = center;
+    entity.radius = radius;
+    entity.userData = userData;
+    liveEntities++;
+
+    int level = levelFor(radius);
+    largestRadius = level + 1 == settings.levelCount ? std::max(largestRadius, radius) : largestRadius;
+    link(handle, acquireCell(keyFor(level, center), level));
+    return handle;
+}
+
+void SceneIndex::move(SceneHandle handle, glm::vec3 center, float radius) {
+    Entity &entity = entities[handle];
+    int level = levelFor(radius);
+    uint64_t key = keyFor(level, center);
+    largestRadius = level + 1 == settings.levelCount ? std::max(largestRadius, radius) : largestRadius;
+
+    entity.center = center;
+    entity.radius = radius;
+    if (cells[entity.cell].key == key) {
+        // Still in its cell: the bounds only ever grow, up to the loose cell
+        Cell &cell = cells[entity.cell];
+        cell.boundsMin = glm::min(cell.boundsMin, center - radius);
+        cell.boundsMax = glm::max(cell.boundsMax, center + radius);
+        growTree(entity.cell, center - radius, center + radius);
+        return;
+    }
+
+    unlink(handle);
+    link(handle, acquireCell(key, level));
+}
+
+void SceneIndex::remove(SceneHandle handle) {
+    if (handle >= entities.size() || entities[handle].cell == kNone) {
+        return;
+    }
+    unlink(handle);
+    entities[handle].next = freeEntity;
+    freeEntity = handle;
+    liveEntities--;
+}
+
+template <typename Visit>
+void SceneIndex::forEachCellNear(int level, glm::vec3 center, float reach, Visit visit) const {
+    if (levelCells[level] == 0) {
+        return;
+    }
+
+    float inverse = 1.0f / cellSize(level);
+    glm::vec3 low = glm::max(glm::floor((center - reach) * inverse), levelLow[level]);
+    glm::vec3 high = glm::min(glm::floor((center + reach) * inverse), levelHigh[level]);
+    glm::vec3 span = high - low + 1.0f;
+    if (span.x <= 0.0f || span.y <= 0.0f || span.z <= 0.0f) {
+        return;
+    }
+
+    // A wide query over a sparse level is cheaper as a walk over the occupied cells
+    if (span.x * span.y * span.z > (float)levelCells[level]) {
+        uint64_t levelKey = uint64_t(level) << (3 * kCoordinateBits);
+        uint64_t levelMask = uint64_t(0xf) << (3 * kCoordinateBits);
+        for (uint32_t c = 0; c < cells.size(); c++) {
+            if ((cells[c].key & levelMask) == levelKey) {
+                visit(cells[c]);
+            }
+        }
+        return;
+    }
+
+    for (float z = low.z; z <= high.z; z += 1.0f) {
+        for (float y = low.y; y <= high.y; y += 1.0f) {
+            for (float x = low.x; x <= high.x; x += 1.0f) {
+                uint64_t key = (uint64_t(level) << (3 * kCoordinateBits)) |
+                               (packCoordinate((int64_t)x) << (2 * kCoordinateBits)) |
+                               (packCoordinate((int64_t)y) << kCoordinateBits) | packCoordinate((int64_t)z);
+                uint32_t c = findCell(key);
+                if (c != kNone) {
+                    visit(cells[c]);
+                }
+            }
+        }
+    }
+}
+
+void SceneIndex::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &userData, SphereSoA *bounds) const {
+    userData.clear();
+    if (bounds) {
+        bounds->clear();
+    }
+    straddling.clear();
+    straddlingData.clear();
+    for (uint32_t root = firstRoot; root != kNone; root = cells[root].nextSibling) {
+        queryFrustumCell(root, false, frustum, userData, bounds);
+    }
+
+    straddlingVisible.resize(straddling.size());
+    frustum.cullSpheres(straddling, straddlingVisible.data());
+    for (size_t i = 0; i < straddling.size(); i++) {
+        if (straddlingVisible[i]) {
+            userData.push_back(straddlingData[i]);
+            if (bounds) {
+                bounds->add(glm::vec3(straddling.x[i], straddling.y[i], straddling.z[i]), straddling.radius[i]);
+            }
+        }
+    }
+}
+
+void SceneIndex::queryFrustumCell(uint32_t cellIndex, bool inside, const Frustum &frustum,
+                                  std::vector<uint32_t> &userData, SphereSoA *bounds) const {
+    const Cell &cell = cells[cellIndex];
+    if (!inside) {
+        int side = classifyBox(frustum, cell.treeMin, cell.treeMax);
+        if (side < 0) {
+            return;
+        }
+        inside = side > 0;
+    }
+
+    int side = inside ? 1 : cell.first != kNone ? classifyBox(frustum, cell.boundsMin, cell.boundsMax) : -1;
+    if (side > 0) {
+        for (uint32_t e = cell.first; e != kNone; e = entities[e].next) {
+            const Entity &entity = entities[e];
+            userData.push_back(entity.userData);
+            if (bounds) {
+                bounds->add(entity.center, entity.radius);
+            }
+        }
+    } else if (side == 0) {
+        // Tested later with the other straddling cells' entities
+        for (uint32_t e = cell.first; e != kNone; e = entities[e].next) {
+            straddling.add(entities[e].center, entities[e].radius);
+            straddlingData.push_back(entities[e].userData);
+        }
+    }
+
+    for (uint32_t child = cell.firstChild; child != kNone; child = cells[child].nextSibling) {
+        queryFrustumCell(child, inside, frustum, userData, bounds);
+    }
+}
+
+void SceneIndex::queryRadius(glm::vec3 center, float radius, std::vector<uint32_t> &userData) const {
+    userData.clear();
+    for (int level = 0; level < settings.levelCount; level++) {
+        forEachCellNear(level, center, radius + reachOf(level), [&](const Cell &cell) {
+            // The query may overlap the loose cell but miss everything in it
+            glm::vec3 closest = glm::clamp(center, cell.boundsMin, cell.boundsMax);
+            if (glm::dot(closest - center, closest - center) > radius * radius) {
+                return;
+            }
+            for (uint32_t e = cell.first; e != kNone; e = entities[e].next) {
+                const Entity &entity = entities[e];
+                float reach = radius + entity.radius;
+                glm::vec3 offset = entity.center - center;
+                if (glm::dot(offset, offset) <= reach * reach) {
+                    userData.push_back(entity.userData);
+                }
+            }
+        });
+    }
+}
+
+bool SceneIndex::nearest(glm::vec3 point, float maxDistance, uint32_t &userData) const {
+    // Widening searches: the first that finds anything has found the nearest,
+    // since a closer center would have been inside it too
+    for (float reach = std::min(settings.finestCellSize, maxDistance);; reach = std::min(reach * 2.0f, maxDistance)) {
+        float bestDistance = reach * reach;
+        bool found = false;
+        for (int level = 0; level < settings.levelCount; level++) {
+            forEachCellNear(level, point, reach, [&](const Cell &cell) {
+                for (uint32_t e = cell.first; e != kNone; e = entities[e].next) {
+                    glm::vec3 offset = entities[e].center - point;
+                    float distance = glm::dot(offset, offset);
+                    if (distance <= bestDistance) {
+                        bestDistance = distance;
+                        userData = entities[e].userData;
+                        found = true;
+                    }
+                }
+            });
+        }
+        if (found || reach >= maxDistance) {
+            return found;
+        }
+    }
+}
+
+void SceneIndex::clear() {
+    entities.clear();
+    freeEntity = kNone;
+    liveEntities = 0;
+    cells.clear();
+    firstRoot = kNone;
+    levelCells.assign(settings.levelCount, 0);
+    levelLow.assign(settings.levelCount, glm::vec3(INFINITY));
+    levelHigh.assign(settings.levelCount, glm::vec3(-INFINITY));
+    std::fill(slotKeys.begin(), slotKeys.end(), kEmptyKey);
+    std::fill(slotCells.begin(), slotCells.end(), kNone);
+    largestRadius = 0.0f;
+}
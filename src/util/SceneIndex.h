@@ -0,0 +1,139 @@
+#ifndef _SCENE_INDEX_H_
+#define _SCENE_INDEX_H_
+
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Handle to an entity in a SceneIndex, stable until the entity is removed
+typedef uint32_t SceneHandle;
+const SceneHandle kInvalidSceneHandle = 0xffffffffu;
+
+struct SceneIndexSettings {
+    float finestCellSize = 32.0f;   // cells double in size from one level to the next
+    int levelCount = 12;            // bounds too big for the coarsest level go there anyway
+};
+
+// Hierarchical loose grid over bounding spheres. An entity lives in the cell
+// of the level whose cell size is at least its diameter that holds its center,
+// so its sphere never leaves that cell grown by half a cell on every side.
+// Only occupied cells and their parents exist: they are found through an open
+// addressing hash of (level, cell coordinates), kept in one dense array, and
+// thread their entities on an intrusive list. Each cell's parent is the cell
+// of the next level up that covers it, so the cells also form a tree from the
+// coarsest level down. Each cell keeps a box around the spheres linked into
+// it, tighter than the loose cell, and another around those of everything
+// below it, which frustum queries test before descending. Entities and cells
+// come from pools with free lists, so nothing is allocated per node once the
+// pools have grown. Moving an entity within its cell only rewrites its sphere
+// and grows the boxes above it; crossing into another cell is an unlink, a
+// hash lookup and a link.
+class SceneIndex {
+    struct Entity {
+        glm::vec3 center;
+        float radius;
+        uint32_t userData;
+        uint32_t cell;              // kNone while the slot is free
+        uint32_t previous;
+        uint32_t next;              // next in the cell, or in the free list
+    };
+
+    struct Cell {
+        uint64_t key;
+        int level;
+        glm::vec3 boundsMin;        // around every sphere linked in since the cell was made;
+        glm::vec3 boundsMax;        // never shrinks, but stays inside the loose cell
+        glm::vec3 treeMin;          // the same around this cell's spheres and those of
+        glm::vec3 treeMax;          // every cell below it
+        uint32_t first;
+        uint32_t count;
+        uint32_t parent;            // kNone at the coarsest level
+        uint32_t firstChild;
+        uint32_t previousSibling;   // among the parent's children, or the roots
+        uint32_t nextSibling;
+    };
+
+    static constexpr uint32_t kNone = 0xffffffffu;
+
+    SceneIndexSettings settings;
+
+    std::vector<Entity> entities;
+    uint32_t freeEntity = kNone;
+    uint32_t liveEntities = 0;
+
+    std::vector<Cell> cells;        // dense, occupied cells and their parents only
+    uint32_t firstRoot = kNone;     // cells of the coarsest level
+    std::vector<uint32_t> levelCells;   // occupied cells per level
+    std::vector<glm::vec3> levelLow;    // range of cell coordinates ever occupied per level,
+    std::vector<glm::vec3> levelHigh;   // which keeps flat scenes from probing empty layers
+    float largestRadius;            // of anything put in the coarsest level
+
+    // Entities of the cells queryFrustum found straddling a plane, gathered
+    // for one Frustum::cullSpheres pass at the end; scratch kept for its
+    // capacity, which makes queryFrustum unsafe to call from several threads
+    mutable SphereSoA straddling;
+    mutable std::vector<uint32_t> straddlingData;
+    mutable std::vector<uint8_t> straddlingVisible;
+
+    // Open addressing, linear probing, power of two sized; values index cells
+    std::vector<uint64_t> slotKeys;
+    std::vector<uint32_t> slotCells;
+
+    int levelFor(float radius) const;
+    float cellSize(int level) const;
+    // How far a sphere in a cell of this level may reach out of the cell
+    float reachOf(int level) const;
+    uint64_t keyFor(int level, glm::vec3 center) const;
+    static uint64_t parentKey(uint64_t key);
+
+    uint32_t findSlot(uint64_t key) const;
+    uint32_t findCell(uint64_t key) const;
+    uint32_t acquireCell(uint64_t key, int level);
+    void releaseCell(uint32_t cell);
+    void growSlots();
+    void growTree(uint32_t cell, glm::vec3 boxMin, glm::vec3 boxMax);
+
+    void link(SceneHandle handle, uint32_t cell);
+    void unlink(SceneHandle handle);
+
+    // Calls visit(cell) for the occupied cells of one level that may hold
+    // centers within reach of center
+    template <typename Visit>
+    void forEachCellNear(int level, glm::vec3 center, float reach, Visit visit) const;
+
+    // queryFrustum below one cell; inside when an ancestor's tree box already was
+    void queryFrustumCell(uint32_t cell, bool inside, const Frustum &frustum, std::vector<uint32_t> &userData,
+                          SphereSoA *bounds) const;
+
+    public:
+        explicit SceneIndex(const SceneIndexSettings &settings = SceneIndexSettings());
+
+        // userData is handed back by the queries, typically an index into the caller's own arrays
+        SceneHandle insert(glm::vec3 center, float radius, uint32_t userData);
+        void move(SceneHandle handle, glm::vec3 center, float radius);
+        void remove(SceneHandle handle);
+
+        // Entities whose spheres frustum.intersectsSphere would accept, walking
+        // the cell tree from the coarsest level: subtrees outside the frustum
+        // are skipped and those inside taken without testing their entities.
+        // Entities of cells that straddle a plane are tested together in one
+        // cullSpheres pass and come after the rest. bounds, if given, is
+        // refilled with their spheres in the same order.
+        void queryFrustum(const Frustum &frustum, std::vector<uint32_t> &userData, SphereSoA *bounds = nullptr) const;
+
+        // Entities whose spheres overlap the query sphere
+        void queryRadius(glm::vec3 center, float radius, std::vector<uint32_t> &userData) const;
+
+        // The entity with the center closest to point, searching out to
+        // maxDistance; returns false if there is none that close
+        bool nearest(glm::vec3 point, float maxDistance, uint32_t &userData) const;
+
+        size_t size() const { return liveEntities; }
+        size_t cellCount() const { return cells.size(); }
+        void clear();
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "Skeleton.h"
+#include "GltfModel.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SKELETON_SSE
+#endif
+
+namespace {
+
+// Column-major product: each output column is a linear combination of a's columns
+inline void multiplyMatrix(const float *a, const float *b, float *out) {
+#ifdef SKELETON_SSE
+    __m128 a0 = _mm_loadu_ps(a + 0);
+    __m128 a1 = _mm_loadu_ps(a + 4);
+    __m128 a2 = _mm_loadu_ps(a + 8);
+    __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int column = 0; column < 4; column++) {
+        const float *bc = b + column * 4;
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+        _mm_storeu_ps(out + column * 4, r);
+    }
+#else
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            out[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] +
+                                    a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+        }
+    }
+#endif
+}
+
+}
+
+size_t Skeleton::residentBytes() const {
+    return (nodes.capacity() + parents.capacity() + jointEntries.capacity()) * sizeof(int) +
+           inverseBindMatrices.capacity() * sizeof(glm::mat4);
+}
+
+Skeleton buildSkeleton(const GltfModel &model, const std::vector<int> &joints,
+                       const std::vector<glm::mat4> &inverseBindMatrices) {
+    Skeleton skeleton;
+    skeleton.inverseBindMatrices = inverseBindMatrices;
+    if (joints.empty() || joints[0] < 0 || joints[0] >= (int)model.nodes.size()) {
+        return skeleton;
+    }
+
+    // Breadth-first, so every parent is emitted before its children
+    std::vector<int> entryOfNode(model.nodes.size(), -1);
+    skeleton.nodes.push_back(joints[0]);
+    skeleton.parents.push_back(-1);
+    entryOfNode[joints[0]] = 0;
+    for (size_t i = 0; i < skeleton.nodes.size(); i++) {
+        for (int child : model.nodes[skeleton.nodes[i]].children) {
+            if (child < 0 || child >= (int)model.nodes.size() || entryOfNode[child] >= 0) {
+                continue;
+            }
+            entryOfNode[child] = (int)skeleton.nodes.size();
+            skeleton.nodes.push_back(child);
+            skeleton.parents.push_back((int)i);
+        }
+    }
+
+    // Joints outside the root's subtree keep the root's transform
+    for (int joint : joints) {
+        int entry = joint >= 0 && joint < (int)model.nodes.size() ? entryOfNode[joint] : -1;
+        skeleton.jointEntries.push_back(entry >= 0 ? entry : 0);
+    }
+    return skeleton;
+}
+
+void computeJointMatrices(const Skeleton &skeleton, const glm::mat4 *localTransforms,
+                          glm::mat4 *globals, glm::mat4 *jointMatrices) {
+    size_t count = skeleton.nodes.size();
+    if (count == 0) {
+        return;
+    }
+
+    globals[0] = localTransforms[skeleton.nodes[0]];
+    for (size_t i = 1; i < count; i++) {
+        multiplyMatrix(&globals[skeleton.parents[i]][0][0], &localTransforms[skeleton.nodes[i]][0][0], &globals[i][0][0]);
+    }
+
+    for (size_t j = 0; j < skeleton.jointEntries.size(); j++) {
+        multiplyMatrix(&globals[skeleton.jointEntries[j]][0][0], &skeleton.inverseBindMatrices[j][0][0], &jointMatrices[j][0][0]);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef _SKELETON_H_
+#define _SKELETON_H_
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct GltfModel;
+
+// A skin's node hierarchy flattened at load: nodes in topological order (every
+// parent before its children) with parents as indices into the same order, so
+// local to global propagation is one forward pass.
+struct Skeleton {
+    std::vector<int> nodes;                         // model node index of each entry
+    std::vector<int> parents;                       // entry index, -1 for the root
+    std::vector<int> jointEntries;                  // entry index of each skin joint
+    std::vector<glm::mat4> inverseBindMatrices;     // per skin joint
+
+    size_t jointCount() const { return jointEntries.size(); }
+    size_t residentBytes() const;
+};
+
+// Walks the node hierarchy below the first joint; model only needs its nodes
+Skeleton buildSkeleton(const GltfModel &model, const std::vector<int> &joints,
+                       const std::vector<glm::mat4> &inverseBindMatrices);
+
+// globals[i] = globals[parents[i]] * localTransforms[nodes[i]], then
+// jointMatrices[j] = globals[jointEntries[j]] * inverseBindMatrices[j].
+// localTransforms is indexed by model node, globals needs nodes.size() entries.
+// The 4x4 products use SSE when available.
+void computeJointMatrices(const Skeleton &skeleton, const glm::mat4 *localTransforms,
+                          glm::mat4 *globals, glm::mat4 *jointMatrices);
+
+#endif
@@ -0,0 +1,91 @@
+#include "StaticMeshBatch.h"
+
+#include <algorithm>
+
+StaticMeshBatch::~StaticMeshBatch() {
+    if (!vertexArrayIDs.empty()) {
+        glDeleteVertexArrays((GLsizei)vertexArrayIDs.size(), vertexArrayIDs.data());
+    }
+    glDeleteBuffers(1, &instanceBufferID);
+}
+
+void StaticMeshBatch::beginFrame(const std::shared_ptr<MeshAsset> &frameMesh) {
+    // Vertex arrays capture the mesh's buffers, so a new mesh needs new ones
+    if (frameMesh != mesh && !vertexArrayIDs.empty()) {
+        glDeleteVertexArrays((GLsizei)vertexArrayIDs.size(), vertexArrayIDs.data());
+        vertexArrayIDs.clear();
+    }
+    mesh = frameMesh;
+
+    size_t levelCount = mesh ? mesh->lods.size() : 0;
+    levels.resize(levelCount);
+    for (std::vector<glm::mat4> &level : levels) {
+        level.clear();
+    }
+}
+
+void StaticMeshBatch::add(const glm::mat4 &model, int level) {
+    if (level < 0 || level >= (int)levels.size()) {
+        return;
+    }
+    levels[level].push_back(model);
+}
+
+void StaticMeshBatch::submit(RenderQueue &queue, const DrawPacket &packet, RenderPass pass, float depth) {
+    size_t total = instanceCount();
+    if (!mesh || total == 0) {
+        return;
+    }
+
+    staging.clear();
+    for (const std::vector<glm::mat4> &level : levels) {
+        staging.insert(staging.end(), level.begin(), level.end());
+    }
+
+    // Respecifying the whole store orphans the one last frame's draws may still be reading
+    if (instanceBufferID == 0) {
+        glGenBuffers(1, &instanceBufferID);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+    capacity = std::max(capacity, (GLsizeiptr)(total * sizeof(glm::mat4)));
+    glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, total * sizeof(glm::mat4), staging.data());
+
+    size_t first = 0;
+    for (size_t level = 0; level < levels.size(); level++) {
+        GLsizei count = (GLsizei)levels[level].size();
+        if (count == 0) {
+            continue;
+        }
+
+        while (vertexArrayIDs.size() <= level) {
+            vertexArrayIDs.push_back(mesh->createVertexArray());
+        }
+        glBindVertexArray(vertexArrayIDs[level]);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+        for (GLuint column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(kInstanceModelLocation + column);
+            glVertexAttribPointer(kInstanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  (void *)((first * 4 + column) * sizeof(glm::vec4)));
+            glVertexAttribDivisor(kInstanceModelLocation + column, 1);
+        }
+
+        DrawPacket levelPacket = packet;
+        levelPacket.vertexArrayID = vertexArrayIDs[level];
+        levelPacket.indexCount = mesh->lods[level].indexCount;
+        levelPacket.indexType = mesh->indexType;
+        levelPacket.indexOffset = mesh->lodIndexOffset((int)level);
+        levelPacket.instanceCount = count;
+        queue.submit(levelPacket, pass, depth);
+        first += count;
+    }
+    glBindVertexArray(0);
+}
+
+size_t StaticMeshBatch::instanceCount() const {
+    size_t total = 0;
+    for (const std::vector<glm::mat4> &level : levels) {
+        total += level.size();
+    }
+    return total;
+}
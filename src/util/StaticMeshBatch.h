@@ -0,0 +1,50 @@
+#ifndef _STATIC_MESH_BATCH_H_
+#define _STATIC_MESH_BATCH_H_
+
+#include "AssetCache.h"
+#include "RenderQueue.h"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// First of the four locations the per-instance model matrix takes up, after
+// the mesh's own attributes
+const GLuint kInstanceModelLocation = 3;
+
+// Draws every placement of one static mesh with an instanced draw per level of
+// detail. Instances are grouped by level as they are added, the whole frame's
+// matrices go up in one orphaning upload and each level's vertex array points
+// its instance attributes at that level's run, since GL 3.3 has no base
+// instance to start a draw part way into the stream.
+class StaticMeshBatch {
+    std::shared_ptr<MeshAsset> mesh;
+    std::vector<GLuint> vertexArrayIDs;     // one per level, created as levels are first drawn
+    GLuint instanceBufferID = 0;
+    GLsizeiptr capacity = 0;
+
+    std::vector<std::vector<glm::mat4>> levels;     // this frame's instances, by level
+    std::vector<glm::mat4> staging;
+
+    public:
+        StaticMeshBatch() = default;
+        StaticMeshBatch(const StaticMeshBatch &) = delete;
+        StaticMeshBatch &operator=(const StaticMeshBatch &) = delete;
+        ~StaticMeshBatch();
+
+        // Starts a frame's instances of mesh, which may change between frames
+        void beginFrame(const std::shared_ptr<MeshAsset> &mesh);
+
+        // model is the instance's world transform, the mesh's dequantisation not included
+        void add(const glm::mat4 &model, int level);
+
+        // Uploads the instances and queues one packet per level that has any,
+        // copying everything but the vertex array, index range and instance
+        // count from packet
+        void submit(RenderQueue &queue, const DrawPacket &packet, RenderPass pass, float depth);
+
+        size_t instanceCount() const;
+};
+
+#endif
@@ -0,0 +1,574 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESSOR_SSE2
+#endif
+
+namespace {
+
+const int kSrgbTableSize = 16384;
+
+float srgbToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+struct GammaTables {
+    float toLinear[256];
+    unsigned char toSrgb[kSrgbTableSize];
+
+    GammaTables() {
+        for (int i = 0; i < 256; i++) {
+            toLinear[i] = srgbToLinear(i / 255.0f);
+        }
+        for (int i = 0; i < kSrgbTableSize; i++) {
+            toSrgb[i] = (unsigned char)(linearToSrgb(i / float(kSrgbTableSize - 1)) * 255.0f + 0.5f);
+        }
+    }
+};
+
+const GammaTables &gammaTables() {
+    static GammaTables tables;
+    return tables;
+}
+
+// Float RGBA, colour channels linear
+struct LinearImage {
+    int width = 0;
+    int height = 0;
+    std::vector<float> texels;
+};
+
+LinearImage toLinear(const Image &image) {
+    const GammaTables &tables = gammaTables();
+    LinearImage out;
+    out.width = image.width;
+    out.height = image.height;
+    out.texels.resize(image.rgba.size());
+    for (size_t i = 0; i < image.rgba.size(); i += 4) {
+        out.texels[i + 0] = tables.toLinear[image.rgba[i + 0]];
+        out.texels[i + 1] = tables.toLinear[image.rgba[i + 1]];
+        out.texels[i + 2] = tables.toLinear[image.rgba[i + 2]];
+        out.texels[i + 3] = image.rgba[i + 3] / 255.0f;
+    }
+    return out;
+}
+
+Image toSrgb(const LinearImage &image) {
+    const GammaTables &tables = gammaTables();
+    Image out;
+    out.width = image.width;
+    out.height = image.height;
+    out.rgba.resize(image.texels.size());
+    for (size_t i = 0; i < image.texels.size(); i += 4) {
+        for (int c = 0; c < 3; c++) {
+            float v = std::min(std::max(image.texels[i + c], 0.0f), 1.0f);
+            out.rgba[i + c] = tables.toSrgb[int(v * (kSrgbTableSize - 1) + 0.5f)];
+        }
+        float a = std::min(std::max(image.texels[i + 3], 0.0f), 1.0f);
+        out.rgba[i + 3] = (unsigned char)(a * 255.0f + 0.5f);
+    }
+    return out;
+}
+
+// Adds weight * src into dst, both RGBA
+inline void accumulate(float *dst, const float *src, float weight) {
+#ifdef TEXTURE_COMPRESSOR_SSE2
+    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(weight))));
+#else
+    for (int c = 0; c < 4; c++) {
+        dst[c] += src[c] * weight;
+    }
+#endif
+}
+
+LinearImage downsampleBox(const LinearImage &src) {
+    LinearImage out;
+    out.width = std::max(src.width / 2, 1);
+    out.height = std::max(src.height / 2, 1);
+    out.texels.resize(size_t(out.width) * out.height * 4);
+
+    for (int y = 0; y < out.height; y++) {
+        const float *row0 = &src.texels[size_t(std::min(y * 2, src.height - 1)) * src.width * 4];
+        const float *row1 = &src.texels[size_t(std::min(y * 2 + 1, src.height - 1)) * src.width * 4];
+        for (int x = 0; x < out.width; x++) {
+            int x0 = std::min(x * 2, src.width - 1) * 4, x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+            float *dst = &out.texels[(size_t(y) * out.width + x) * 4];
+#ifdef TEXTURE_COMPRESSOR_SSE2
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                    _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+            _mm_storeu_ps(dst, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+            for (int c = 0; c < 4; c++) {
+                dst[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+            }
+#endif
+        }
+    }
+    return out;
+}
+
+float besselI0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= (x * 0.5f / k) * (x * 0.5f / k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Taps of a 1D Kaiser windowed sinc resampler, one set per output texel
+struct FilterTaps {
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights;     // count[i] weights per output texel, back to back
+    std::vector<size_t> offset;
+};
+
+FilterTaps kaiserTaps(int inCount, int outCount) {
+    const float radius = 2.0f;      // in output texels
+    const float beta = 4.0f;
+    const float pi = 3.14159265358979f;
+
+    FilterTaps taps;
+    float scale = float(inCount) / float(outCount);
+    for (int o = 0; o < outCount; o++) {
+        float center = (o + 0.5f) * scale;
+        int first = int(std::floor(center - radius * scale));
+        int last = int(std::ceil(center + radius * scale));
+
+        taps.first.push_back(first);
+        taps.count.push_back(last - first + 1);
+        taps.offset.push_back(taps.weights.size());
+
+        float sum = 0.0f;
+        for (int i = first; i <= last; i++) {
+            float d = (i + 0.5f - center) / scale;
+            float w = 0.0f;
+            if (std::fabs(d) < radius) {
+                float t = d / radius;
+                float sinc = d == 0.0f ? 1.0f : std::sin(pi * d) / (pi * d);
+                w = sinc * besselI0(beta * std::sqrt(1.0f - t * t)) / besselI0(beta);
+            }
+            taps.weights.push_back(w);
+            sum += w;
+        }
+        for (int i = 0; i <= last - first; i++) {
+            taps.weights[taps.offset.back() + i] /= sum;
+        }
+    }
+    return taps;
+}
+
+// Separable: rows first, then columns
+LinearImage downsampleKaiser(const LinearImage &src) {
+    int width = std::max(src.width / 2, 1), height = std::max(src.height / 2, 1);
+
+    LinearImage rows;
+    rows.width = width;
+    rows.height = src.height;
+    rows.texels.assign(size_t(width) * src.height * 4, 0.0f);
+    FilterTaps horizontal = kaiserTaps(src.width, width);
+    for (int y = 0; y < src.height; y++) {
+        const float *in = &src.texels[size_t(y) * src.width * 4];
+        for (int x = 0; x < width; x++) {
+            float *dst = &rows.texels[(size_t(y) * width + x) * 4];
+            for (int k = 0; k < horizontal.count[x]; k++) {
+                int i = std::min(std::max(horizontal.first[x] + k, 0), src.width - 1);
+                accumulate(dst, in + i * 4, horizontal.weights[horizontal.offset[x] + k]);
+            }
+        }
+    }
+
+    LinearImage out;
+    out.width = width;
+    out.height = height;
+    out.texels.assign(size_t(width) * height * 4, 0.0f);
+    FilterTaps vertical = kaiserTaps(src.height, height);
+    for (int y = 0; y < height; y++) {
+        for (int k = 0; k < vertical.count[y]; k++) {
+            int i = std::min(std::max(vertical.first[y] + k, 0), src.height - 1);
+            float w = vertical.weights[vertical.offset[y] + k];
+            const float *in = &rows.texels[size_t(i) * width * 4];
+            float *dst = &out.texels[size_t(y) * width * 4];
+            for (int x = 0; x < width; x++) {
+                accumulate(dst + x * 4, in + x * 4, w);
+            }
+        }
+    }
+    return out;
+}
+
+// BC1 colour endpoints are RGB565
+uint16_t pack565(const float rgb[3]) {
+    int r = int(std::min(std::max(rgb[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = int(std::min(std::max(rgb[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = int(std::min(std::max(rgb[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16_t c, int rgb[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Four colour palette of a block with c0 > c1
+void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// Picks the nearest palette entry per texel, returns the squared error
+int chooseColorIndices(const unsigned char texels[16][4], const int palette[4][3], uint8_t indices[16]) {
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int p = 0; p < 4; p++) {
+            int dr = texels[i][0] - palette[p][0], dg = texels[i][1] - palette[p][1], db = texels[i][2] - palette[p][2];
+            int error = dr * dr + dg * dg + db * db;
+            if (error < bestError) {
+                bestError = error;
+                best = p;
+            }
+        }
+        indices[i] = uint8_t(best);
+        total += bestError;
+    }
+    return total;
+}
+
+// Endpoints from the principal axis of the block colours, then one least
+// squares refit against the indices they produced
+void encodeColorBlock(const unsigned char texels[16][4], unsigned char *dst) {
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            mean[c] += texels[i][c] / 16.0f;
+        }
+    }
+
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        float r = texels[i][0] - mean[0], g = texels[i][1] - mean[1], b = texels[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (length < 1e-6f) {
+            break;
+        }
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+    float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    float minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = ((texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2]) / axisLength2;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    // Pull the endpoints in a little, the extremes are rarely worth a palette slot
+    float inset = (maxT - minT) / 16.0f;
+    minT += inset;
+    maxT -= inset;
+
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+        e0[c] = mean[c] + axis[c] * maxT;
+        e1[c] = mean[c] + axis[c] * minT;
+    }
+
+    uint16_t bestC0 = pack565(e0), bestC1 = pack565(e1);
+    uint8_t bestIndices[16];
+    int palette[4][3];
+    colorPalette(bestC0, bestC1, palette);
+    int bestError = chooseColorIndices(texels, palette, bestIndices);
+
+    // Least squares endpoints for the chosen indices
+    const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float aa = 0, ab = 0, bb = 0, ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        float a = weights[bestIndices[i]], b = 1.0f - a;
+        aa += a * a; ab += a * b; bb += b * b;
+        for (int c = 0; c < 3; c++) {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) > 1e-6f) {
+        for (int c = 0; c < 3; c++) {
+            e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+            e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+        }
+        uint16_t c0 = pack565(e0), c1 = pack565(e1);
+        uint8_t indices[16];
+        colorPalette(c0, c1, palette);
+        int error = chooseColorIndices(texels, palette, indices);
+        if (error < bestError) {
+            bestError = error;
+            bestC0 = c0;
+            bestC1 = c1;
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    // c0 > c1 selects four colour mode; swapping the endpoints swaps 0/1 and 2/3
+    if (bestC0 < bestC1) {
+        std::swap(bestC0, bestC1);
+        for (uint8_t &index : bestIndices) {
+            index ^= 1;
+        }
+    } else if (bestC0 == bestC1) {
+        memset(bestIndices, 0, sizeof(bestIndices));
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        bits |= uint32_t(bestIndices[i]) << (i * 2);
+    }
+    dst[0] = uint8_t(bestC0 & 0xff);
+    dst[1] = uint8_t(bestC0 >> 8);
+    dst[2] = uint8_t(bestC1 & 0xff);
+    dst[3] = uint8_t(bestC1 >> 8);
+    dst[4] = uint8_t(bits);
+    dst[5] = uint8_t(bits >> 8);
+    dst[6] = uint8_t(bits >> 16);
+    dst[7] = uint8_t(bits >> 24);
+}
+
+void alphaPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        }
+    } else {
+        for (int i = 2; i < 6; i++) {
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// BC4 block over the alpha channel, eight interpolated values between min and max
+void encodeAlphaBlock(const unsigned char texels[16][4], unsigned char *dst) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, int(texels[i][3]));
+        a1 = std::min(a1, int(texels[i][3]));
+    }
+
+    int palette[8];
+    alphaPalette(a0, a1, palette);
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int p = 0; p < 8 && a0 != a1; p++) {
+            int error = std::abs(texels[i][3] - palette[p]);
+            if (error < bestError) {
+                bestError = error;
+                best = p;
+            }
+        }
+        bits |= uint64_t(best) << (i * 3);
+    }
+
+    dst[0] = uint8_t(a0);
+    dst[1] = uint8_t(a1);
+    for (int i = 0; i < 6; i++) {
+        dst[2 + i] = uint8_t(bits >> (i * 8));
+    }
+}
+
+// Texels of one 4x4 block, edges repeated for sizes that are not multiples of 4
+void loadBlock(const Image &image, int bx, int by, unsigned char texels[16][4]) {
+    for (int y = 0; y < 4; y++) {
+        int sy = std::min(by * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sx = std::min(bx * 4 + x, image.width - 1);
+            memcpy(texels[y * 4 + x], &image.rgba[(size_t(sy) * image.width + sx) * 4], 4);
+        }
+    }
+}
+
+size_t blockBytes(TextureFormat format) {
+    return format == TextureFormat::BC1 ? 8 : 16;
+}
+
+}
+
+bool Image::hasAlpha() const {
+    for (size_t i = 3; i < rgba.size(); i += 4) {
+        if (rgba[i] != 255) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Image> buildMipChain(const Image &base, MipFilter filter) {
+    std::vector<Image> levels;
+    levels.push_back(base);
+
+    LinearImage current = toLinear(base);
+    while (current.width > 1 || current.height > 1) {
+        current = filter == MipFilter::Kaiser ? downsampleKaiser(current) : downsampleBox(current);
+        levels.push_back(toSrgb(current));
+    }
+    return levels;
+}
+
+size_t compressedSize(TextureFormat format, int width, int height) {
+    if (format == TextureFormat::RGBA8) {
+        return size_t(width) * height * 4;
+    }
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+std::vector<unsigned char> compressImage(const Image &image, TextureFormat format, unsigned threadCount) {
+    if (format == TextureFormat::RGBA8) {
+        return image.rgba;
+    }
+
+    int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    size_t bytes = blockBytes(format);
+    std::vector<unsigned char> out(size_t(blocksX) * blocksY * bytes);
+
+    auto encodeRows = [&](int firstRow, int step) {
+        unsigned char texels[16][4];
+        for (int by = firstRow; by < blocksY; by += step) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                unsigned char *dst = &out[(size_t(by) * blocksX + bx) * bytes];
+                loadBlock(image, bx, by, texels);
+                if (format == TextureFormat::BC3) {
+                    encodeAlphaBlock(texels, dst);
+                    dst += 8;
+                }
+                encodeColorBlock(texels, dst);
+            }
+        }
+    };
+
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threadCount = std::min(threadCount, unsigned(blocksY));
+    if (threadCount <= 1) {
+        encodeRows(0, 1);
+        return out;
+    }
+
+    // Block rows are interleaved between threads so they all finish together
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; t++) {
+        threads.emplace_back(encodeRows, int(t), int(threadCount));
+    }
+    encodeRows(0, int(threadCount));
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return out;
+}
+
+Image decompressImage(const unsigned char *data, int width, int height, TextureFormat format) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    if (format == TextureFormat::RGBA8) {
+        image.rgba.assign(data, data + size_t(width) * height * 4);
+        return image;
+    }
+
+    image.rgba.resize(size_t(width) * height * 4);
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t bytes = blockBytes(format);
+
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const unsigned char *block = data + (size_t(by) * blocksX + bx) * bytes;
+
+            int alphas[16];
+            if (format == TextureFormat::BC3) {
+                int palette[8];
+                alphaPalette(block[0], block[1], palette);
+                uint64_t bits = 0;
+                for (int i = 0; i < 6; i++) {
+                    bits |= uint64_t(block[2 + i]) << (i * 8);
+                }
+                for (int i = 0; i < 16; i++) {
+                    alphas[i] = palette[(bits >> (i * 3)) & 7];
+                }
+                block += 8;
+            } else {
+                std::fill(alphas, alphas + 16, 255);
+            }
+
+            uint16_t c0 = uint16_t(block[0] | (block[1] << 8)), c1 = uint16_t(block[2] | (block[3] << 8));
+            int palette[4][3];
+            colorPalette(c0, c1, palette);
+            if (c0 <= c1 && format == TextureFormat::BC1) {
+                for (int c = 0; c < 3; c++) {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+            uint32_t bits = uint32_t(block[4]) | (uint32_t(block[5]) << 8) | (uint32_t(block[6]) << 16) | (uint32_t(block[7]) << 24);
+
+            for (int i = 0; i < 16; i++) {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x >= width || y >= height) {
+                    continue;
+                }
+                unsigned char *dst = &image.rgba[(size_t(y) * width + x) * 4];
+                int index = (bits >> (i * 2)) & 3;
+                dst[0] = uint8_t(palette[index][0]);
+                dst[1] = uint8_t(palette[index][1]);
+                dst[2] = uint8_t(palette[index][2]);
+                dst[3] = uint8_t(alphas[i]);
+            }
+        }
+    }
+    return image;
+}
+
+float measurePsnr(const Image &reference, const Image &image) {
+    if (reference.rgba.size() != image.rgba.size() || reference.rgba.empty()) {
+        return 0.0f;
+    }
+
+    double squared = 0.0;
+    for (size_t i = 0; i < reference.rgba.size(); i += 4) {
+        for (int c = 0; c < 3; c++) {
+            double d = double(reference.rgba[i + c]) - double(image.rgba[i + c]);
+            squared += d * d;
+        }
+    }
+    double mse = squared / (reference.rgba.size() / 4 * 3);
+    return mse == 0.0 ? 99.0f : float(10.0 * std::log10(255.0 * 255.0 / mse));
+}
@@ -0,0 +1,42 @@
+#ifndef _TEXTURE_COMPRESSOR_H_
+#define _TEXTURE_COMPRESSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1,        // 4 bits per texel, opaque RGB (GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+    BC3 = 2,        // 8 bits per texel, BC1 colour plus BC4 alpha (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+};
+
+enum class MipFilter {
+    Box,            // 2x2 average
+    Kaiser,         // Kaiser windowed sinc, sharper distant detail with less aliasing
+};
+
+// 8-bit RGBA, colour channels sRGB encoded
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgba;
+
+    bool hasAlpha() const;
+};
+
+// Every level down to 1x1, base level first. Colour is filtered in linear
+// space so dark and bright texels keep their balance as the image shrinks.
+std::vector<Image> buildMipChain(const Image &base, MipFilter filter);
+
+size_t compressedSize(TextureFormat format, int width, int height);
+
+// Block compresses image, threadCount 0 uses every core
+std::vector<unsigned char> compressImage(const Image &image, TextureFormat format, unsigned threadCount = 0);
+
+Image decompressImage(const unsigned char *data, int width, int height, TextureFormat format);
+
+// Peak signal to noise ratio over the colour channels, in dB
+float measurePsnr(const Image &reference, const Image &image);
+
+#endif
@@ -0,0 +1,80 @@
+#include "UniformBlocks.h"
+
+#include <algorithm>
+#include <cstring>
+
+void bindUniformBlocks(GLuint programID) {
+    GLuint frameBlock = glGetUniformBlockIndex(programID, "Frame");
+    if (frameBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(programID, frameBlock, kFrameBinding);
+    }
+    GLuint objectBlock = glGetUniformBlockIndex(programID, "Object");
+    if (objectBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(programID, objectBlock, kObjectBinding);
+    }
+}
+
+UniformStream &UniformStream::instance() {
+    static UniformStream stream;
+    return stream;
+}
+
+void UniformStream::beginFrame() {
+    uploadedBytesLastFrame = uploadedBytes;
+    uploadedBytes = 0;
+    ranges.clear();
+    stagedEnd = 0;
+    boundEnd = 0;
+}
+
+GLintptr UniformStream::stage(const void *data, GLsizeiptr size, GLsizeiptr rangeSize) {
+    if (alignment == 0) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        alignment = std::max(alignment, 1);
+    }
+
+    // The next range may start inside this one's block past its data; the
+    // shader never reads that far, the store only has to reach it
+    GLintptr offset = (stagedEnd + alignment - 1) / alignment * alignment;
+    stagedEnd = offset + size;
+    boundEnd = std::max(boundEnd, offset + std::max(rangeSize, size));
+    if ((GLsizeiptr)staging.size() < stagedEnd) {
+        staging.resize(stagedEnd);
+    }
+    std::memcpy(staging.data() + offset, data, size);
+
+    if (!ranges.empty() && ranges.back().offset + ranges.back().size == offset) {
+        ranges.back().size += size;
+    } else {
+        ranges.push_back({offset, size});
+    }
+    return offset;
+}
+
+void UniformStream::upload() {
+    if (ranges.empty()) {
+        return;
+    }
+    if (buffer == 0) {
+        glGenBuffers(1, &buffer);
+    }
+
+    // Respecifying the whole store orphans the one draws may still be reading
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    capacity = std::max(capacity, boundEnd);
+    glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    for (const Range &range : ranges) {
+        glBufferSubData(GL_UNIFORM_BUFFER, range.offset, range.size, staging.data() + range.offset);
+        uploadedBytes += range.size;
+    }
+}
+
+void UniformStream::bindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr rangeSize) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, buffer, offset, rangeSize);
+}
+
+void UniformStream::cleanup() {
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    capacity = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef _UNIFORM_BLOCKS_H_
+#define _UNIFORM_BLOCKS_H_
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Binding points of the std140 blocks the shaders share. Every program gets
+// Frame and Object pointed at theirs when it is linked, see bindUniformBlocks.
+const GLuint kJointPaletteBinding = 0;
+const GLuint kFrameBinding = 1;
+const GLuint kObjectBinding = 2;
+
+// The Frame block, the same for every draw of the frame
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;       // w is the animation time in seconds
+    glm::vec4 lightPosition;
+    glm::vec4 lightIntensity;
+};
+
+// The Object block, one per object drawn
+struct ObjectUniforms {
+    glm::mat4 model;                // dequantisation of the positions included
+    glm::vec4 params = glm::vec4(0.0f);     // x: octahedral normals, y: joint scale
+};
+
+// Points the program's Frame and Object blocks, if it has them, at kFrameBinding
+// and kObjectBinding
+void bindUniformBlocks(GLuint programID);
+
+// One uniform buffer streamed by every draw of the frame: the Frame block,
+// each object's Object block and the joint palettes are staged one after
+// another at the driver's offset alignment as objects are queued, the frame's
+// data goes up after one orphaning of the store before the queue is drawn,
+// and each draw binds its own ranges. Only the staged bytes are sent, not the
+// alignment padding or the unused tail of a shader block.
+class UniformStream {
+    struct Range {
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    GLuint buffer = 0;
+    GLsizeiptr capacity = 0;
+    GLint alignment = 0;
+    std::vector<unsigned char> staging;
+    std::vector<Range> ranges;      // staged this frame, ranges that touch merged
+    GLsizeiptr stagedEnd = 0;       // end of the data staged last
+    GLsizeiptr boundEnd = 0;        // end of the furthest shader block bound over it
+
+    unsigned long uploadedBytes = 0;
+    unsigned long uploadedBytesLastFrame = 0;
+
+    public:
+        static UniformStream &instance();
+
+        void beginFrame();
+
+        // Copies size bytes to the frame's staging area and returns where they
+        // start; rangeSize is the shader block's size, which may be more than
+        // the data actually staged
+        GLintptr stage(const void *data, GLsizeiptr size, GLsizeiptr rangeSize);
+
+        // Uploads everything staged this frame, before the first bindRange
+        void upload();
+
+        void bindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr rangeSize);
+
+        // Counts data set as plain uniforms instead, so frames compare
+        void countUniformUpload(GLsizeiptr size) { uploadedBytes += size; }
+
+        // Uniform bytes sent to the GPU during the previous frame
+        unsigned long bytesLastFrame() const { return uploadedBytesLastFrame; }
+
+        void cleanup();
+};
+
+// The Frame block is staged before the objects and bound once after the upload
+inline GLintptr stageFrameUniforms(const FrameUniforms &frame) {
+    return UniformStream::instance().stage(&frame, sizeof(frame), sizeof(frame));
+}
+
+inline void bindFrameUniforms(GLintptr offset) {
+    UniformStream::instance().bindRange(kFrameBinding, offset, sizeof(FrameUniforms));
+}
+
+// Staged by submit, bound by the object's setupDraw
+inline GLintptr stageObjectUniforms(const ObjectUniforms &object) {
+    return UniformStream::instance().stage(&object, sizeof(object), sizeof(object));
+}
+
+inline void bindObjectUniforms(GLintptr offset) {
+    UniformStream::instance().bindRange(kObjectBinding, offset, sizeof(ObjectUniforms));
+}
+
+#endif
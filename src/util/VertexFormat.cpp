@@ -0,0 +1,227 @@
+#include "VertexFormat.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+size_t positionSize(PositionEncoding e) {
+    return e == PositionEncoding::Float ? 12 : 8;
+}
+
+size_t uvSize(UvEncoding e) {
+    return e == UvEncoding::Float ? 8 : 4;
+}
+
+size_t normalSize(NormalEncoding e) {
+    switch (e) {
+        case NormalEncoding::None:  return 0;
+        case NormalEncoding::Float: return 12;
+        default:                    return 4;
+    }
+}
+
+glm::vec2 signNotZero(glm::vec2 v) {
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+}
+
+glm::vec2 encodeOctahedral(glm::vec3 n) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec2 e = glm::vec2(n.x, n.y) / l1;
+    if (n.z < 0.0f) {
+        e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+    }
+    return e;
+}
+
+glm::vec3 decodeOctahedral(glm::vec2 e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+PackedVertices packVertices(const std::vector<MeshVertex> &vertices, VertexLayout layout) {
+    PackedVertices packed;
+
+    glm::vec3 minPosition(0.0f), maxPosition(0.0f);
+    glm::vec2 minUv(0.0f), maxUv(0.0f);
+    if (!vertices.empty()) {
+        minPosition = maxPosition = vertices[0].position;
+        minUv = maxUv = vertices[0].uv;
+    }
+    for (const MeshVertex &v : vertices) {
+        minPosition = glm::min(minPosition, v.position);
+        maxPosition = glm::max(maxPosition, v.position);
+        minUv = glm::min(minUv, v.uv);
+        maxUv = glm::max(maxUv, v.uv);
+    }
+
+    // Unorm16 cannot represent tiled uvs
+    if (layout.uv == UvEncoding::Unorm16 && (minUv.x < 0.0f || minUv.y < 0.0f || maxUv.x > 1.0f || maxUv.y > 1.0f)) {
+        std::cout << "UVs outside [0, 1], storing them as half floats" << std::endl;
+        layout.uv = UvEncoding::Half;
+    }
+
+    packed.layout = layout;
+    packed.uvOffset = positionSize(layout.position);
+    packed.normalOffset = packed.uvOffset + uvSize(layout.uv);
+    packed.stride = packed.normalOffset + normalSize(layout.normal);
+    packed.data.resize(vertices.size() * packed.stride);
+
+    glm::vec3 extent = maxPosition - minPosition;
+    for (int k = 0; k < 3; k++) {
+        if (extent[k] <= 0.0f) {
+            extent[k] = 1.0f;
+        }
+    }
+    if (layout.position == PositionEncoding::Unorm16) {
+        packed.dequantize = glm::scale(glm::translate(glm::mat4(1.0f), minPosition), extent);
+    }
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const MeshVertex &v = vertices[i];
+        unsigned char *dst = &packed.data[i * packed.stride];
+
+        if (layout.position == PositionEncoding::Float) {
+            memcpy(dst, &v.position, 12);
+        } else {
+            glm::uint64 p = glm::packUnorm4x16(glm::vec4((v.position - minPosition) / extent, 0.0f));
+            memcpy(dst, &p, 8);
+        }
+
+        unsigned char *uv = dst + packed.uvOffset;
+        if (layout.uv == UvEncoding::Float) {
+            memcpy(uv, &v.uv, 8);
+        } else if (layout.uv == UvEncoding::Half) {
+            glm::uint p = glm::packHalf2x16(v.uv);
+            memcpy(uv, &p, 4);
+        } else {
+            glm::uint p = glm::packUnorm2x16(v.uv);
+            memcpy(uv, &p, 4);
+        }
+
+        unsigned char *normal = dst + packed.normalOffset;
+        if (layout.normal == NormalEncoding::Float) {
+            memcpy(normal, &v.normal, 12);
+        } else if (layout.normal == NormalEncoding::Int2101010) {
+            glm::uint p = glm::packSnorm3x10_1x2(glm::vec4(v.normal, 0.0f));
+            memcpy(normal, &p, 4);
+        } else if (layout.normal == NormalEncoding::Octahedral) {
+            glm::uint p = glm::packSnorm2x16(encodeOctahedral(v.normal));
+            memcpy(normal, &p, 4);
+        }
+    }
+
+    return packed;
+}
+
+MeshVertex decodeVertex(const PackedVertices &packed, size_t index) {
+    const VertexLayout &layout = packed.layout;
+    const unsigned char *src = &packed.data[index * packed.stride];
+    MeshVertex v;
+
+    if (layout.position == PositionEncoding::Float) {
+        memcpy(&v.position, src, 12);
+    } else {
+        glm::uint64 p;
+        memcpy(&p, src, 8);
+        v.position = glm::vec3(packed.dequantize * glm::vec4(glm::vec3(glm::unpackUnorm4x16(p)), 1.0f));
+    }
+
+    glm::uint p32;
+    memcpy(&p32, src + packed.uvOffset, 4);
+    if (layout.uv == UvEncoding::Float) {
+        memcpy(&v.uv, src + packed.uvOffset, 8);
+    } else if (layout.uv == UvEncoding::Half) {
+        v.uv = glm::unpackHalf2x16(p32);
+    } else {
+        v.uv = glm::unpackUnorm2x16(p32);
+    }
+
+    if (layout.normal == NormalEncoding::None) {
+        return v;
+    }
+    memcpy(&p32, src + packed.normalOffset, 4);
+    if (layout.normal == NormalEncoding::Float) {
+        memcpy(&v.normal, src + packed.normalOffset, 12);
+    } else if (layout.normal == NormalEncoding::Int2101010) {
+        v.normal = glm::vec3(glm::unpackSnorm3x10_1x2(p32));
+    } else {
+        v.normal = decodeOctahedral(glm::unpackSnorm2x16(p32));
+    }
+    return v;
+}
+
+QuantizationError measureQuantizationError(const std::vector<MeshVertex> &vertices, const PackedVertices &packed) {
+    QuantizationError error;
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const MeshVertex &v = vertices[i];
+        MeshVertex decoded = decodeVertex(packed, i);
+
+        error.position = std::max(error.position, glm::length(decoded.position - v.position));
+        error.uv = std::max(error.uv, glm::length(decoded.uv - v.uv));
+
+        if (packed.layout.normal == NormalEncoding::None || glm::length(v.normal) == 0.0f) {
+            continue;
+        }
+        float cosAngle = glm::clamp(glm::dot(glm::normalize(decoded.normal), glm::normalize(v.normal)), -1.0f, 1.0f);
+        error.normalDegrees = std::max(error.normalDegrees, glm::degrees(std::acos(cosAngle)));
+    }
+
+    return error;
+}
+
+void setVertexAttributes(const PackedVertices &packed) {
+    const VertexLayout &layout = packed.layout;
+    GLsizei stride = (GLsizei)packed.stride;
+
+    glEnableVertexAttribArray(kPositionLocation);
+    if (layout.position == PositionEncoding::Float) {
+        glVertexAttribPointer(kPositionLocation, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+    } else {
+        glVertexAttribPointer(kPositionLocation, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void *)0);
+    }
+
+    glEnableVertexAttribArray(kUvLocation);
+    void *uvOffset = (void *)(uintptr_t)packed.uvOffset;
+    if (layout.uv == UvEncoding::Float) {
+        glVertexAttribPointer(kUvLocation, 2, GL_FLOAT, GL_FALSE, stride, uvOffset);
+    } else if (layout.uv == UvEncoding::Half) {
+        glVertexAttribPointer(kUvLocation, 2, GL_HALF_FLOAT, GL_FALSE, stride, uvOffset);
+    } else {
+        glVertexAttribPointer(kUvLocation, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, uvOffset);
+    }
+
+    if (layout.normal == NormalEncoding::None) {
+        return;
+    }
+    glEnableVertexAttribArray(kNormalLocation);
+    void *normalOffset = (void *)(uintptr_t)packed.normalOffset;
+    if (layout.normal == NormalEncoding::Float) {
+        glVertexAttribPointer(kNormalLocation, 3, GL_FLOAT, GL_FALSE, stride, normalOffset);
+    } else if (layout.normal == NormalEncoding::Int2101010) {
+        glVertexAttribPointer(kNormalLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, normalOffset);
+    } else {
+        glVertexAttribPointer(kNormalLocation, 2, GL_SHORT, GL_TRUE, stride, normalOffset);
+    }
+}
+
+void printVertexFormat(const char *label, const PackedVertices &packed, const QuantizationError &error) {
+    size_t floatStride = 12 + 8 + (packed.layout.normal == NormalEncoding::None ? 0 : 12);
+    std::cout << label << ": " << packed.stride << " bytes per vertex (was " << floatStride
+              << "), max error position " << error.position << ", uv " << error.uv
+              << ", normal " << error.normalDegrees << " deg" << std::endl;
+}
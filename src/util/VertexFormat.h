@@ -0,0 +1,75 @@
+#ifndef _VERTEX_FORMAT_H_
+#define _VERTEX_FORMAT_H_
+
+#include "MeshBuilder.h"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+enum class PositionEncoding {
+    Float,          // 12 bytes
+    Unorm16,        // 8 bytes, bounding box mapped to [0, 1] and restored by the dequantize matrix
+};
+
+enum class UvEncoding {
+    Float,          // 8 bytes
+    Half,           // 4 bytes, any range
+    Unorm16,        // 4 bytes, only for uvs inside [0, 1]
+};
+
+enum class NormalEncoding {
+    None,
+    Float,          // 12 bytes
+    Int2101010,     // 4 bytes, GL_INT_2_10_10_10_REV
+    Octahedral,     // 4 bytes, two snorm16, decoded in the vertex shader
+};
+
+struct VertexLayout {
+    PositionEncoding position = PositionEncoding::Float;
+    UvEncoding uv = UvEncoding::Float;
+    NormalEncoding normal = NormalEncoding::Float;
+};
+
+// Attribute locations used by the static mesh shaders
+const GLuint kPositionLocation = 0;
+const GLuint kUvLocation = 1;
+const GLuint kNormalLocation = 2;
+
+// Interleaved vertex data ready for one glBufferData call
+struct PackedVertices {
+    VertexLayout layout;
+    std::vector<unsigned char> data;
+    size_t stride = 0;
+    size_t uvOffset = 0;
+    size_t normalOffset = 0;
+
+    // Maps decoded positions back to model space, identity unless positions are quantised
+    glm::mat4 dequantize = glm::mat4(1.0f);
+};
+
+// Largest error introduced by packing, measured by decoding every vertex again
+struct QuantizationError {
+    float position = 0.0f;          // model space units
+    float uv = 0.0f;
+    float normalDegrees = 0.0f;
+};
+
+glm::vec2 encodeOctahedral(glm::vec3 n);
+glm::vec3 decodeOctahedral(glm::vec2 e);
+
+PackedVertices packVertices(const std::vector<MeshVertex> &vertices, VertexLayout layout);
+
+// Vertex index of packed read back the way the shaders do; normals are left
+// unnormalised, as the shaders normalise them
+MeshVertex decodeVertex(const PackedVertices &packed, size_t index);
+
+QuantizationError measureQuantizationError(const std::vector<MeshVertex> &vertices, const PackedVertices &packed);
+
+// Points the attribute arrays of the currently bound VAO at the bound GL_ARRAY_BUFFER
+void setVertexAttributes(const PackedVertices &packed);
+
+void printVertexFormat(const char *label, const PackedVertices &packed, const QuantizationError &error);
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef _SYNTHETIC_CITY_H_
+#define _SYNTHETIC_CITY_H_
+
+#include "TestCommon.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Geometry for the occlusion tests and benchmarks, made up rather than loaded
+// so they need no assets or GL
+struct SyntheticMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// A closed house two units wide and deep: walls from y = 0 to 1 and a gable
+// roof up to a ridge at y = 1.5 running along x
+inline SyntheticMesh gabledHouse() {
+    SyntheticMesh mesh;
+    for (int corner = 0; corner < 8; corner++) {
+        mesh.positions.push_back(glm::vec3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : 0.0f, corner & 4 ? 1.0f : -1.0f));
+    }
+    mesh.positions.push_back(glm::vec3(-1.0f, 1.5f, 0.0f));
+    mesh.positions.push_back(glm::vec3(1.0f, 1.5f, 0.0f));
+
+    // Front and back walls, the gable ends as a wall and a triangle each,
+    // both roof slopes and the floor last
+    const uint32_t quads[][4] = {{4, 5, 7, 6}, {0, 2, 3, 1}, {1, 3, 7, 5}, {0, 4, 6, 2}, {6, 7, 9, 8}, {2, 8, 9, 3}, {0, 1, 5, 4}};
+    const uint32_t gables[][3] = {{3, 9, 7}, {2, 6, 8}};
+    for (const uint32_t *quad : quads) {
+        mesh.indices.insert(mesh.indices.end(), {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]});
+    }
+    for (const uint32_t *gable : gables) {
+        mesh.indices.insert(mesh.indices.end(), {gable[0], gable[1], gable[2]});
+    }
+    return mesh;
+}
+
+// Whether a model space point of gabledHouse lies inside it
+inline bool insideGabledHouse(glm::vec3 point, float tolerance = 1e-4f) {
+    return std::abs(point.x) <= 1.0f + tolerance && std::abs(point.z) <= 1.0f + tolerance && point.y >= -tolerance &&
+           point.y + 0.5f * std::abs(point.z) <= 1.5f + tolerance;
+}
+
+// Terrain over x in [-200, 200] and z in [-200, 0] as a grid of quads: gentle
+// bumps with a ridge along x at z = -100
+inline float syntheticTerrainHeight(float x, float z) {
+    return 20.0f * std::exp(-(z + 100.0f) * (z + 100.0f) / 900.0f) + 2.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+}
+
+const int kTerrainQuads = 64;
+
+inline SyntheticMesh syntheticTerrain() {
+    SyntheticMesh mesh;
+    for (int z = 0; z <= kTerrainQuads; z++) {
+        for (int x = 0; x <= kTerrainQuads; x++) {
+            float worldX = -200.0f + 400.0f * x / kTerrainQuads;
+            float worldZ = -200.0f + 200.0f * z / kTerrainQuads;
+            mesh.positions.push_back(glm::vec3(worldX, syntheticTerrainHeight(worldX, worldZ), worldZ));
+        }
+    }
+    for (int z = 0; z < kTerrainQuads; z++) {
+        for (int x = 0; x < kTerrainQuads; x++) {
+            uint32_t corner = uint32_t(z * (kTerrainQuads + 1) + x);
+            uint32_t below = corner + kTerrainQuads + 1;
+            mesh.indices.insert(mesh.indices.end(), {corner, below, corner + 1, corner + 1, below, below + 1});
+        }
+    }
+    return mesh;
+}
+
+// Height of syntheticTerrain's triangles, rather than the smooth function
+inline float syntheticTerrainSurface(float x, float z) {
+    float gridX = (x + 200.0f) / 400.0f * kTerrainQuads;
+    float gridZ = (z + 200.0f) / 200.0f * kTerrainQuads;
+    int cellX = std::min(std::max((int)std::floor(gridX), 0), kTerrainQuads - 1);
+    int cellZ = std::min(std::max((int)std::floor(gridZ), 0), kTerrainQuads - 1);
+    float u = gridX - cellX, v = gridZ - cellZ;
+    auto height = [](int gx, int gz) {
+        return syntheticTerrainHeight(-200.0f + 400.0f * gx / kTerrainQuads, -200.0f + 200.0f * gz / kTerrainQuads);
+    };
+    // Split along the diagonal from (x + 1, z) to (x, z + 1), as the indices are
+    float h00 = height(cellX, cellZ), h10 = height(cellX + 1, cellZ), h01 = height(cellX, cellZ + 1), h11 = height(cellX + 1, cellZ + 1);
+    if (u + v <= 1.0f) {
+        return h00 + (h10 - h00) * u + (h01 - h00) * v;
+    }
+    return h11 + (h01 - h11) * (1.0f - u) + (h10 - h11) * (1.0f - v);
+}
+
+// Houses on a grid of blocks, each gabledHouse scaled to its own footprint
+// and height, with the block at the origin left empty as a square to stand in
+struct SyntheticBuilding {
+    glm::mat4 model;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+inline std::vector<SyntheticBuilding> syntheticCity(int blocks, float spacing, unsigned seed = 1) {
+    TestRandom random(seed);
+    std::vector<SyntheticBuilding> city;
+    for (int row = 0; row < blocks; row++) {
+        for (int column = 0; column < blocks; column++) {
+            glm::vec3 center((column - blocks / 2) * spacing, 0.0f, (row - blocks / 2) * spacing);
+            glm::vec3 half(random.uniform(0.25f, 0.4f) * spacing, random.uniform(6.0f, 25.0f), random.uniform(0.25f, 0.4f) * spacing);
+            if (std::abs(center.x) < spacing * 0.5f && std::abs(center.z) < spacing * 0.5f) {
+                continue;
+            }
+            SyntheticBuilding building;
+            building.model = glm::scale(glm::translate(glm::mat4(1.0f), center), half);
+            building.boundsMin = center - glm::vec3(half.x, 0.0f, half.z);
+            building.boundsMax = center + glm::vec3(half.x, 1.5f * half.y, half.z);
+            city.push_back(building);
+        }
+    }
+    return city;
+}
+
+#endif
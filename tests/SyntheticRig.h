@@ -0,0 +1,70 @@
+#ifndef _SYNTHETIC_RIG_H_
+#define _SYNTHETIC_RIG_H_
+
+#include "util/AnimationClip.h"
+#include "util/Skeleton.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// A rig without a model behind it, so the skinning tests and benchmarks need
+// no glTF or GL: a spine of six nodes with limbs branching off it. Node i is
+// skeleton entry i and skin joint i, so pose arrays index both alike.
+inline Skeleton syntheticSkeleton(int nodeCount = 64) {
+    Skeleton skeleton;
+    for (int i = 0; i < nodeCount; i++) {
+        skeleton.nodes.push_back(i);
+        // Every fourth node past the spine starts a new limb on a spine node
+        skeleton.parents.push_back(i == 0 ? -1 : i < 6 || i % 4 != 2 ? i - 1 : (i * 7) % 6);
+        skeleton.jointEntries.push_back(i);
+    }
+
+    // Bind pose: each bone one unit along its parent's y axis
+    std::vector<glm::mat4> bind(nodeCount);
+    for (int i = 0; i < nodeCount; i++) {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, i == 0 ? 0.0f : 1.0f, 0.0f));
+        bind[i] = skeleton.parents[i] < 0 ? local : bind[skeleton.parents[i]] * local;
+        skeleton.inverseBindMatrices.push_back(glm::inverse(bind[i]));
+    }
+    return skeleton;
+}
+
+// Swings every node of syntheticSkeleton at its own rate, sampled at
+// keysPerSecond: linear rotation tracks on all nodes, a moving root, constant
+// bone offsets and identity scales, the mix an exported clip would hold
+inline AnimationClip syntheticClip(int nodeCount = 64, float duration = 2.0f, float keysPerSecond = 30.0f) {
+    AnimationClip clip;
+    size_t keyCount = size_t(duration * keysPerSecond) + 1;
+    std::vector<float> times(keyCount);
+    for (size_t k = 0; k < keyCount; k++) {
+        times[k] = duration * float(k) / float(keyCount - 1);
+    }
+
+    std::vector<glm::vec4> values(keyCount);
+    for (int i = 0; i < nodeCount; i++) {
+        glm::vec3 axis = glm::normalize(glm::vec3(std::sin(i * 1.3f), 1.0f, std::cos(i * 0.7f)));
+        for (size_t k = 0; k < keyCount; k++) {
+            float angle = 0.6f * std::sin(times[k] * (2.0f + 0.1f * i) + i);
+            glm::quat rotation = glm::angleAxis(angle, axis);
+            values[k] = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+        }
+        clip.addTrack(i, AnimationPath::Rotation, Interpolation::Linear, times.data(), keyCount, values.data(), 1);
+
+        for (size_t k = 0; k < keyCount; k++) {
+            values[k] = i == 0 ? glm::vec4(times[k], 0.2f * std::sin(times[k] * 6.0f), 0.0f, 0.0f)
+                               : glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+        }
+        clip.addTrack(i, AnimationPath::Translation, Interpolation::Linear, times.data(), keyCount, values.data(), 1);
+
+        std::fill(values.begin(), values.end(), glm::vec4(1.0f, 1.0f, 1.0f, 0.0f));
+        clip.addTrack(i, AnimationPath::Scale, Interpolation::Linear, times.data(), keyCount, values.data(), 1);
+    }
+    return clip;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef _TEST_COMMON_H_
+#define _TEST_COMMON_H_
+
+#include <chrono>
+#include <cstdio>
+
+// Shared by the CPU-only tests: no framework, each test is an executable that
+// returns non-zero once any CHECK has failed
+static int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (testFailures ? (std::fprintf(stderr, "%d check(s) failed\n", testFailures), 1) : 0)
+
+// Milliseconds since an arbitrary start, for the benchmarks
+inline double nowMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Cheap deterministic random numbers, so runs are comparable
+struct TestRandom {
+    unsigned state;
+
+    explicit TestRandom(unsigned seed = 1) : state(seed) {}
+
+    unsigned next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform in [lo, hi)
+    float uniform(float lo, float hi) { return lo + (hi - lo) * float(next() >> 8) / float(1 << 24); }
+};
+
+#endif
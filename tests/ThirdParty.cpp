@@ -0,0 +1,9 @@
+// Implementations of the single-header libraries, which main.cpp and
+// asset_cooker.cpp each compile into their own executable
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <obj/obj_loader.h>
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <tinygltf/tiny_gltf.h>
@@ -0,0 +1,101 @@
+// Per-robot animation update cost, sampling a clip and computing the joint
+// matrices for 500 robots at their own phase, with the clip as exported and
+// compressed. Global operator new counts calls, so once warmed up a frame is
+// checked to allocate nothing.
+
+#include "TestCommon.h"
+#include "SyntheticRig.h"
+
+#include "util/AnimationClip.h"
+#include "util/AnimationCompression.h"
+#include "util/Skeleton.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static unsigned long allocations = 0;
+
+void *operator new(std::size_t size) {
+    allocations++;
+    if (void *memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+// What each robot keeps from frame to frame
+struct RobotState {
+    std::vector<uint32_t> cursors;
+    AnimationPose pose;
+    std::vector<glm::mat4> globals;
+    std::vector<glm::mat4> joints;
+    float phase;
+};
+
+void updateRobots(const Skeleton &skeleton, const AnimationClip &clip, std::vector<RobotState> &robots, float time) {
+    for (RobotState &robot : robots) {
+        sampleAnimationClip(clip, time + robot.phase, robot.cursors.data(), robot.pose);
+        computeJointMatrices(skeleton, robot.pose.localTransforms.data(), robot.globals.data(), robot.joints.data());
+    }
+}
+
+}
+
+int main() {
+    Skeleton skeleton = syntheticSkeleton();
+    AnimationClip exported = syntheticClip();
+    AnimationClip compressed = compressAnimationClip(exported, AnimationCompressionSettings());
+
+    const size_t robotCount = 500;
+    const int warmupFrames = 10;
+    const int frames = 200;
+    const float frameTime = 1.0f / 60.0f;
+
+    for (const AnimationClip *clip : {&exported, &compressed}) {
+        TestRandom random(11);
+        std::vector<RobotState> robots(robotCount);
+        for (RobotState &robot : robots) {
+            robot.cursors.assign(clip->tracks.size(), 0);
+            robot.pose.resize(skeleton.nodes.size());
+            robot.globals.resize(skeleton.nodes.size());
+            robot.joints.resize(skeleton.jointCount());
+            robot.phase = random.uniform(0.0f, clip->duration);
+        }
+
+        // Past the wrap once, so every cursor has been reset at least once
+        float time = 0.0f;
+        for (int frame = 0; frame < warmupFrames; frame++, time += clip->duration * 0.15f) {
+            updateRobots(skeleton, *clip, robots, time);
+        }
+
+        // Setting the robots up allocated, so the counting operator new is the one in use
+        unsigned long allocationsBefore = allocations;
+        CHECK(allocationsBefore > 0);
+        double start = nowMs();
+        for (int frame = 0; frame < frames; frame++, time += frameTime) {
+            updateRobots(skeleton, *clip, robots, time);
+        }
+        double elapsedMs = nowMs() - start;
+        unsigned long steadyAllocations = allocations - allocationsBefore;
+        CHECK(steadyAllocations == 0);
+
+        std::printf("%s clip, %zu robots of %zu joints: %.2f us per robot, %lu allocations in %d frames\n",
+                    clip == &exported ? "exported" : "compressed", robotCount, skeleton.jointCount(),
+                    elapsedMs * 1e3 / (double(frames) * robotCount), steadyAllocations, frames);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,51 @@
+// Frustum culling a million spheres: the batched Frustum::cullSpheres against
+// a loop of intersectsSphere calls over the same arrays, best of several runs
+
+#include "TestCommon.h"
+
+#include "util/Frustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+int main() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(100.0f, 40.0f, 30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum;
+    frustum.extract(projection * view);
+
+    TestRandom random(3);
+    SphereSoA spheres;
+    const size_t count = 1000000;
+    for (size_t i = 0; i < count; i++) {
+        spheres.add(glm::vec3(random.uniform(-2500.0f, 2500.0f), random.uniform(-250.0f, 250.0f),
+                              random.uniform(-2500.0f, 2500.0f)), random.uniform(0.5f, 30.0f));
+    }
+
+    std::vector<uint8_t> visible(count);
+    const int runs = 20;
+    double batchedMs = 1e30, scalarMs = 1e30;
+    size_t batchedCount = 0, scalarCount = 0;
+    for (int run = 0; run < runs; run++) {
+        double start = nowMs();
+        batchedCount = frustum.cullSpheres(spheres, visible.data());
+        batchedMs = std::min(batchedMs, nowMs() - start);
+
+        start = nowMs();
+        scalarCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            bool inside = frustum.intersectsSphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+            visible[i] = inside ? 1 : 0;
+            scalarCount += visible[i];
+        }
+        scalarMs = std::min(scalarMs, nowMs() - start);
+    }
+    CHECK(batchedCount == scalarCount);
+
+    std::printf("%zu spheres, %zu visible: cullSpheres %.2f ms, intersectsSphere %.2f ms (%.2fx)\n", count,
+                batchedCount, batchedMs, scalarMs, scalarMs / batchedMs);
+    return TEST_RESULT();
+}
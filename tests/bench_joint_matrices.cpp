@@ -0,0 +1,100 @@
+// Joint matrix throughput for 1, 100 and 10000 skeletons: the flattened
+// forward pass of computeJointMatrices against the recursive walk over the
+// node hierarchy it replaced, after checking the two agree
+
+#include "TestCommon.h"
+#include "SyntheticRig.h"
+
+#include "util/AnimationClip.h"
+#include "util/Skeleton.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct RecursiveRig {
+    std::vector<std::vector<int>> children;
+};
+
+void propagate(const RecursiveRig &rig, const glm::mat4 *localTransforms, int node, const glm::mat4 &parent,
+               std::vector<glm::mat4> &globals) {
+    globals[node] = parent * localTransforms[node];
+    for (int child : rig.children[node]) {
+        propagate(rig, localTransforms, child, globals[node], globals);
+    }
+}
+
+// The old per-frame path: a global per node allocated each call, then one
+// product per joint
+void recursiveJointMatrices(const Skeleton &skeleton, const RecursiveRig &rig, const glm::mat4 *localTransforms,
+                            glm::mat4 *jointMatrices) {
+    std::vector<glm::mat4> globals(skeleton.nodes.size());
+    propagate(rig, localTransforms, 0, glm::mat4(1.0f), globals);
+    for (size_t j = 0; j < skeleton.jointCount(); j++) {
+        jointMatrices[j] = globals[skeleton.jointEntries[j]] * skeleton.inverseBindMatrices[j];
+    }
+}
+
+}
+
+int main() {
+    Skeleton skeleton = syntheticSkeleton();
+    AnimationClip clip = syntheticClip();
+
+    RecursiveRig rig;
+    rig.children.resize(skeleton.nodes.size());
+    for (size_t i = 1; i < skeleton.parents.size(); i++) {
+        rig.children[skeleton.parents[i]].push_back((int)i);
+    }
+
+    AnimationPose pose;
+    pose.resize(skeleton.nodes.size());
+    std::vector<uint32_t> cursors(clip.tracks.size(), 0);
+    sampleAnimationClip(clip, 0.7f, cursors.data(), pose);
+
+    std::vector<glm::mat4> globals(skeleton.nodes.size());
+    std::vector<glm::mat4> joints(skeleton.jointCount());
+    std::vector<glm::mat4> reference(skeleton.jointCount());
+    computeJointMatrices(skeleton, pose.localTransforms.data(), globals.data(), joints.data());
+    recursiveJointMatrices(skeleton, rig, pose.localTransforms.data(), reference.data());
+
+    float maxDifference = 0.0f;
+    for (size_t j = 0; j < joints.size(); j++) {
+        for (int c = 0; c < 4; c++) {
+            maxDifference = std::max(maxDifference, glm::length(joints[j][c] - reference[j][c]));
+        }
+    }
+    CHECK(maxDifference < 1e-4f);
+    std::printf("%zu joints, max difference from the recursive walk %g\n", skeleton.jointCount(), maxDifference);
+
+    for (size_t skeletons : {size_t(1), size_t(100), size_t(10000)}) {
+        std::vector<glm::mat4> allGlobals(skeletons * skeleton.nodes.size());
+        std::vector<glm::mat4> allJoints(skeletons * skeleton.jointCount());
+        size_t repeats = std::max<size_t>(1, 200000 / skeletons);
+
+        double start = nowMs();
+        for (size_t r = 0; r < repeats; r++) {
+            for (size_t s = 0; s < skeletons; s++) {
+                computeJointMatrices(skeleton, pose.localTransforms.data(), &allGlobals[s * skeleton.nodes.size()],
+                                     &allJoints[s * skeleton.jointCount()]);
+            }
+        }
+        double flatMs = nowMs() - start;
+
+        start = nowMs();
+        for (size_t r = 0; r < repeats; r++) {
+            for (size_t s = 0; s < skeletons; s++) {
+                recursiveJointMatrices(skeleton, rig, pose.localTransforms.data(), &allJoints[s * skeleton.jointCount()]);
+            }
+        }
+        double recursiveMs = nowMs() - start;
+
+        double joints = double(repeats) * double(skeletons) * double(skeleton.jointCount());
+        std::printf("%5zu skeletons: flat %7.1f M joints/s, recursive %7.1f M joints/s (%.2fx)\n", skeletons,
+                    joints / flatMs * 1e-3, joints / recursiveMs * 1e-3, recursiveMs / flatMs);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,69 @@
+// OcclusionCuller on a synthetic city of 10k houses seen from street level:
+// building the box occluder, rasterising every house's box and testing every
+// house in the frustum against the result, best of several frames
+
+#include "TestCommon.h"
+#include "SyntheticCity.h"
+
+#include "util/Frustum.h"
+#include "util/JobSystem.h"
+#include "util/OcclusionCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+int main() {
+    SyntheticMesh house = gabledHouse();
+    OccluderMesh occluder;
+    double start = nowMs();
+    buildBoxOccluder(house.positions, house.indices, occluder);
+    double buildMs = nowMs() - start;
+
+    SyntheticMesh terrain = syntheticTerrain();
+    OccluderMesh ground;
+    start = nowMs();
+    buildHeightfieldOccluder(terrain.positions, terrain.indices, ground);
+    double groundMs = nowMs() - start;
+
+    std::vector<SyntheticBuilding> city = syntheticCity(100, 20.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 5000.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(2.0f, 1.8f, 3.0f), glm::vec3(300.0f, 8.0f, -1000.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum;
+    frustum.extract(viewProjection);
+
+    OcclusionCuller culler;
+    const int frames = 20;
+    double rasterizeMs = 1e30, testMs = 1e30;
+    size_t inView = 0, hidden = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        start = nowMs();
+        culler.beginFrame(viewProjection);
+        for (const SyntheticBuilding &building : city) {
+            culler.addOccluder(occluder, building.model);
+        }
+        culler.rasterize();
+        rasterizeMs = std::min(rasterizeMs, nowMs() - start);
+
+        start = nowMs();
+        inView = hidden = 0;
+        for (const SyntheticBuilding &building : city) {
+            glm::vec3 center = (building.boundsMin + building.boundsMax) * 0.5f;
+            if (frustum.intersectsSphere(center, glm::length(building.boundsMax - center))) {
+                inView++;
+                hidden += !culler.testBox(building.boundsMin, building.boundsMax);
+            }
+        }
+        testMs = std::min(testMs, nowMs() - start);
+    }
+    CHECK(hidden > inView / 2);
+
+    std::printf("occluders built in %.2f ms (house box) and %.2f ms (terrain, %zu triangles)\n", buildMs, groundMs,
+                ground.indices.size() / 3);
+    std::printf("%zu houses, %zu in view, %zu hidden (%.0f%%): rasterise %.2f ms (%zu triangles), tests %.3f ms, %u threads\n",
+                city.size(), inView, hidden, 100.0 * hidden / std::max<size_t>(inView, 1), rasterizeMs, culler.trianglesLastFrame(),
+                testMs, JobSystem::instance().concurrency());
+    return TEST_RESULT();
+}
@@ -0,0 +1,110 @@
+// How the per-frame animation pass scales with threads: a crowd of robots each
+// sampling the clip and computing its joint matrices, split over a JobSystem
+// the way main.cpp splits it, for 1, 2, 4 ... threads up to the core count
+
+#include "TestCommon.h"
+#include "SyntheticRig.h"
+
+#include "util/AnimationClip.h"
+#include "util/JobSystem.h"
+#include "util/Skeleton.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t kRobotCount = 2000;
+const size_t kRobotsPerJob = 16;   // as in main.cpp
+const int kFrames = 60;
+
+struct CrowdMember {
+    std::vector<uint32_t> cursors;
+    std::vector<glm::mat4> jointMatrices;
+    float timeOffset;
+};
+
+// Per thread, like Robot's animation scratch
+struct Scratch {
+    AnimationPose pose;
+    std::vector<glm::mat4> globals;
+};
+
+Scratch &scratch() {
+    static thread_local Scratch scratch;
+    return scratch;
+}
+
+}
+
+int main() {
+    Skeleton skeleton = syntheticSkeleton();
+    AnimationClip clip = syntheticClip();
+
+    TestRandom random;
+    std::vector<CrowdMember> crowd(kRobotCount);
+    for (CrowdMember &member : crowd) {
+        member.cursors.assign(clip.tracks.size(), 0);
+        member.jointMatrices.resize(skeleton.jointCount());
+        member.timeOffset = random.uniform(0.0f, clip.duration);
+    }
+
+    // The single-threaded result every thread count has to reproduce
+    auto update = [&](size_t begin, size_t end, float time) {
+        Scratch &local = scratch();
+        local.pose.resize(skeleton.nodes.size());
+        local.globals.resize(skeleton.nodes.size());
+        for (size_t i = begin; i < end; i++) {
+            CrowdMember &member = crowd[i];
+            sampleAnimationClip(clip, time + member.timeOffset, member.cursors.data(), local.pose);
+            computeJointMatrices(skeleton, local.pose.localTransforms.data(), local.globals.data(),
+                                 member.jointMatrices.data());
+        }
+    };
+    update(0, kRobotCount, 1.0f);
+    std::vector<glm::mat4> reference;
+    for (const CrowdMember &member : crowd) {
+        reference.insert(reference.end(), member.jointMatrices.begin(), member.jointMatrices.end());
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%zu robots of %zu joints, %u core(s)\n", kRobotCount, skeleton.jointCount(), cores);
+
+    double singleMs = 0.0;
+    for (unsigned threads = 1; threads <= std::max(cores, 2u); threads *= 2) {
+        // A JobSystem always has a worker, so one thread is the plain loop
+        // parallelFor falls back to without workers
+        std::unique_ptr<JobSystem> jobs(threads > 1 ? new JobSystem(threads - 1) : nullptr);
+        auto runFrame = [&](float time) {
+            if (jobs) {
+                jobs->parallelFor(kRobotCount, kRobotsPerJob, [&](size_t begin, size_t end) { update(begin, end, time); });
+            } else {
+                update(0, kRobotCount, time);
+            }
+        };
+
+        double start = nowMs();
+        for (int frame = 0; frame < kFrames; frame++) {
+            runFrame(frame / 60.0f);
+        }
+        double frameMs = (nowMs() - start) / kFrames;
+        if (threads == 1) {
+            singleMs = frameMs;
+        }
+
+        runFrame(1.0f);
+        bool same = true;
+        for (size_t i = 0; i < kRobotCount; i++) {
+            same = same && std::equal(crowd[i].jointMatrices.begin(), crowd[i].jointMatrices.end(),
+                                      reference.begin() + i * skeleton.jointCount());
+        }
+        CHECK(same);
+
+        std::printf("%2u thread(s): %6.2f ms per frame, %.2fx\n", threads, frameMs, singleMs / frameMs);
+    }
+
+    return TEST_RESULT();
+}
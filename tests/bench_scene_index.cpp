@@ -0,0 +1,88 @@
+// SceneIndex at 100k entities scattered over 4 km: insert, move, and the
+// frustum query against culling the same spheres linearly, plus radius and
+// nearest queries
+
+#include "TestCommon.h"
+
+#include "util/Frustum.h"
+#include "util/SceneIndex.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+int main() {
+    const size_t count = 100000;
+    TestRandom random(7);
+    std::vector<glm::vec3> centers(count);
+    std::vector<float> radii(count);
+    SphereSoA spheres;
+    for (size_t i = 0; i < count; i++) {
+        centers[i] = glm::vec3(random.uniform(-2000.0f, 2000.0f), random.uniform(0.0f, 20.0f), random.uniform(-2000.0f, 2000.0f));
+        radii[i] = random.uniform(0.5f, 10.0f);
+        spheres.add(centers[i], radii[i]);
+    }
+
+    SceneIndex index;
+    std::vector<SceneHandle> handles(count);
+    double start = nowMs();
+    for (size_t i = 0; i < count; i++) {
+        handles[i] = index.insert(centers[i], radii[i], (uint32_t)i);
+    }
+    double insertMs = nowMs() - start;
+
+    // A step of a few units a frame, as walking entities would take
+    start = nowMs();
+    for (size_t i = 0; i < count; i++) {
+        centers[i] += glm::vec3(random.uniform(-3.0f, 3.0f), 0.0f, random.uniform(-3.0f, 3.0f));
+        index.move(handles[i], centers[i], radii[i]);
+        spheres.x[i] = centers[i].x;
+        spheres.z[i] = centers[i].z;
+    }
+    double moveNs = (nowMs() - start) * 1e6 / double(count);
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 30.0f, 0.0f), glm::vec3(100.0f, 20.0f, 60.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum;
+    frustum.extract(projection * view);
+
+    const int runs = 20;
+    std::vector<uint32_t> found;
+    std::vector<uint8_t> visible(count);
+    double queryMs = 1e30, linearMs = 1e30;
+    size_t linearCount = 0;
+    for (int run = 0; run < runs; run++) {
+        start = nowMs();
+        index.queryFrustum(frustum, found);
+        queryMs = std::min(queryMs, nowMs() - start);
+
+        start = nowMs();
+        linearCount = frustum.cullSpheres(spheres, visible.data());
+        linearMs = std::min(linearMs, nowMs() - start);
+    }
+    CHECK(found.size() == linearCount);
+
+    const int queries = 1000;
+    start = nowMs();
+    size_t radiusHits = 0;
+    for (int q = 0; q < queries; q++) {
+        index.queryRadius(centers[random.next() % count], 50.0f, found);
+        radiusHits += found.size();
+    }
+    double radiusUs = (nowMs() - start) * 1e3 / queries;
+
+    start = nowMs();
+    uint32_t nearest = 0;
+    for (int q = 0; q < queries; q++) {
+        glm::vec3 point(random.uniform(-2000.0f, 2000.0f), 10.0f, random.uniform(-2000.0f, 2000.0f));
+        index.nearest(point, 500.0f, nearest);
+    }
+    double nearestUs = (nowMs() - start) * 1e3 / queries;
+
+    std::printf("%zu entities in %zu cells: insert %.1f ms, move %.0f ns each\n", count, index.cellCount(), insertMs, moveNs);
+    std::printf("frustum query %.3f ms, linear cullSpheres %.3f ms (%zu visible)\n", queryMs, linearMs, linearCount);
+    std::printf("radius-50 query %.1f us (%.1f hits), nearest %.1f us\n", radiusUs, double(radiusHits) / queries, nearestUs);
+    return TEST_RESULT();
+}
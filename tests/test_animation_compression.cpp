@@ -0,0 +1,125 @@
+// compressAnimationClip against the clip it came from: sampled anywhere, every
+// channel stays within its tolerance plus what quantization adds, constant
+// channels leave the tracks and the clip shrinks at least fivefold
+
+#include "TestCommon.h"
+#include "SyntheticRig.h"
+
+#include "util/AnimationClip.h"
+#include "util/AnimationCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Same chord form as the compressor, which acos cannot resolve this finely
+float rotationError(const glm::quat &a, const glm::quat &b) {
+    glm::vec4 qa(a.x, a.y, a.z, a.w), qb(b.x, b.y, b.z, b.w);
+    float chord = glm::length(glm::dot(qa, qb) < 0.0f ? qa + qb : qa - qb);
+    return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+}
+
+}
+
+int main() {
+    const int nodeCount = 64;
+    AnimationClip clip = syntheticClip(nodeCount);
+    AnimationCompressionSettings settings;
+    AnimationClip compressed = compressAnimationClip(clip, settings);
+
+    // Rotations on every node and the root's translation stay animated; the
+    // bone offsets become constants and the identity scales go altogether
+    CHECK(compressed.tracks.size() == size_t(nodeCount + 1));
+    CHECK(compressed.constants.size() == size_t(nodeCount - 1));
+    for (const AnimationTrack &track : compressed.tracks) {
+        CHECK(track.format == KeyFormat::Quantized);
+        CHECK(track.path != AnimationPath::Scale);
+    }
+    for (const AnimationConstant &constant : compressed.constants) {
+        CHECK(constant.path == AnimationPath::Translation);
+    }
+
+    size_t keys = 0;
+    for (const AnimationTrack &track : compressed.tracks) {
+        keys += track.keyCount;
+    }
+    double ratio = double(clip.residentBytes()) / double(compressed.residentBytes());
+    std::printf("%zu -> %zu keys, %zu -> %zu bytes (%.2fx)\n", clip.times.size(), keys, clip.residentBytes(),
+                compressed.residentBytes(), ratio);
+    // The goal is 5-10x less clip memory. The waving robot, 29.3 KB as
+    // exported, comes to 5.7 KB (5.2x) at these tolerances
+    CHECK(keys < clip.times.size() / 2);
+    CHECK(ratio > 5.0);
+
+    // Quantization on top of the tolerances: 15-bit rotation components, and
+    // 16-bit positions in the root's translation range of about 2 units
+    const float rotationBound = settings.rotationTolerance + 1e-4f;
+    const float translationBound = settings.translationTolerance + 1e-4f;
+    const float scaleBound = settings.scaleTolerance;
+
+    AnimationPose reference, pose;
+    reference.resize(nodeCount);
+    pose.resize(nodeCount);
+    std::vector<uint32_t> referenceCursors(clip.tracks.size(), 0);
+    std::vector<uint32_t> cursors(compressed.tracks.size(), 0);
+
+    float maxRotation = 0.0f, maxTranslation = 0.0f, maxScale = 0.0f;
+    const int samples = 4000;
+    for (int s = 0; s < samples; s++) {
+        // Past the end once, to cover the wrap
+        float time = clip.duration * 1.25f * float(s) / float(samples);
+        sampleAnimationClip(clip, time, referenceCursors.data(), reference);
+        sampleAnimationClip(compressed, time, cursors.data(), pose);
+        for (int n = 0; n < nodeCount; n++) {
+            maxRotation = std::max(maxRotation, rotationError(reference.rotations[n], pose.rotations[n]));
+            maxTranslation = std::max(maxTranslation, glm::length(reference.translations[n] - pose.translations[n]));
+            maxScale = std::max(maxScale, glm::length(reference.scales[n] - pose.scales[n]));
+        }
+    }
+    std::printf("max error: rotation %g rad, translation %g, scale %g\n", maxRotation, maxTranslation, maxScale);
+    CHECK(maxRotation <= rotationBound);
+    CHECK(maxTranslation <= translationBound);
+    CHECK(maxScale <= scaleBound);
+
+    // Past 16 bits of node index a constant stays a one-key track
+    AnimationClip farClip;
+    const int farNode = 70000;
+    float times[2] = {0.0f, 1.0f};
+    glm::vec4 offsets[2] = {glm::vec4(1.0f, 2.0f, 3.0f, 0.0f), glm::vec4(1.0f, 2.0f, 3.0f, 0.0f)};
+    farClip.addTrack(farNode, AnimationPath::Translation, Interpolation::Linear, times, 2, offsets, 1);
+    AnimationClip farCompressed = compressAnimationClip(farClip, settings);
+    CHECK(farCompressed.constants.empty());
+    CHECK(farCompressed.tracks.size() == 1 && farCompressed.tracks[0].keyCount == 1);
+
+    AnimationPose farPose;
+    farPose.resize(farNode + 1);
+    uint32_t farCursor = 0;
+    sampleAnimationClip(farCompressed, 0.5f, &farCursor, farPose);
+    CHECK(farPose.translations[farNode] == glm::vec3(1.0f, 2.0f, 3.0f));
+
+    // Vector constants share one range; one it is too coarse for stays a
+    // one-key track, the two at its ends are exact
+    AnimationClip spreadClip;
+    glm::vec4 spread[3][2] = {{glm::vec4(5.0f, 0.5f, 0.5f, 0.0f), glm::vec4(5.0f, 0.5f, 0.5f, 0.0f)},
+                              {glm::vec4(1e6f, 1.0f, 1.0f, 0.0f), glm::vec4(1e6f, 1.0f, 1.0f, 0.0f)},
+                              {glm::vec4(1.0f, 0.0f, 0.0f, 0.0f), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f)}};
+    for (int n = 0; n < 3; n++) {
+        spreadClip.addTrack(n, AnimationPath::Translation, Interpolation::Linear, times, 2, spread[n], 1);
+    }
+    AnimationClip spreadCompressed = compressAnimationClip(spreadClip, settings);
+    CHECK(spreadCompressed.constants.size() == 2);
+    CHECK(spreadCompressed.tracks.size() == 1 && spreadCompressed.tracks[0].targetNode == 0);
+
+    AnimationPose spreadPose;
+    spreadPose.resize(3);
+    uint32_t spreadCursor = 0;
+    sampleAnimationClip(spreadCompressed, 0.5f, &spreadCursor, spreadPose);
+    for (int n = 0; n < 3; n++) {
+        CHECK(glm::length(spreadPose.translations[n] - glm::vec3(spread[n][0])) <= settings.translationTolerance);
+    }
+
+    return TEST_RESULT();
+}
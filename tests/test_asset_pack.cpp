@@ -0,0 +1,68 @@
+// Cooked glTF entries: deterministic, readable back without the source, and
+// stale once the .gltf or any file it depends on changes
+
+#include "TestCommon.h"
+
+#include "util/AssetCook.h"
+#include "util/AssetPack.h"
+#include "util/GltfModel.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main() {
+    fs::path root = fs::temp_directory_path() / "asset_pack_test";
+    fs::path bot = root / "assets" / "models" / "bot";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(bot);
+    for (const char *name : {"Waving.gltf", "Waving.bin"}) {
+        fs::copy_file(fs::path(ASSET_DIR) / "models" / "bot" / name, bot / name);
+    }
+    std::string gltfPath = (bot / "Waving.gltf").generic_string();
+    std::string packPath = (root / "assets.pak").generic_string();
+
+    // The .gltf names its buffer in lower case, which only resolves ignoring case
+    std::vector<unsigned char> blob, again;
+    std::vector<std::string> dependencies;
+    CHECK(cookGltf(gltfPath, blob, dependencies));
+    CHECK(dependencies == std::vector<std::string>{"waving.bin"});
+    CHECK(cookGltf(gltfPath, again, dependencies));
+    CHECK(blob == again);
+
+    // The GL half is never run here, only the read of the cooked blob
+    CHECK(prepareGltfModel(gltfPath, blob.data(), blob.size()) != nullptr);
+    CHECK(prepareGltfModel(gltfPath, blob.data(), blob.size() / 2) == nullptr);
+
+    AssetPackWriter writer;
+    CHECK(writer.add(assetKey(gltfPath), AssetType::Gltf, gltfPath, blob, dependencies));
+    CHECK(writer.write(packPath.c_str()));
+
+    {
+        AssetPack pack;
+        CHECK(pack.open(packPath.c_str()));
+        size_t size = 0;
+        const unsigned char *found = pack.find(assetKey(gltfPath), AssetType::Gltf, gltfPath, size);
+        CHECK(found && size == blob.size() && std::equal(blob.begin(), blob.end(), found));
+        CHECK(assetKey(gltfPath) == "models/bot/waving.gltf");
+
+        // Runtime paths use lower case throughout
+        std::string runtimePath = (bot / "waving.gltf").generic_string();
+        CHECK(pack.find(assetKey(runtimePath), AssetType::Gltf, runtimePath, size) != nullptr);
+    }
+
+    // A newer buffer makes the entry stale although the .gltf is unchanged
+    fs::last_write_time(bot / "Waving.bin", fs::last_write_time(bot / "Waving.bin") + std::chrono::hours(1));
+    {
+        AssetPack pack;
+        CHECK(pack.open(packPath.c_str()));
+        size_t size = 0;
+        CHECK(pack.find(assetKey(gltfPath), AssetType::Gltf, gltfPath, size) == nullptr);
+    }
+
+    fs::remove_all(root, ec);
+    return TEST_RESULT();
+}
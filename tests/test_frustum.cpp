@@ -0,0 +1,64 @@
+// Frustum::cullSpheres against intersectsSphere over a million spheres: the
+// same flag for every one, including those straddling or touching a plane and
+// the tail that does not fill a register
+
+#include "TestCommon.h"
+
+#include "util/Frustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <vector>
+
+int main() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(100.0f, 40.0f, 30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum;
+    frustum.extract(projection * view);
+
+    TestRandom random;
+    SphereSoA spheres;
+    const size_t count = 1000000 + 5;
+    while (spheres.size() < count) {
+        glm::vec3 center(random.uniform(-2500.0f, 2500.0f), random.uniform(-250.0f, 250.0f), random.uniform(-2500.0f, 2500.0f));
+        float radius = random.uniform(0.5f, 30.0f);
+        if (random.next() % 4 == 0) {
+            // Onto a plane, either just touching it or centred on it with no size
+            const glm::vec4 &plane = frustum.planes[random.next() % 6];
+            glm::vec3 normal = glm::vec3(plane) / glm::length(glm::vec3(plane));
+            float distance = (glm::dot(glm::vec3(plane), center) + plane.w) / glm::length(glm::vec3(plane));
+            center -= normal * distance;
+            if (random.next() % 2) {
+                center -= normal * radius;
+            } else {
+                radius = 0.0f;
+            }
+        }
+        spheres.add(center, radius);
+    }
+
+    std::vector<uint8_t> visible(count, 2);
+    size_t visibleCount = frustum.cullSpheres(spheres, visible.data());
+
+    size_t expectedCount = 0, mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        bool expected = frustum.intersectsSphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+        expectedCount += expected;
+        mismatches += visible[i] != (expected ? 1 : 0);
+    }
+    std::printf("%zu spheres, %zu visible, %zu mismatches\n", count, visibleCount, mismatches);
+    CHECK(mismatches == 0);
+    CHECK(visibleCount == expectedCount);
+    CHECK(visibleCount > 0 && visibleCount < count);
+
+    // Fewer than one register's worth
+    SphereSoA few;
+    few.add(glm::vec3(100.0f, 40.0f, 30.0f), 1.0f);
+    few.add(glm::vec3(-100.0f, 40.0f, -30.0f), 1.0f);
+    uint8_t fewVisible[2] = {2, 2};
+    CHECK(frustum.cullSpheres(few, fewVisible) == 1);
+    CHECK(fewVisible[0] == 1 && fewVisible[1] == 0);
+
+    return TEST_RESULT();
+}
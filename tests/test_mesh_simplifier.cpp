@@ -0,0 +1,111 @@
+// Simplification across attribute seams: a grid split into two uv charts
+// keeps its charts apart, and the house, which is split along every crease,
+// still gets a full chain of levels
+
+#include "TestCommon.h"
+
+#include "util/MeshBuilder.h"
+#include "util/MeshSimplifier.h"
+
+#include <cfloat>
+#include <string>
+#include <vector>
+
+namespace {
+
+void testSeamedGrid() {
+    // Columns left of x = n / 2 map to uvs in [0, 0.4], those right of it to
+    // [0.6, 1], so the middle column is stored twice
+    const int n = 32;
+    MeshBuilder builder;
+    std::vector<uint32_t> indices;
+    auto corner = [&](int x, int z, bool right) {
+        MeshVertex v;
+        v.position = glm::vec3(float(x), 0.0f, float(z));
+        v.uv = right ? glm::vec2(0.6f + 0.4f * float(x - n / 2) / float(n / 2), float(z) / n)
+                     : glm::vec2(0.4f * float(x) / float(n / 2), float(z) / n);
+        v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        return builder.addVertex(v);
+    };
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            bool right = x >= n / 2;
+            uint32_t a = corner(x, z, right), b = corner(x + 1, z, right);
+            uint32_t c = corner(x, z + 1, right), d = corner(x + 1, z + 1, right);
+            indices.insert(indices.end(), {a, c, b, b, c, d});
+        }
+    }
+    const std::vector<MeshVertex> &vertices = builder.getVertices();
+
+    float error;
+    std::vector<uint32_t> simplified = simplifyMesh(vertices, indices, indices.size() / 8, FLT_MAX, &error);
+    std::printf("seamed grid: %zu -> %zu triangles, error %g\n", indices.size() / 3, simplified.size() / 3, error);
+
+    // Only the outline is locked, so the flat grid goes well past half
+    CHECK(simplified.size() * 4 <= indices.size());
+    CHECK(error < 1e-3f);
+
+    // Copies on the seam collapse along it together with their twins
+    std::vector<bool> seamUsed(n + 1, false);
+    for (uint32_t v : simplified) {
+        if (vertices[v].position.x == float(n / 2)) {
+            seamUsed[(int)vertices[v].position.z] = true;
+        }
+    }
+    int seamLeft = 0;
+    for (bool used : seamUsed) {
+        seamLeft += used;
+    }
+    CHECK(seamLeft < n / 2);
+
+    for (size_t t = 0; t < simplified.size(); t += 3) {
+        const MeshVertex &a = vertices[simplified[t]], &b = vertices[simplified[t + 1]], &c = vertices[simplified[t + 2]];
+        bool right = a.uv.x >= 0.5f;
+        CHECK((b.uv.x >= 0.5f) == right && (c.uv.x >= 0.5f) == right);
+        float limit = float(n / 2);
+        bool onSide = right ? (a.position.x >= limit && b.position.x >= limit && c.position.x >= limit)
+                            : (a.position.x <= limit && b.position.x <= limit && c.position.x <= limit);
+        CHECK(onSide);
+        glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+        CHECK(normal.y > 0.0f);
+    }
+}
+
+void testHouse() {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning, loadError;
+    std::string path = std::string(ASSET_DIR) + "/models/house/model.obj";
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &loadError, path.c_str())) {
+        std::fprintf(stderr, "Failed to load %s: %s\n", path.c_str(), loadError.c_str());
+        CHECK(false);
+        return;
+    }
+
+    MeshBuilder builder;
+    builder.addObjShapes(attrib, shapes);
+    builder.optimize("house");
+    LodSettings settings;
+    std::vector<MeshLod> lods = builder.buildLods(settings);
+
+    CHECK((int)lods.size() == settings.levels);
+    for (size_t i = 0; i < lods.size(); i++) {
+        std::printf("house LOD%zu: %u triangles, error %g\n", i, lods[i].indexCount / 3, lods[i].error);
+        if (i > 0) {
+            CHECK(lods[i].indexCount <= lods[i - 1].indexCount * 3 / 4);
+            CHECK(lods[i].error >= lods[i - 1].error);
+        }
+        for (uint32_t k = 0; k < lods[i].indexCount; k++) {
+            CHECK(builder.getIndices()[lods[i].indexOffset + k] < builder.getVertices().size());
+        }
+    }
+}
+
+}
+
+int main() {
+    testSeamedGrid();
+    testHouse();
+    return TEST_RESULT();
+}
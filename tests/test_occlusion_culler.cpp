@@ -0,0 +1,198 @@
+// OcclusionCuller with the occluders built for houses and terrain: the box and
+// heightfield stay inside what they stand for, and in a synthetic city nothing
+// is hidden that a ray through some pixel centre would reach, while most of
+// what no ray reaches is hidden
+
+#include "TestCommon.h"
+#include "SyntheticCity.h"
+
+#include "util/Frustum.h"
+#include "util/OcclusionCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Entry distance along origin + t * direction into gabledHouse, in model space
+float rayHouse(glm::vec3 origin, glm::vec3 direction) {
+    // Each side as normal . p <= offset
+    const glm::vec4 planes[7] = {{1, 0, 0, 1}, {-1, 0, 0, 1}, {0, 0, 1, 1}, {0, 0, -1, 1}, {0, -1, 0, 0}, {0, 1, 0.5f, 1.5f}, {0, 1, -0.5f, 1.5f}};
+    float enter = 0.0f, exit = INFINITY;
+    for (const glm::vec4 &plane : planes) {
+        glm::vec3 normal(plane);
+        float along = glm::dot(normal, direction);
+        float gap = plane.w - glm::dot(normal, origin);
+        if (along == 0.0f) {
+            if (gap < 0.0f) {
+                return INFINITY;
+            }
+        } else if (along < 0.0f) {
+            enter = std::max(enter, gap / along);
+        } else {
+            exit = std::min(exit, gap / along);
+        }
+    }
+    return enter <= exit ? enter : INFINITY;
+}
+
+// The pixels testBox looks at for a box, or false when it is off screen
+bool screenRect(const glm::mat4 &viewProjection, const SyntheticBuilding &building, int width, int height, glm::ivec4 &rect) {
+    glm::vec2 lower(INFINITY), upper(-INFINITY);
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point(corner & 1 ? building.boundsMax.x : building.boundsMin.x, corner & 2 ? building.boundsMax.y : building.boundsMin.y,
+                        corner & 4 ? building.boundsMax.z : building.boundsMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+        if (clip.w <= 0.0f) {
+            return false;
+        }
+        glm::vec2 screen = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(width, height);
+        lower = glm::min(lower, screen);
+        upper = glm::max(upper, screen);
+    }
+    rect = glm::ivec4(std::max(0, (int)std::floor(lower.x)), std::max(0, (int)std::floor(lower.y)),
+                      std::min(width - 1, (int)std::floor(upper.x)), std::min(height - 1, (int)std::floor(upper.y)));
+    return rect.x <= rect.z && rect.y <= rect.w;
+}
+
+void checkHouseBox() {
+    SyntheticMesh house = gabledHouse();
+    OccluderMesh occluder;
+    buildBoxOccluder(house.positions, house.indices, occluder);
+    CHECK(occluder.vertices.size() == 8 && occluder.indices.size() == 36);
+    for (const glm::vec3 &corner : occluder.vertices) {
+        CHECK(insideGabledHouse(corner));
+    }
+    if (occluder.vertices.size() == 8) {
+        glm::vec3 size = occluder.vertices[7] - occluder.vertices[0];
+        std::printf("house box %.2f x %.2f x %.2f of 2 x 1.5 x 2\n", size.x, size.y, size.z);
+        CHECK(size.x * size.y * size.z > 2.5f);
+    }
+
+    // Without its floor the inside is the outside, and there is no box to be had
+    SyntheticMesh open = house;
+    open.indices.erase(open.indices.begin() + 36, open.indices.begin() + 42);
+    buildBoxOccluder(open.positions, open.indices, occluder);
+    CHECK(occluder.indices.empty());
+}
+
+void checkTerrain() {
+    SyntheticMesh terrain = syntheticTerrain();
+    OccluderMesh occluder;
+    buildHeightfieldOccluder(terrain.positions, terrain.indices, occluder);
+    CHECK(!occluder.indices.empty());
+
+    // Anywhere on any of its triangles, never above the terrain
+    TestRandom random(5);
+    float worst = -INFINITY;
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+        glm::vec3 a = occluder.vertices[occluder.indices[i]], b = occluder.vertices[occluder.indices[i + 1]],
+                  c = occluder.vertices[occluder.indices[i + 2]];
+        for (int sample = 0; sample < 8; sample++) {
+            float u = random.uniform(0.0f, 1.0f), v = random.uniform(0.0f, 1.0f);
+            if (u + v > 1.0f) {
+                u = 1.0f - u;
+                v = 1.0f - v;
+            }
+            glm::vec3 point = a + (b - a) * u + (c - a) * v;
+            worst = std::max(worst, point.y - syntheticTerrainSurface(point.x, point.z));
+        }
+    }
+    std::printf("terrain: %zu occluder triangles, highest %.3g above the surface\n", occluder.indices.size() / 3, worst);
+    CHECK(worst <= 1e-3f);
+
+    // From the foot of the ridge, what is behind and below it is hidden
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 2000.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f, 4.0f, -10.0f), glm::vec3(0.0f, 6.0f, -100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    OcclusionCuller culler;
+    culler.beginFrame(viewProjection);
+    culler.addOccluder(occluder, glm::mat4(1.0f));
+    culler.rasterize();
+    CHECK(!culler.testBox(glm::vec3(-5.0f, 0.0f, -170.0f), glm::vec3(5.0f, 8.0f, -160.0f)));
+    CHECK(culler.testBox(glm::vec3(-5.0f, 60.0f, -170.0f), glm::vec3(5.0f, 70.0f, -160.0f)));
+    CHECK(culler.testBox(glm::vec3(-5.0f, 0.0f, -40.0f), glm::vec3(5.0f, 8.0f, -30.0f)));
+}
+
+void checkCity() {
+    SyntheticMesh house = gabledHouse();
+    OccluderMesh occluder;
+    buildBoxOccluder(house.positions, house.indices, occluder);
+    std::vector<SyntheticBuilding> city = syntheticCity(24, 20.0f);
+
+    // Along a street from the empty square, as someone walking down it would
+    glm::vec3 eye(10.0f, 1.8f, 0.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 2000.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(eye, glm::vec3(40.0f, 8.0f, -300.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum;
+    frustum.extract(viewProjection);
+
+    OcclusionCuller culler;
+    culler.beginFrame(viewProjection);
+    std::vector<const SyntheticBuilding *> inView;
+    for (const SyntheticBuilding &building : city) {
+        culler.addOccluder(occluder, building.model);
+        glm::vec3 center = (building.boundsMin + building.boundsMax) * 0.5f;
+        if (frustum.intersectsSphere(center, glm::length(building.boundsMax - center))) {
+            inView.push_back(&building);
+        }
+    }
+    culler.rasterize();
+
+    // The real houses' nearest hit along the ray through each pixel centre
+    const int width = culler.width(), height = culler.height();
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    std::vector<glm::vec3> rays(size_t(width) * height);
+    std::vector<float> nearest(rays.size(), INFINITY);
+    std::vector<glm::mat4> toModel;
+    for (const SyntheticBuilding *building : inView) {
+        toModel.push_back(glm::inverse(building->model));
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            glm::vec4 far = inverseViewProjection * glm::vec4((x + 0.5f) / width * 2.0f - 1.0f, (y + 0.5f) / height * 2.0f - 1.0f, 1.0f, 1.0f);
+            glm::vec3 ray = glm::vec3(far) / far.w - eye;
+            rays[size_t(y) * width + x] = ray;
+            for (const glm::mat4 &model : toModel) {
+                float hit = rayHouse(glm::vec3(model * glm::vec4(eye, 1.0f)), glm::vec3(model * glm::vec4(ray, 0.0f)));
+                nearest[size_t(y) * width + x] = std::min(nearest[size_t(y) * width + x], hit);
+            }
+        }
+    }
+
+    size_t hidden = 0, reachable = 0, hiddenButReachable = 0;
+    for (size_t i = 0; i < inView.size(); i++) {
+        bool visible = false;
+        glm::ivec4 rect;
+        if (screenRect(viewProjection, *inView[i], width, height, rect)) {
+            for (int y = rect.y; y <= rect.w && !visible; y++) {
+                for (int x = rect.x; x <= rect.z && !visible; x++) {
+                    size_t pixel = size_t(y) * width + x;
+                    float hit = rayHouse(glm::vec3(toModel[i] * glm::vec4(eye, 1.0f)), glm::vec3(toModel[i] * glm::vec4(rays[pixel], 0.0f)));
+                    visible = hit != INFINITY && hit <= nearest[pixel] * (1.0f + 1e-5f);
+                }
+            }
+        }
+        bool culled = !culler.testBox(inView[i]->boundsMin, inView[i]->boundsMax);
+        hidden += culled;
+        reachable += visible;
+        hiddenButReachable += culled && visible;
+    }
+    size_t unreachable = inView.size() - reachable;
+    std::printf("city: %zu houses, %zu in view, %zu reached by a ray, %zu hidden of the %zu no ray reaches, %zu occluder triangles\n",
+                city.size(), inView.size(), reachable, hidden, unreachable, culler.trianglesLastFrame());
+    CHECK(hiddenButReachable == 0);
+    CHECK(unreachable > inView.size() / 2);
+    CHECK(hidden * 10 >= unreachable * 7);
+}
+
+}
+
+int main() {
+    checkHouseBox();
+    checkTerrain();
+    checkCity();
+    return TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+// SceneIndex against brute force over the same spheres, through inserts,
+// moves within and across cells and levels, and removals: frustum, radius and
+// nearest queries return what a linear scan does, and emptied cells go away
+
+#include "TestCommon.h"
+
+#include "util/Frustum.h"
+#include "util/SceneIndex.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct Sphere {
+    glm::vec3 center;
+    float radius;
+    SceneHandle handle;
+    bool live;
+};
+
+glm::vec3 randomCenter(TestRandom &random) {
+    return glm::vec3(random.uniform(-2000.0f, 2000.0f), random.uniform(-50.0f, 50.0f), random.uniform(-2000.0f, 2000.0f));
+}
+
+// Mostly small, a few spanning many cells
+float randomRadius(TestRandom &random) {
+    return random.next() % 50 == 0 ? random.uniform(50.0f, 400.0f) : random.uniform(0.5f, 12.0f);
+}
+
+std::vector<uint32_t> sorted(std::vector<uint32_t> values) {
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+void checkQueries(const SceneIndex &index, const std::vector<Sphere> &spheres, const Frustum &frustum, TestRandom &random) {
+    std::vector<uint32_t> found, expected;
+    SphereSoA bounds;
+    index.queryFrustum(frustum, found, &bounds);
+    for (uint32_t i = 0; i < spheres.size(); i++) {
+        if (spheres[i].live && frustum.intersectsSphere(spheres[i].center, spheres[i].radius)) {
+            expected.push_back(i);
+        }
+    }
+    CHECK(sorted(found) == expected);
+    CHECK(bounds.size() == found.size());
+    for (size_t i = 0; i < found.size() && i < bounds.size(); i++) {
+        CHECK(bounds.x[i] == spheres[found[i]].center.x && bounds.radius[i] == spheres[found[i]].radius);
+    }
+
+    for (int query = 0; query < 50; query++) {
+        glm::vec3 center = randomCenter(random);
+        float radius = random.uniform(1.0f, 300.0f);
+        index.queryRadius(center, radius, found);
+        expected.clear();
+        for (uint32_t i = 0; i < spheres.size(); i++) {
+            float reach = radius + spheres[i].radius;
+            glm::vec3 offset = spheres[i].center - center;
+            if (spheres[i].live && glm::dot(offset, offset) <= reach * reach) {
+                expected.push_back(i);
+            }
+        }
+        CHECK(sorted(found) == expected);
+
+        float maxDistance = random.uniform(10.0f, 500.0f);
+        uint32_t nearest = 0;
+        bool hit = index.nearest(center, maxDistance, nearest);
+        float best = maxDistance * maxDistance;
+        bool expectedHit = false;
+        for (const Sphere &sphere : spheres) {
+            glm::vec3 offset = sphere.center - center;
+            if (sphere.live && glm::dot(offset, offset) <= best) {
+                best = glm::dot(offset, offset);
+                expectedHit = true;
+            }
+        }
+        CHECK(hit == expectedHit);
+        if (hit && expectedHit) {
+            glm::vec3 offset = spheres[nearest].center - center;
+            CHECK(spheres[nearest].live && glm::dot(offset, offset) == best);
+        }
+    }
+}
+
+}
+
+int main() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(-300.0f, 40.0f, -200.0f), glm::vec3(0.0f, 0.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum;
+    frustum.extract(projection * view);
+
+    TestRandom random;
+    SceneIndex index;
+    std::vector<Sphere> spheres(20000);
+    for (uint32_t i = 0; i < spheres.size(); i++) {
+        Sphere &sphere = spheres[i];
+        sphere.center = randomCenter(random);
+        sphere.radius = randomRadius(random);
+        sphere.handle = index.insert(sphere.center, sphere.radius, i);
+        sphere.live = true;
+    }
+    CHECK(index.size() == spheres.size());
+    checkQueries(index, spheres, frustum, random);
+
+    // Small steps mostly stay in their cell, jumps and new sizes leave it
+    for (int round = 0; round < 3; round++) {
+        for (Sphere &sphere : spheres) {
+            if (random.next() % 4 == 0) {
+                sphere.center = randomCenter(random);
+                sphere.radius = randomRadius(random);
+            } else {
+                sphere.center += glm::vec3(random.uniform(-2.0f, 2.0f), 0.0f, random.uniform(-2.0f, 2.0f));
+            }
+            index.move(sphere.handle, sphere.center, sphere.radius);
+        }
+        checkQueries(index, spheres, frustum, random);
+    }
+
+    // Removing half, then inserting into the freed slots
+    for (size_t i = 0; i < spheres.size(); i += 2) {
+        index.remove(spheres[i].handle);
+        spheres[i].live = false;
+    }
+    CHECK(index.size() == spheres.size() / 2);
+    checkQueries(index, spheres, frustum, random);
+
+    for (size_t i = 0; i < spheres.size(); i += 4) {
+        spheres[i].center = randomCenter(random);
+        spheres[i].radius = randomRadius(random);
+        spheres[i].handle = index.insert(spheres[i].center, spheres[i].radius, (uint32_t)i);
+        spheres[i].live = true;
+    }
+    checkQueries(index, spheres, frustum, random);
+
+    // Nothing left behind once everything is gone, parents included
+    for (Sphere &sphere : spheres) {
+        if (sphere.live) {
+            index.remove(sphere.handle);
+            sphere.live = false;
+        }
+    }
+    CHECK(index.size() == 0);
+    CHECK(index.cellCount() == 0);
+    std::vector<uint32_t> found;
+    index.queryFrustum(frustum, found);
+    CHECK(found.empty());
+
+    return TEST_RESULT();
+}
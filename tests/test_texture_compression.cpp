@@ -0,0 +1,111 @@
+// Cooked textures: PSNR of the block compressed levels and the size against
+// the uncompressed RGB upload they replace
+
+#include "TestCommon.h"
+
+#include "util/AssetCook.h"
+#include "util/TextureCompressor.h"
+
+#include <tinygltf/stb_image.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+void testCookedTexture(const char *name) {
+    std::string path = std::string(ASSET_DIR) + "/" + name;
+    std::vector<unsigned char> blob;
+    CHECK(cookTexture(path, blob));
+
+    CookedTexture texture;
+    if (!readCookedTexture(blob.data(), blob.size(), texture)) {
+        CHECK(false);
+        return;
+    }
+    const CookedTextureHeader &header = *texture.header;
+    CHECK(header.format == (uint32_t)TextureFormat::BC1);
+
+    int width, height, channels;
+    unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    CHECK(pixels != nullptr);
+    if (!pixels) {
+        return;
+    }
+    Image source;
+    source.width = width;
+    source.height = height;
+    source.rgba.assign(pixels, pixels + size_t(width) * height * 4);
+    stbi_image_free(pixels);
+
+    // A full chain down to 1x1
+    int largest = std::max(width, height);
+    CHECK(header.levelCount == uint32_t(std::log2(largest)) + 1);
+
+    std::vector<Image> levels = buildMipChain(source, MipFilter::Kaiser);
+    size_t rgbBytes = 0, cookedBytes = 0;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        const Image &level = levels[i];
+        CHECK(header.levelSizes[i] == compressedSize(TextureFormat::BC1, level.width, level.height));
+        rgbBytes += size_t(level.width) * level.height * 3;
+        cookedBytes += header.levelSizes[i];
+
+        // Levels too small for a whole block are not worth a quality bound
+        if (level.width >= 16 && level.height >= 16) {
+            Image decoded = decompressImage(texture.levels[i], level.width, level.height, TextureFormat::BC1);
+            float psnr = measurePsnr(level, decoded);
+            std::printf("%s: level %u PSNR %.2f dB\n", name, i, psnr);
+
+            // Smaller levels pack more detail into each block
+            CHECK(psnr >= (i == 0 ? 32.0f : 28.0f));
+        }
+    }
+
+    float ratio = float(rgbBytes) / float(cookedBytes);
+    std::printf("%s: %zu bytes cooked, %zu as RGB with mips, %.2fx smaller\n", name, cookedBytes, rgbBytes, ratio);
+    CHECK(ratio >= 4.0f && ratio <= 8.0f);
+}
+
+void testAlpha() {
+    // A smooth gradient with a soft alpha edge goes to BC3
+    Image image;
+    image.width = 256;
+    image.height = 128;
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+    for (int y = 0; y < image.height; y++) {
+        for (int x = 0; x < image.width; x++) {
+            unsigned char *p = &image.rgba[(size_t(y) * image.width + x) * 4];
+            p[0] = (unsigned char)x;
+            p[1] = (unsigned char)(y * 2);
+            p[2] = (unsigned char)(255 - x);
+            p[3] = (unsigned char)std::min(255, std::max(0, (x - 96) * 4));
+        }
+    }
+    CHECK(image.hasAlpha());
+
+    std::vector<unsigned char> data = compressImage(image, TextureFormat::BC3);
+    CHECK(data.size() == compressedSize(TextureFormat::BC3, image.width, image.height));
+    CHECK(data.size() * 4 == image.rgba.size());
+
+    Image decoded = decompressImage(data.data(), image.width, image.height, TextureFormat::BC3);
+    float psnr = measurePsnr(image, decoded);
+    int alphaError = 0;
+    for (size_t i = 3; i < image.rgba.size(); i += 4) {
+        alphaError = std::max(alphaError, std::abs(int(image.rgba[i]) - int(decoded.rgba[i])));
+    }
+    std::printf("gradient: BC3 PSNR %.2f dB, alpha error %d\n", psnr, alphaError);
+    CHECK(psnr >= 35.0f);
+
+    // BC4 spreads 8 levels over each block's alpha range, at most 60 wide here
+    CHECK(alphaError <= 5);
+}
+
+}
+
+int main() {
+    testCookedTexture("skybox/px.jpg");
+    testCookedTexture("skybox/py.jpg");
+    testAlpha();
+    return TEST_RESULT();
+}
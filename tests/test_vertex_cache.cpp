@@ -0,0 +1,120 @@
+// ACMR before and after the index buffer optimisation passes, on a shuffled
+// grid where the ideal is known and on the house model
+
+#include "TestCommon.h"
+
+#include "util/MeshBuilder.h"
+#include "util/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Each triangle rotated to start at its smallest index, then all of them sorted
+std::vector<std::array<uint32_t, 3>> triangleSet(const std::vector<uint32_t> &indices) {
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<uint32_t, 3> t = {indices[i], indices[i + 1], indices[i + 2]};
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        triangles.push_back(t);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+void testGrid() {
+    const uint32_t n = 128;
+    std::vector<float> positions;
+    for (uint32_t y = 0; y <= n; y++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            positions.push_back(float(x));
+            positions.push_back(0.0f);
+            positions.push_back(float(y));
+        }
+    }
+    size_t vertexCount = positions.size() / 3;
+
+    std::vector<std::array<uint32_t, 3>> quads;
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y < n; y++) {
+        for (uint32_t x = 0; x < n; x++) {
+            uint32_t v = y * (n + 1) + x;
+            quads.push_back({v, v + 1, v + n + 1});
+            quads.push_back({v + 1, v + n + 2, v + n + 1});
+        }
+    }
+    TestRandom random(7);
+    for (size_t i = quads.size() - 1; i > 0; i--) {
+        std::swap(quads[i], quads[random.next() % (i + 1)]);
+    }
+    for (const auto &t : quads) {
+        indices.insert(indices.end(), t.begin(), t.end());
+    }
+    auto original = triangleSet(indices);
+
+    VertexCacheStats before = analyzeVertexCache(indices, vertexCount);
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertexCount, kVertexCacheSize, &clusters);
+    VertexCacheStats cached = analyzeVertexCache(indices, vertexCount);
+    optimizeOverdraw(indices, positions.data(), 3 * sizeof(float), vertexCount, clusters);
+    VertexCacheStats after = analyzeVertexCache(indices, vertexCount);
+    printVertexCacheStats("grid", before, after);
+
+    // A shuffled grid transforms nearly every corner, a good order under one
+    // vertex per triangle; the overdraw pass may only cost its threshold
+    CHECK(before.acmr > 2.0f);
+    CHECK(cached.acmr < 0.8f);
+    CHECK(after.acmr <= cached.acmr * 1.05f + 1e-4f);
+    CHECK(triangleSet(indices) == original);
+
+    size_t uniqueVertexCount;
+    std::vector<uint32_t> remap = optimizeVertexFetch(indices, vertexCount, uniqueVertexCount);
+    CHECK(uniqueVertexCount == vertexCount);
+    uint32_t nextNew = 0;
+    bool firstUseOrder = true;
+    for (uint32_t v : indices) {
+        if (v == nextNew) {
+            nextNew++;
+        } else if (v > nextNew) {
+            firstUseOrder = false;
+        }
+    }
+    CHECK(firstUseOrder);
+    CHECK(analyzeVertexCache(indices, vertexCount).acmr == after.acmr);
+    (void)remap;
+}
+
+void testHouse() {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning, error;
+    std::string path = std::string(ASSET_DIR) + "/models/house/model.obj";
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, path.c_str())) {
+        std::fprintf(stderr, "Failed to load %s: %s\n", path.c_str(), error.c_str());
+        CHECK(false);
+        return;
+    }
+
+    MeshBuilder builder;
+    builder.addObjShapes(attrib, shapes);
+    VertexCacheStats before = analyzeVertexCache(builder.getIndices(), builder.getVertices().size());
+    auto original = builder.getIndices().size();
+    builder.optimize("house");
+    VertexCacheStats after = analyzeVertexCache(builder.getIndices(), builder.getVertices().size());
+
+    CHECK(builder.getIndices().size() == original);
+    CHECK(after.acmr <= before.acmr);
+    CHECK(after.atvr >= 1.0f);
+}
+
+}
+
+int main() {
+    testGrid();
+    testHouse();
+    return TEST_RESULT();
+}
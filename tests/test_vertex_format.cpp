@@ -0,0 +1,116 @@
+// Every quantised vertex layout decodes within the error its encoding allows,
+// and the compact layout is at most half the size of the float one
+
+#include "TestCommon.h"
+
+#include "util/VertexFormat.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const glm::vec3 kMin(-500.0f, -20.0f, -100.0f);
+const glm::vec3 kMax(500.0f, 300.0f, 100.0f);
+
+std::vector<MeshVertex> randomVertices(size_t count, float uvLo, float uvHi) {
+    TestRandom random(11);
+    std::vector<MeshVertex> vertices(count);
+    for (MeshVertex &v : vertices) {
+        v.position = glm::vec3(random.uniform(kMin.x, kMax.x), random.uniform(kMin.y, kMax.y), random.uniform(kMin.z, kMax.z));
+        v.uv = glm::vec2(random.uniform(uvLo, uvHi), random.uniform(uvLo, uvHi));
+        float z = random.uniform(-1.0f, 1.0f);
+        float phi = random.uniform(0.0f, glm::two_pi<float>());
+        float r = std::sqrt(1.0f - z * z);
+        v.normal = glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+    // The corners pin the bounding box the positions are quantised in
+    vertices[0].position = kMin;
+    vertices[1].position = kMax;
+    return vertices;
+}
+
+// atan2 rather than acos, which cannot resolve angles this small in float
+float angleDegrees(glm::vec3 a, glm::vec3 b) {
+    glm::dvec3 da(a), db(b);
+    return (float)glm::degrees(std::atan2(glm::length(glm::cross(da, db)), glm::dot(da, db)));
+}
+
+// Largest per-axis error of each attribute over every vertex
+struct AxisError {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec2 uv = glm::vec2(0.0f);
+    float normalDegrees = 0.0f;
+};
+
+AxisError decodeAll(const std::vector<MeshVertex> &vertices, const PackedVertices &packed) {
+    AxisError error;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        MeshVertex decoded = decodeVertex(packed, i);
+        error.position = glm::max(error.position, glm::abs(decoded.position - vertices[i].position));
+        error.uv = glm::max(error.uv, glm::abs(decoded.uv - vertices[i].uv));
+        if (packed.layout.normal != NormalEncoding::None) {
+            error.normalDegrees = std::max(error.normalDegrees, angleDegrees(decoded.normal, vertices[i].normal));
+        }
+    }
+    return error;
+}
+
+void testFloat() {
+    std::vector<MeshVertex> vertices = randomVertices(10000, -4.0f, 4.0f);
+    PackedVertices packed = packVertices(vertices, VertexLayout());
+    AxisError error = decodeAll(vertices, packed);
+    CHECK(packed.stride == 32);
+    CHECK(error.position == glm::vec3(0.0f));
+    CHECK(error.uv == glm::vec2(0.0f));
+    CHECK(error.normalDegrees < 1e-4f);
+}
+
+void testQuantized() {
+    std::vector<MeshVertex> vertices = randomVertices(100000, 0.0f, 1.0f);
+    glm::vec3 extent = kMax - kMin;
+
+    for (NormalEncoding normal : {NormalEncoding::Int2101010, NormalEncoding::Octahedral}) {
+        VertexLayout layout;
+        layout.position = PositionEncoding::Unorm16;
+        layout.uv = UvEncoding::Unorm16;
+        layout.normal = normal;
+        PackedVertices packed = packVertices(vertices, layout);
+        AxisError error = decodeAll(vertices, packed);
+        printVertexFormat("random", packed, measureQuantizationError(vertices, packed));
+
+        // Rounding to the nearest of 65535 steps, plus float error in the dequantize matrix
+        glm::vec3 positionBound = extent / 65535.0f * 0.5f + extent * 1e-6f;
+        CHECK(glm::all(glm::lessThanEqual(error.position, positionBound)));
+        CHECK(error.uv.x <= 0.5f / 65535.0f + 1e-7f && error.uv.y <= 0.5f / 65535.0f + 1e-7f);
+
+        // Half a step of 511 on each of three components, or of 32767 on two
+        // octahedral coordinates which stretch the sphere by up to about 2x
+        float normalBound = normal == NormalEncoding::Int2101010 ? 0.11f : 0.01f;
+        CHECK(error.normalDegrees <= normalBound);
+
+        CHECK(packed.stride * 2 <= 32);
+    }
+}
+
+void testHalfUv() {
+    // Tiled uvs fall back from Unorm16 to half floats, which keep 11 significant bits
+    std::vector<MeshVertex> vertices = randomVertices(10000, -4.0f, 4.0f);
+    VertexLayout layout;
+    layout.uv = UvEncoding::Unorm16;
+    PackedVertices packed = packVertices(vertices, layout);
+    CHECK(packed.layout.uv == UvEncoding::Half);
+    AxisError error = decodeAll(vertices, packed);
+    CHECK(error.uv.x <= 4.0f / 2048.0f && error.uv.y <= 4.0f / 2048.0f);
+}
+
+}
+
+int main() {
+    testFloat();
+    testQuantized();
+    testHalfUv();
+    return TEST_RESULT();
+}